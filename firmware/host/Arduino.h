@@ -0,0 +1,113 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __host_arduino_h
+#define __host_arduino_h
+
+// Just enough of the Arduino core for the pattern code in
+// ../snowflake_complete to build and run on a PC. The clock and the
+// ADC are whatever the host program says they are (see host_hal_t),
+// so a run can be repeated exactly. Everything is thread_local so
+// that each thread can run its own snowflake.
+//
+// Build with -DSERIAL_DEBUG; Serial here swallows everything. 
+// Sensors_c::myVcc() talks to the ADC registers directly and would
+// spin forever waiting on ADSC, so the host programs leave it alone.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef F_CPU
+#define F_CPU 8000000UL
+#endif
+#define E2END 0x3FF
+
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(p)  (*(const uint8_t  *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P memcpy
+
+#define _BV(b)           (1u << (b))
+#define bit(b)           (1ul << (b))
+#define bit_is_set(r,b)  ((r) & _BV(b))
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+#define LOW          0
+#define HIGH         1
+#define CHANGE       1
+#define FALLING      2
+#define RISING       3
+#define DEC          10
+#define HEX          16
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A6 20
+#define A7 21
+
+enum {
+    ADSC = 6, ADEN = 7, REFS0 = 6,
+    MUX0 = 0, MUX1 = 1, MUX2 = 2, MUX3 = 3,
+    PCIF0 = 0, PCIE0 = 0,
+};
+
+extern thread_local volatile uint8_t  ADMUX, ADCSRA, ADCL, ADCH, PORTD, TCNT0;
+// port B and its pin change interrupt, for bpress.cpp. PINB starts out
+// with every pin high, as the pullups leave the buttons.
+extern thread_local volatile uint8_t  PINB, PCMSK0, PCIFR, PCICR;
+extern thread_local volatile uint16_t TCNT1;
+
+// What the host program plugs in. analogRead() calls analog_read if
+// it is set, and returns 0 if not.
+typedef struct host_hal_t {
+    uint32_t millis;
+    uint16_t (*analog_read)(void *ctx, uint8_t pin);
+    void     *ctx;
+} host_hal_t;
+
+extern thread_local host_hal_t host_hal;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t v);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+inline void noInterrupts() { };
+inline void interrupts() { };
+// a handler is a plain function, which the host program calls
+#define ISR(vector) void vector(void)
+
+class HardwareSerial {
+    public:
+    void begin(long) { };
+    void flush() { };
+    int  availableForWrite() { return 63; };
+    template<class T> void print(T) { };
+    template<class T> void print(T, int) { };
+    template<class T> void println(T) { };
+    template<class T> void println(T, int) { };
+    void println() { };
+};
+
+extern HardwareSerial Serial;
+
+#endif
+
@@ -0,0 +1,21 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __host_avr_sleep_h
+#define __host_avr_sleep_h
+
+// The host never sleeps.
+
+inline void sleep_enable() { };
+inline void sleep_disable() { };
+inline void sleep_cpu() { };
+
+#endif
@@ -0,0 +1,417 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Runs a whole installation's worth of snowflakes at once: every unit
+// is a sim_c (see sim.h), so the real patterns, with its own seed,
+// settings and sensor readings.
+//
+//   batchsim [-u units] [-s seconds] [-j threads] [-B units_per_shard]
+//            [-p pattern] [-S seed] [-a readings.txt] [-g] [-c] [-T]
+//
+// Units are split into shards, and the shards are shared out among
+// the threads, which steal from each other when they run out. The
+// patterns write their pixels as usual; the output step (mask, scale
+// and, with -g, gamma) is done here instead of by copyToOut(), on
+// batches of frames laid out a plane per channel and pixel so that
+// the compiler can vectorize it. -c checks every frame against
+// copyToOut().
+//
+// Reports unit-frames a second, and a digest of every frame of every
+// unit, which should not change with the number of threads. -T runs
+// with 1, 2, 4 ... threads up to -j, to see how it scales.
+//
+// Without -a, the readings are made up from each unit's seed, as in
+// snowsim; with it, each unit starts at a different place in the file.
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O3 -pthread -DSERIAL_DEBUG -DNDEBUG -I. -I../snowflake_complete
+//       batchsim.cpp hal.cpp ../snowflake_complete/helpers.cpp
+//       ../snowflake_complete/tables.cpp -o batchsim
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sim.h"
+
+const unsigned BATCH_FRAMES = 256;
+const unsigned CHANNELS     = sizeof(pixel_t);
+
+typedef struct unit_adc_t {
+    const std::vector<uint16_t> *trace; // light, sound, light, sound, ...
+    size_t   light_pos, sound_pos;
+    uint32_t lcg;
+} unit_adc_t;
+
+static uint16_t unit_read(void *ctx, uint8_t pin) {
+    unit_adc_t *adc = (unit_adc_t *)ctx;
+    bool is_sound = pin == SIM_SOUND_PIN;
+    if (adc->trace->size() >= 2) {
+        size_t &pos = is_sound ? adc->sound_pos : adc->light_pos;
+        uint16_t v = (*adc->trace)[(2 * pos + is_sound) % adc->trace->size()];
+        pos++;
+        return v;
+    }
+    adc->lcg = adc->lcg * 1103515245UL + 12345UL;
+    uint16_t r = adc->lcg >> 16;
+    return is_sound ? (r & 0x7) ? 480 + (r & 0x3f) : 200 + (r & 0x3ff)
+                    : 300 + (r & 0xf);
+}
+
+typedef struct unit_t {
+    sim_c     *sim;
+    unit_adc_t adc;
+    uint32_t   millis;
+    uint32_t   frames;
+    uint64_t   digest;   // FNV-1a over every byte sent to the pixels
+    uint64_t   energy;   // sum of the same, for how bright it ran
+    bool       mismatch;
+} unit_t;
+
+// Frames waiting for the output step, a plane per channel and pixel.
+typedef struct frame_batch_t {
+    uint8_t  in [CHANNELS][PIXEL_CHAIN_LENGTH][BATCH_FRAMES];
+    uint8_t  out[CHANNELS][PIXEL_CHAIN_LENGTH][BATCH_FRAMES];
+    uint8_t  scale[BATCH_FRAMES];
+    uint32_t mask[BATCH_FRAMES];
+    uint32_t sum[BATCH_FRAMES];
+    unit_t  *unit[BATCH_FRAMES];
+    // copyToOut()'s idea of each frame, for -c
+    uint8_t  ref[BATCH_FRAMES][PIXEL_CHAIN_LENGTH * CHANNELS];
+    unsigned n;
+} frame_batch_t;
+
+// What copyToOut() does, a plane at a time.
+static void outputKernel(frame_batch_t &b, const uint8_t *gamma) {
+    const unsigned n = b.n;
+    for (unsigned p=0;p<PIXEL_CHAIN_LENGTH;p++) {
+        uint8_t on[BATCH_FRAMES];
+        for (unsigned f=0;f<n;f++) on[f] = -(uint8_t)((b.mask[f] >> p) & 1);
+        for (unsigned c=0;c<CHANNELS;c++) {
+            const uint8_t *src = b.in[c][p];
+            uint8_t       *dst = b.out[c][p];
+            for (unsigned f=0;f<n;f++) {
+                dst[f] = (uint8_t)(((uint16_t)src[f] * b.scale[f]) >> 8) & on[f];
+            }
+            if (gamma) {
+                for (unsigned f=0;f<n;f++) dst[f] = gamma[dst[f]];
+            }
+        }
+    }
+    for (unsigned f=0;f<n;f++) b.sum[f] = 0;
+    for (unsigned p=0;p<PIXEL_CHAIN_LENGTH;p++) {
+        for (unsigned c=0;c<CHANNELS;c++) {
+            const uint8_t *dst = b.out[c][p];
+            for (unsigned f=0;f<n;f++) b.sum[f] += dst[f];
+        }
+    }
+}
+
+static void flushBatch(frame_batch_t &b, const uint8_t *gamma, bool check) {
+    outputKernel(b, gamma);
+    for (unsigned f=0;f<b.n;f++) {
+        unit_t *u = b.unit[f];
+        uint64_t h = u->digest;
+        for (unsigned p=0;p<PIXEL_CHAIN_LENGTH;p++) {
+            for (unsigned c=0;c<CHANNELS;c++) {
+                uint8_t v = b.out[c][p][f];
+                h = (h ^ v) * 0x100000001b3ULL;
+                if (check) {
+                    uint8_t r = b.ref[f][p * CHANNELS + c];
+                    if (gamma) r = gamma[r];
+                    if (r != v) u->mismatch = true;
+                }
+            }
+        }
+        u->digest  = h;
+        u->energy += b.sum[f];
+    }
+    b.n = 0;
+}
+
+static void runShard(std::vector<unit_t> &units, unsigned first, unsigned count,
+                     uint32_t ms, const uint8_t *gamma, bool check, frame_batch_t &b) {
+    for (unsigned i=first;i<first+count;i++) {
+        unit_t &u = units[i];
+        host_hal.millis      = u.millis;
+        host_hal.analog_read = unit_read;
+        host_hal.ctx         = &u.adc;
+        uint32_t end = u.millis + ms;
+        while ((int32_t)(end - host_hal.millis) > 0) {
+            u.sim->sample();
+            if (u.sim->due(host_hal.millis)) {
+                u.sim->tick(host_hal.millis);
+                const pixel_t *w = u.sim->work();
+                unsigned f = b.n++;
+                for (unsigned p=0;p<PIXEL_CHAIN_LENGTH;p++) {
+                    for (unsigned c=0;c<CHANNELS;c++) b.in[c][p][f] = w[p].d[c];
+                }
+                b.scale[f] = u.sim->scale();
+                b.mask[f]  = u.sim->mask();
+                b.unit[f]  = &u;
+                if (check) {
+                    u.sim->copyOut();
+                    memcpy(b.ref[f], u.sim->out(), sizeof(b.ref[f]));
+                }
+                u.frames++;
+                if (b.n == BATCH_FRAMES) flushBatch(b, gamma, check);
+            }
+            host_hal.millis += SIM_LOOP_MS;
+        }
+        // this unit's frames have to be counted before the next one's
+        flushBatch(b, gamma, check);
+        u.millis = host_hal.millis;
+    }
+}
+
+// A deque of shards for each thread. A thread takes from the front of
+// its own, and when that is empty, from the back of someone else's.
+class steal_pool_c {
+    public:
+    steal_pool_c(unsigned workers, unsigned tasks) : queues(workers) {
+        // contiguous runs, so neighbours stay together until stolen
+        for (unsigned t=0;t<tasks;t++) queues[(uint64_t)t * workers / tasks].q.push_back(t);
+    }
+
+    bool next(unsigned w, unsigned &task, bool &stolen) {
+        {
+            std::lock_guard<std::mutex> l(queues[w].m);
+            if (!queues[w].q.empty()) {
+                task = queues[w].q.front();
+                queues[w].q.pop_front();
+                stolen = false;
+                return true;
+            }
+        }
+        for (unsigned k=1;k<queues.size();k++) {
+            queue_t &v = queues[(w + k) % queues.size()];
+            std::lock_guard<std::mutex> l(v.m);
+            if (!v.q.empty()) {
+                task = v.q.back();
+                v.q.pop_back();
+                stolen = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    private:
+    typedef struct queue_t {
+        std::mutex m;
+        std::deque<unsigned> q;
+    } queue_t;
+    std::vector<queue_t> queues;
+};
+
+typedef struct run_opts_t {
+    unsigned units;
+    unsigned shard;
+    uint32_t ms;
+    int      pattern;
+    uint32_t seed;
+    bool     gamma;
+    bool     check;
+    const std::vector<uint16_t> *trace;
+} run_opts_t;
+
+typedef struct run_result_t {
+    double   secs;
+    uint64_t frames;
+    uint64_t digest;
+    uint64_t energy;
+    unsigned stolen;
+    unsigned mismatched;
+} run_result_t;
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static run_result_t run(const run_opts_t &o, unsigned threads) {
+    uint8_t gamma_table[256];
+    for (unsigned i=0;i<256;i++) gamma_table[i] = gamma8(i);
+    const uint8_t *gamma = o.gamma ? gamma_table : 0;
+
+    // settings for every unit come from the one seed, so that every run
+    // is the same installation
+    std::vector<unit_t> units(o.units);
+    uint32_t lcg = o.seed;
+    auto rnd = [&] (uint32_t range) {
+        lcg = lcg * 1103515245UL + 12345UL;
+        return (uint32_t)((lcg >> 8) % range);
+    };
+    for (unsigned i=0;i<o.units;i++) {
+        unit_t &u = units[i];
+        varn_indices_t v;
+        memset(&v, 0, sizeof(v));
+        if (o.pattern >= 0) {
+            v.pattern_idx = o.pattern;
+        } else {
+            // not the settings pattern
+            v.pattern_idx = rnd(sim_c::SIM_PATTERNS - 1);
+            if (v.pattern_idx >= sim_c::SIM_SETTINGS_IDX) v.pattern_idx++;
+        }
+        v.var0_idx    = rnd(VARIATION_0_COUNT);
+        v.delay_idx   = rnd(getLength(delays));
+        v.brite_idx   = rnd(getLength(brightnesses));
+        v.sound_idx   = rnd(SOUND_FLASH + 1);
+        u.adc.trace     = o.trace;
+        u.adc.light_pos = u.adc.sound_pos = o.trace->size() ? rnd(o.trace->size() / 2) : 0;
+        u.adc.lcg       = lcg ^ i;
+        u.millis   = 0;
+        u.frames   = 0;
+        u.digest   = 0xcbf29ce484222325ULL;
+        u.energy   = 0;
+        u.mismatch = false;
+        host_hal.millis      = 0;
+        host_hal.analog_read = unit_read;
+        host_hal.ctx         = &u.adc;
+        u.sim = sim_c::create(lcg, v);
+    }
+
+    unsigned shards = (o.units + o.shard - 1) / o.shard;
+    steal_pool_c pool(threads, shards);
+    std::vector<unsigned> stolen(threads, 0);
+
+    double start = nowSec();
+    auto worker = [&] (unsigned w) {
+        frame_batch_t *b = new frame_batch_t;
+        b->n = 0;
+        unsigned task;
+        bool st;
+        while (pool.next(w, task, st)) {
+            if (st) stolen[w]++;
+            unsigned first = task * o.shard;
+            unsigned count = std::min(o.shard, o.units - first);
+            runShard(units, first, count, o.ms, gamma, o.check, *b);
+        }
+        delete b;
+    };
+    std::vector<std::thread> pool_threads;
+    for (unsigned w=1;w<threads;w++) pool_threads.push_back(std::thread(worker, w));
+    worker(0);
+    for (size_t i=0;i<pool_threads.size();i++) pool_threads[i].join();
+
+    run_result_t r;
+    r.secs       = nowSec() - start;
+    r.frames     = 0;
+    r.digest     = 0xcbf29ce484222325ULL;
+    r.energy     = 0;
+    r.stolen     = 0;
+    r.mismatched = 0;
+    for (unsigned i=0;i<o.units;i++) {
+        r.frames += units[i].frames;
+        r.energy += units[i].energy;
+        // in unit order, however the work was split up
+        r.digest  = (r.digest ^ units[i].digest) * 0x100000001b3ULL;
+        if (units[i].mismatch) r.mismatched++;
+        sim_c::destroy(units[i].sim);
+    }
+    for (unsigned w=0;w<threads;w++) r.stolen += stolen[w];
+    return r;
+}
+
+int main(int argc, char **argv) {
+    run_opts_t o;
+    o.units   = 1000;
+    o.shard   = 16;
+    o.ms      = 60000;
+    o.pattern = -1;
+    o.seed    = DEFAULT_SEED_V;
+    o.gamma   = false;
+    o.check   = false;
+    unsigned threads = std::thread::hardware_concurrency();
+    bool sweep = false;
+    const char *readings = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "u:s:j:B:p:S:a:gcT")) != -1) {
+        switch (opt) {
+            case 'u': o.units   = strtoul(optarg, 0, 0); break;
+            case 's': o.ms      = strtoul(optarg, 0, 0) * 1000; break;
+            case 'j': threads   = strtoul(optarg, 0, 0); break;
+            case 'B': o.shard   = strtoul(optarg, 0, 0); break;
+            case 'p': o.pattern = atoi(optarg); break;
+            case 'S': o.seed    = strtoul(optarg, 0, 0); break;
+            case 'a': readings  = optarg; break;
+            case 'g': o.gamma   = true; break;
+            case 'c': o.check   = true; break;
+            case 'T': sweep     = true; break;
+            default:
+                fprintf(stderr, "usage: batchsim [-u units] [-s seconds] [-j threads] [-B units_per_shard]\n"
+                                "                [-p pattern] [-S seed] [-a readings.txt] [-g] [-c] [-T]\n");
+                return 2;
+        }
+    }
+    if (!threads) threads = 1;
+    if (!o.units || !o.shard || (o.pattern >= (int)sim_c::SIM_PATTERNS)) return 2;
+
+    std::vector<uint16_t> trace;
+    if (readings) {
+        FILE *rf = fopen(readings, "r");
+        if (!rf) {
+            perror(readings);
+            return 1;
+        }
+        unsigned l, s;
+        while (fscanf(rf, "%u %u", &l, &s) == 2) {
+            trace.push_back(l);
+            trace.push_back(s);
+        }
+        fclose(rf);
+    }
+    o.trace = &trace;
+
+    printf("%u units, %u a shard, %us each%s%s\n", o.units, o.shard, o.ms / 1000,
+           o.gamma ? ", gamma" : "", o.check ? ", checked against copyToOut()" : "");
+    printf("threads  seconds   unit-frames/s  speedup  stolen  digest\n");
+    double base = 0;
+    uint64_t digest = 0;
+    bool ok = true;
+    std::vector<unsigned> counts;
+    for (unsigned t=1;sweep && (t<threads);t*=2) counts.push_back(t);
+    counts.push_back(threads);
+    for (size_t k=0;k<counts.size();k++) {
+        unsigned t = counts[k];
+        run_result_t r = run(o, t);
+        double fps = r.frames / r.secs;
+        if (!base) {
+            base   = fps;
+            digest = r.digest;
+        }
+        printf("%7u %8.2f %15.0f %8.2f %7u  %016llx\n", t, r.secs, fps, fps / base, r.stolen,
+               (unsigned long long)r.digest);
+        if (r.digest != digest) {
+            printf("digest changed with the number of threads!\n");
+            ok = false;
+        }
+        if (r.mismatched) {
+            printf("%u units did not match copyToOut()\n", r.mismatched);
+            ok = false;
+        }
+        if (t == threads) {
+            printf("%llu frames, %.1f average output level\n", (unsigned long long)r.frames,
+                   r.frames ? (double)r.energy / r.frames / (PIXEL_CHAIN_LENGTH * CHANNELS) : 0.0);
+        }
+    }
+    return ok ? 0 : 1;
+}
+
@@ -0,0 +1,218 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Runs buttons_c (bpress.cpp) against made-up edges on PINB, calling
+// the pin change handler as the AVR would for each one, and checks the
+// events it queues:
+//
+//   buttonsim [-v]
+//
+// The cases are a press and release that bounce, a bounce that ends
+// the other way from how it started (which only poll() can settle),
+// more events than the ring holds, and a button held down at begin().
+// It prints each case and whether it passed, with -v every event too,
+// and exits 1 if any failed.
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -I. -I../snowflake_complete
+//       buttonsim.cpp hal.cpp ../snowflake_complete/bpress.cpp -o buttonsim
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bpress.h"
+
+// as the sketch has them
+const uint8_t  BUTTON0_PIN = 9;
+const uint8_t  BUTTON1_PIN = 8;
+const uint16_t SHORT_MS    = 200;
+const uint16_t MED_MS      = 1000;
+const uint16_t LONG_MS     = 8000;
+
+static bool verbose = false;
+static bool failed  = false;
+
+// the pin change vector, in bpress.cpp
+void PCINT0_vect(void);
+
+static void setButton(uint8_t b, bool is_down, uint32_t ms) {
+    host_hal.millis = ms;
+    uint8_t m = _BV((b ? BUTTON1_PIN : BUTTON0_PIN) - 8);
+    if (is_down) {
+        PINB &= ~m;
+    } else {
+        PINB |= m;
+    }
+    if (PCMSK0 & m) PCINT0_vect();
+}
+
+static void poll(uint32_t ms) {
+    host_hal.millis = ms;
+    buttons_c::poll();
+}
+
+static void begin(uint8_t held, uint32_t ms) {
+    host_hal.millis = ms;
+    PINB   = 0xff;
+    PCMSK0 = 0;
+    if (held & 0x1) PINB &= ~_BV(BUTTON0_PIN - 8);
+    if (held & 0x2) PINB &= ~_BV(BUTTON1_PIN - 8);
+    buttons_c::begin(BUTTON0_PIN, BUTTON1_PIN, SHORT_MS, MED_MS, LONG_MS);
+    // the last case may have left events behind
+    bp_event_t ev;
+    while (buttons_c::next(ev)) { };
+    buttons_c::overflows();
+}
+
+// Takes the events the ring has and checks them against want[]. An
+// event in want[] with a kind of bp_none is a press or a release from
+// boot; every field has to match.
+static void expect(const char *name, const bp_event_t *want, uint8_t n,
+                   uint8_t overflows = 0) {
+    bool ok = true;
+    uint8_t i = 0;
+    bp_event_t ev;
+    while (buttons_c::next(ev)) {
+        if (verbose) {
+            printf("    b%u %-4s kind %u at %lu\n", ev.button, ev.down ? "down" : "up",
+                   ev.kind, (unsigned long)ev.ms);
+        }
+        if ((i >= n) || (ev.button != want[i].button) || (ev.down != want[i].down) ||
+            (ev.kind != want[i].kind) || (ev.ms != want[i].ms)) ok = false;
+        i++;
+    }
+    if (i != n) ok = false;
+    uint8_t o = buttons_c::overflows();
+    if (o != overflows) ok = false;
+    printf("%-32s %u events, %u lost  %s\n", name, i, o, ok ? "ok" : "BAD");
+    if (!ok) failed = true;
+}
+
+// Each edge of a press and of its release bounces for a few ms; only
+// the first edge of each counts, stamped with when it came.
+static void bounce() {
+    begin(0, 0);
+    setButton(0, true,  100);
+    setButton(0, false, 102);
+    setButton(0, true,  105);
+    setButton(0, false, 109);
+    setButton(0, true,  110);
+    poll(200);
+    setButton(0, false, 1000);
+    setButton(0, true,  1001);
+    setButton(0, false, 1004);
+    poll(1100);
+    const bp_event_t want[] = {
+        { 0, true,  bp_none,   100  },
+        { 0, false, bp_medium, 1000 },
+    };
+    expect("bounce", want, 2);
+}
+
+// A bounce that ends up the other way from its first edge leaves the
+// button looking down with the pin up, and no edge to come. poll()
+// must not settle it until it has been steady for the debounce time,
+// and then stamps the release with the last edge.
+static void reversed() {
+    begin(0, 0);
+    setButton(1, true,  100);
+    setButton(1, false, 104);
+    poll(110);
+    const bp_event_t early[] = {
+        { 1, true,  bp_none,  100 },
+    };
+    expect("reversed, too soon to settle", early, 1);
+
+    poll(104 + BP_DEBOUNCE_MILLIS);
+    poll(500);
+    const bp_event_t want[] = {
+        { 1, false, bp_short, 104 },
+    };
+    expect("reversed, settled by poll()", want, 1);
+
+    // and the other way, a release that bounces back down, which
+    // poll() turns into a press again
+    setButton(1, true,  2000);
+    setButton(1, false, 2500);
+    setButton(1, true,  2503);
+    poll(2600);
+    setButton(1, false, 2503 + MED_MS);
+    const bp_event_t back[] = {
+        { 1, true,  bp_none,   2000 },
+        { 1, false, bp_medium, 2500 },
+        { 1, true,  bp_none,   2503 },
+        { 1, false, bp_long,   2503 + MED_MS },
+    };
+    expect("reversed release, settled down", back, 4);
+}
+
+// The ring holds one less than BP_RING_LEN; past that, events are
+// dropped and counted until next() makes room.
+static void overflow() {
+    begin(0, 0);
+    bp_event_t want[BP_RING_LEN];
+    uint8_t n = 0;
+    uint32_t ms = 100;
+    for (uint8_t i=0;i<BP_RING_LEN;i++) {
+        bool is_down = !(i & 0x1);
+        setButton(0, is_down, ms);
+        if (n < BP_RING_LEN - 1) {
+            want[n].button = 0;
+            want[n].down   = is_down;
+            want[n].kind   = is_down ? bp_none : bp_short;
+            want[n].ms     = ms;
+            n++;
+        }
+        ms += 100;
+    }
+    // the last release was lost, and the next press still goes in
+    // once there is room
+    expect("overflow", want, n, 1);
+    setButton(0, true, ms);
+    const bp_event_t after[] = {
+        { 0, true, bp_none, ms },
+    };
+    expect("overflow, then room", after, 1);
+}
+
+// A button down at begin(), such as the press that woke the sketch,
+// is let go of with a release of no length; the next press counts.
+static void heldAtBoot() {
+    begin(0x2, 50);
+    setButton(1, false, 4000);
+    setButton(1, true,  5000);
+    setButton(1, false, 5000 + LONG_MS);
+    const bp_event_t want[] = {
+        { 1, false, bp_none,     4000 },
+        { 1, true,  bp_none,     5000 },
+        { 1, false, bp_verylong, 5000 + LONG_MS },
+    };
+    expect("held at boot", want, 3);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        switch (opt) {
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: buttonsim [-v]\n");
+                return 2;
+        }
+    }
+
+    bounce();
+    reversed();
+    overflow();
+    heldAtBoot();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,373 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Makes clips for Fun_Clip_c (see clip.h).
+//
+//   clipenc [-t tick_ms] [-r] [-o clips.h] in.snfs|in.csv ...
+//
+// A .snfs is a capture from snowsim (framestream.h), a clip frame for
+// every frame in it. Captures have the unit's brightness in them, so
+// capture at full brightness (-b 3) for a clip that is not dimmed
+// twice.
+//
+// A .csv is a timeline, a line a frame:
+//
+//   ms, RRGGBB, RRGGBB, ...      a color for every pixel
+//
+// with each frame held for ms (at least one tick, of tick_ms; the
+// sketch's fastest normal speed is 70ms). # starts a comment.
+//
+// Each clip is checked by decoding it again, frame by frame. It is
+// written with a palette if it has few enough colors, unless -r says
+// not to. The report has the compression against raw frames and the
+// time to decode a frame: here, and a rough count of AVR cycles from
+// what the decoder has to do for it. PROFILE_ENABLE gives the real
+// number on a unit.
+//
+// With -o, the clips are written as a header, each named after its
+// file: clip_reveal for reveal.csv.
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -DNDEBUG -I. -I../snowflake_complete
+//       clipenc.cpp hal.cpp -o clipenc
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "clip.h"
+#include "framestream.h"
+
+// Rough AVR cycle costs of the decoder's steps, from the instructions
+// the loops in clip_player_c::next() come to.
+const unsigned CYC_FRAME       = 40;
+const unsigned CYC_CLEAR_BYTE  = 4;
+const unsigned CYC_OP          = 14;
+const unsigned CYC_COLOR_PAL   = 16;
+const unsigned CYC_COLOR_RAW   = 12;
+const unsigned CYC_STORE       = 10;
+
+typedef std::vector<uint32_t> frame_t; // pixel_t order, G R B from the top byte
+
+typedef struct clip_src_t {
+    std::string name;
+    uint8_t pixels;
+    std::vector<frame_t> frames;
+} clip_src_t;
+
+typedef struct file_source_t {
+    FILE *f;
+    int get() { return fgetc(f); }
+} file_source_t;
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string stem(const char *path) {
+    std::string s(path);
+    size_t slash = s.find_last_of('/');
+    if (slash != std::string::npos) s = s.substr(slash + 1);
+    size_t dot = s.find('.');
+    if (dot != std::string::npos) s = s.substr(0, dot);
+    for (size_t i=0;i<s.size();i++) {
+        if (!isalnum((unsigned char)s[i])) s[i] = '_';
+    }
+    return s;
+}
+
+static bool readCapture(const char *path, clip_src_t &c) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    file_source_t src = { f };
+    fs_reader_c<file_source_t> rdr(src);
+    bool ok = rdr.header();
+    if (!ok) fprintf(stderr, "%s: not a frame stream\n", path);
+    c.pixels = rdr.hdr.chain_len;
+    while (ok) {
+        fs_read_e r = rdr.next();
+        if (r == FS_READ_END) break;
+        if (r == FS_READ_ERROR) {
+            fprintf(stderr, "%s: cut short after %u frames\n", path, (unsigned)c.frames.size());
+            break;
+        }
+        if (r != FS_READ_FRAME) continue;
+        frame_t fr(c.pixels);
+        for (uint8_t i=0;i<c.pixels;i++) {
+            const uint8_t *p = rdr.pix + i * FS_BYTES_PER_PIX;
+            fr[i] = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+        }
+        c.frames.push_back(fr);
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool readCsv(const char *path, unsigned tick_ms, clip_src_t &c) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char line[2048];
+    unsigned lineno = 0;
+    c.pixels = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        std::vector<std::string> cols;
+        for (char *tok = strtok(line, ", \t\r\n"); tok; tok = strtok(0, ", \t\r\n")) cols.push_back(tok);
+        if (cols.empty()) continue;
+        unsigned n = cols.size() - 1;
+        if (!n || (n > FS_MAX_CHAIN) || (c.pixels && (n != c.pixels))) {
+            fprintf(stderr, "%s:%u: %u pixels\n", path, lineno, n);
+            fclose(f);
+            return false;
+        }
+        c.pixels = n;
+        frame_t fr(n);
+        for (unsigned i=0;i<n;i++) {
+            uint32_t rgb = strtoul(cols[i + 1].c_str(), 0, 16);
+            uint8_t r = rgb >> 16, g = rgb >> 8, b = rgb;
+            fr[i] = ((uint32_t)g << 16) | ((uint32_t)r << 8) | b;
+        }
+        unsigned ms    = strtoul(cols[0].c_str(), 0, 0);
+        unsigned ticks = (ms + tick_ms / 2) / tick_ms;
+        if (!ticks) ticks = 1;
+        while (ticks--) c.frames.push_back(fr);
+    }
+    fclose(f);
+    return c.pixels != 0;
+}
+
+// What a clip is made of, and what it costs to decode.
+typedef struct clip_out_t {
+    std::vector<uint8_t> bytes;
+    unsigned max_cycles;
+    uint64_t cycles;
+} clip_out_t;
+
+static void putColor(std::vector<uint8_t> &out, uint32_t c, const std::map<uint32_t, uint8_t> *pal) {
+    if (pal) {
+        out.push_back(pal->find(c)->second);
+    } else {
+        out.push_back(c >> 16);
+        out.push_back(c >> 8);
+        out.push_back(c);
+    }
+}
+
+// The shortest run of ops that takes prev to cur, by working back
+// from the end: best[i] is the fewest bytes that cover pixels i on.
+static unsigned encodeFrame(const frame_t &prev, const frame_t &cur,
+                            const std::map<uint32_t, uint8_t> *pal, std::vector<uint8_t> &out) {
+    const unsigned n = cur.size();
+    const unsigned csize = pal ? 1 : 3;
+    std::vector<unsigned> best(n + 1, 0), op(n + 1, 0), len(n + 1, 0);
+    for (int i=n-1;i>=0;i--) {
+        best[i] = ~0u;
+        for (unsigned k=1;(k<=CLIP_MAX_SKIP) && (i+k<=n) && (cur[i+k-1] == prev[i+k-1]);k++) {
+            if (1 + best[i+k] < best[i]) { best[i] = 1 + best[i+k]; op[i] = CLIP_OP_SKIP; len[i] = k; }
+        }
+        for (unsigned k=1;(k<=CLIP_MAX_RUN) && (i+k<=n) && (cur[i+k-1] == cur[i]);k++) {
+            if (1 + csize + best[i+k] < best[i]) { best[i] = 1 + csize + best[i+k]; op[i] = CLIP_OP_RUN; len[i] = k; }
+        }
+        for (unsigned k=1;(k<=CLIP_MAX_LIT) && (i+k<=n);k++) {
+            if (1 + k * csize + best[i+k] < best[i]) { best[i] = 1 + k * csize + best[i+k]; op[i] = CLIP_OP_LIT; len[i] = k; }
+        }
+    }
+    unsigned cycles = CYC_FRAME;
+    for (unsigned i=0;i<n;i+=len[i]) {
+        out.push_back(op[i] | (len[i] - 1));
+        cycles += CYC_OP;
+        if (op[i] == CLIP_OP_RUN) {
+            putColor(out, cur[i], pal);
+            cycles += (pal ? CYC_COLOR_PAL : CYC_COLOR_RAW) + len[i] * CYC_STORE;
+        } else if (op[i] == CLIP_OP_LIT) {
+            for (unsigned k=0;k<len[i];k++) putColor(out, cur[i + k], pal);
+            cycles += len[i] * ((pal ? CYC_COLOR_PAL : CYC_COLOR_RAW) + CYC_STORE);
+        }
+    }
+    return cycles;
+}
+
+static clip_out_t encode(const clip_src_t &c, bool raw) {
+    std::map<uint32_t, uint8_t> pal;
+    std::vector<uint32_t> colors;
+    // palette_len is a byte, and 0 means none
+    bool use_pal = !raw;
+    for (size_t f=0;use_pal && (f<c.frames.size());f++) {
+        for (uint8_t i=0;use_pal && (i<c.pixels);i++) {
+            uint32_t col = c.frames[f][i];
+            if (pal.count(col)) continue;
+            use_pal = colors.size() < 255;
+            pal[col] = colors.size();
+            colors.push_back(col);
+        }
+    }
+
+    clip_out_t o;
+    o.bytes.push_back(CLIP_MAGIC0);
+    o.bytes.push_back(CLIP_MAGIC1);
+    o.bytes.push_back(c.pixels);
+    o.bytes.push_back(c.frames.size() & 0xff);
+    o.bytes.push_back(c.frames.size() >> 8);
+    o.bytes.push_back(use_pal ? colors.size() : 0);
+    if (use_pal) {
+        for (size_t i=0;i<colors.size();i++) putColor(o.bytes, colors[i], 0);
+    }
+    o.cycles = 0;
+    o.max_cycles = 0;
+    frame_t prev(c.pixels, 0);
+    for (size_t f=0;f<c.frames.size();f++) {
+        unsigned cyc = encodeFrame(prev, c.frames[f], use_pal ? &pal : 0, o.bytes);
+        if (!f) cyc += c.pixels * sizeof(pixel_t) * CYC_CLEAR_BYTE;
+        o.cycles += cyc;
+        if (cyc > o.max_cycles) o.max_cycles = cyc;
+        prev = c.frames[f];
+    }
+    return o;
+}
+
+// Plays it back twice round, checking every frame, then times it.
+static bool check(const clip_src_t &c, const clip_out_t &o, double &ns) {
+    clip_player_c player(&o.bytes[0]);
+    if (!player.begin() || (player.frameCount() != c.frames.size())) return false;
+    std::vector<pixel_t> buf(c.pixels);
+    for (size_t f=0;f<c.frames.size()*2;f++) {
+        player.next(&buf[0], c.pixels);
+        const frame_t &want = c.frames[f % c.frames.size()];
+        for (uint8_t i=0;i<c.pixels;i++) {
+            uint32_t got = ((uint32_t)buf[i].d[0] << 16) | ((uint32_t)buf[i].d[1] << 8) | buf[i].d[2];
+            if (got != want[i]) {
+                fprintf(stderr, "%s: frame %u pixel %u is %06x, not %06x\n", c.name.c_str(),
+                        (unsigned)(f % c.frames.size()), i, got, want[i]);
+                return false;
+            }
+        }
+    }
+    const size_t reps = 1 + 2000000 / (c.frames.size() * c.pixels);
+    player.rewind();
+    double t0 = nowSec();
+    for (size_t r=0;r<reps*c.frames.size();r++) player.next(&buf[0], c.pixels);
+    ns = (nowSec() - t0) * 1e9 / (reps * c.frames.size());
+    return true;
+}
+
+static void writeHeader(FILE *f, const std::vector<clip_src_t> &srcs, const std::vector<clip_out_t> &outs) {
+    fprintf(f,
+        "///////////////////////////////////////////////\n"
+        "//\n"
+        "// Copyright 2019 South Berkeley Electronics\n"
+        "// All Rights Reserved\n"
+        "//\n"
+        "// Arduino sketch to control an LED snowflake.\n"
+        "//\n"
+        "// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)\n"
+        "//\n"
+        "///////////////////////////////////////////////\n"
+        "\n"
+        "#ifndef __clips_h\n"
+        "#define __clips_h\n"
+        "\n"
+        "#include <stdint.h>\n"
+        "#include <Arduino.h>\n"
+        "\n"
+        "// Clips for Fun_Clip_c (clip.h). Made by host/clipenc from the\n"
+        "// sources in tools/clips; edit those, not this.\n");
+    for (size_t c=0;c<srcs.size();c++) {
+        const std::vector<uint8_t> &b = outs[c].bytes;
+        fprintf(f, "\n// %s: %u frames of %u pixels, %u bytes\n", srcs[c].name.c_str(),
+                (unsigned)srcs[c].frames.size(), srcs[c].pixels, (unsigned)b.size());
+        fprintf(f, "const uint8_t PROGMEM clip_%s[] = {\n", srcs[c].name.c_str());
+        for (size_t i=0;i<b.size();i+=12) {
+            fprintf(f, "   ");
+            for (size_t j=i;(j<i+12) && (j<b.size());j++) fprintf(f, " 0x%02x,", b[j]);
+            fprintf(f, "\n");
+        }
+        fprintf(f, "};\n");
+    }
+    fprintf(f, "\n#endif\n");
+}
+
+int main(int argc, char **argv) {
+    unsigned    tick_ms = 70;
+    bool        raw     = false;
+    const char *out     = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:ro:")) != -1) {
+        switch (opt) {
+            case 't': tick_ms = strtoul(optarg, 0, 0); break;
+            case 'r': raw     = true; break;
+            case 'o': out     = optarg; break;
+            default:
+                fprintf(stderr, "usage: clipenc [-t tick_ms] [-r] [-o clips.h] in.snfs|in.csv ...\n");
+                return 2;
+        }
+    }
+    if ((optind >= argc) || !tick_ms) {
+        fprintf(stderr, "usage: clipenc [-t tick_ms] [-r] [-o clips.h] in.snfs|in.csv ...\n");
+        return 2;
+    }
+
+    std::vector<clip_src_t> srcs;
+    std::vector<clip_out_t> outs;
+    printf("%-12s %6s %4s %7s %8s %7s %6s %8s %9s %9s\n", "clip", "frames", "pix", "palette",
+           "raw", "clip", "ratio", "ns/frame", "avr cyc", "avr max");
+    for (int a=optind;a<argc;a++) {
+        clip_src_t c;
+        c.name = stem(argv[a]);
+        size_t l = strlen(argv[a]);
+        bool csv = (l > 4) && !strcmp(argv[a] + l - 4, ".csv");
+        if (!(csv ? readCsv(argv[a], tick_ms, c) : readCapture(argv[a], c))) return 1;
+        if (c.frames.empty() || (c.frames.size() > 0xffff)) {
+            fprintf(stderr, "%s: %u frames\n", argv[a], (unsigned)c.frames.size());
+            return 1;
+        }
+        clip_out_t o = encode(c, raw);
+        double ns;
+        if (!check(c, o, ns)) {
+            fprintf(stderr, "%s: does not decode to what went in\n", argv[a]);
+            return 1;
+        }
+        unsigned raw_bytes = c.frames.size() * c.pixels * sizeof(pixel_t);
+        printf("%-12s %6u %4u %7u %8u %7u %5.1fx %8.0f %9.0f %9u\n", c.name.c_str(),
+               (unsigned)c.frames.size(), c.pixels, o.bytes[5], raw_bytes, (unsigned)o.bytes.size(),
+               (double)raw_bytes / o.bytes.size(), ns, (double)o.cycles / c.frames.size(), o.max_cycles);
+        srcs.push_back(c);
+        outs.push_back(o);
+    }
+
+    if (out) {
+        FILE *f = fopen(out, "w");
+        if (!f) {
+            perror(out);
+            return 1;
+        }
+        writeHeader(f, srcs, outs);
+        fclose(f);
+    }
+    return 0;
+}
+
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Fills in the energy table (energy.h) by running every pattern with
+// every var0 for a while, and writes out the EEPROM as avrdude would
+// read it off a unit, for tools/energy_report.py:
+//
+//   energysim [-t seconds] [-d delay_idx] [-s sound_idx] [-S seed] out.eep
+//   ../tools/energy_report.py out.eep
+//
+// The frames go into energy_c just as they do in the sketch with
+// ENERGY_ENABLE, one cell after another on one clock, so the table
+// comes out the way a unit would leave it after the same tour. The
+// readings are made up from the seed, as in golden.
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -DNDEBUG -I. -I../snowflake_complete
+//       energysim.cpp hal.cpp ../snowflake_complete/helpers.cpp
+//       ../snowflake_complete/tables.cpp -o energysim
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "energy.h"
+
+typedef energy_c<sim_c::SIM_PATTERNS, VARIATION_0_COUNT, PIXEL_CHAIN_LENGTH,
+                 ENERGY_EEP_BASE, ENERGY_EEP_SIZE> sim_energy_t;
+
+// a dim room, and quiet talk with the odd loud bit
+static uint16_t energyRead(void *ctx, uint8_t pin) {
+    uint32_t &lcg = *(uint32_t *)ctx;
+    lcg = lcg * 1103515245UL + 12345UL;
+    uint16_t r = lcg >> 16;
+    if (pin == SIM_SOUND_PIN) return (r & 0x7) ? 20 + (r & 0x3f) : 100 + (r & 0xff);
+    return 300 + (r & 0xf);
+}
+
+static int usage() {
+    fprintf(stderr, "usage: energysim [-t seconds] [-d delay_idx] [-s sound_idx] [-S seed] out.eep\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = 300;
+    uint32_t seed    = DEFAULT_SEED_V;
+    varn_indices_t v;
+    memset(&v, 0, sizeof(v));
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:d:s:S:")) != -1) {
+        switch (opt) {
+            case 't': seconds       = strtoul(optarg, 0, 0); break;
+            case 'd': v.delay_idx   = atoi(optarg); break;
+            case 's': v.sound_idx   = atoi(optarg); break;
+            case 'S': seed          = strtoul(optarg, 0, 0); break;
+            default:  return usage();
+        }
+    }
+    if ((optind != argc - 1) || !seconds) return usage();
+    if ((v.delay_idx >= getLength(delays)) || (v.sound_idx > SOUND_FLASH)) {
+        fprintf(stderr, "setting out of range\n");
+        return 2;
+    }
+
+    uint32_t lcg = seed;
+    host_hal.millis      = 0;
+    host_hal.analog_read = energyRead;
+    host_hal.ctx         = &lcg;
+
+    sim_energy_t energy;
+    energy.begin();
+    for (uint8_t p=0;p<sim_c::SIM_PATTERNS;p++) {
+        for (uint8_t var=0;var<VARIATION_0_COUNT;var++) {
+            v.pattern_idx = p;
+            v.var0_idx    = var;
+            sim_c *sim = sim_c::create(seed + ((uint32_t)p << 8) + var, v);
+            uint32_t until = host_hal.millis + seconds * 1000UL;
+            while (host_hal.millis < until) {
+                sim->sample();
+                if (sim->due(host_hal.millis)) {
+                    sim->render(host_hal.millis);
+                    energy.frame(p, var, host_hal.millis, sim->load());
+                }
+                host_hal.millis += SIM_LOOP_MS;
+            }
+            sim_c::destroy(sim);
+        }
+    }
+    // as at shutdown
+    energy.save();
+
+    FILE *f = fopen(argv[optind], "wb");
+    if (!f) {
+        perror(argv[optind]);
+        return 1;
+    }
+    for (uint16_t a=0;a<=E2END;a++) fputc(eeprom_writer_c::read(a), f);
+    fclose(f);
+    return 0;
+}
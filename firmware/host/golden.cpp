@@ -0,0 +1,282 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Golden frames: runs every pattern with every var0 and every sound
+// mode from a fixed seed, and checks a digest of the frames against
+// golden.txt, so that making PixChain_c, pixel_t or the rotators
+// faster cannot quietly change what any pattern looks like.
+//
+//   golden make [-n frames] [-k every] > golden.txt
+//   golden check [-d] golden.txt
+//   golden dump pattern var0 sound [from [count]]
+//
+// For each case it keeps a running FNV-1a digest of the frames as
+// they would go out on the wire, with their times, and writes it down
+// every k frames. check says, for each case that no longer matches,
+// the first k frames in which it went wrong; -d also dumps the frames
+// of the first of those, in the same text as snowsim dump, and the
+// golden dump that makes them. Run that dump with the build golden.txt
+// came from and diff the two to see the first frame that is
+// different, and how.
+//
+// To build, from this directory (without NDEBUG, so that a pattern
+// that strays off the end of the chain fails here too):
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -I. -I../snowflake_complete
+//       golden.cpp hal.cpp ../snowflake_complete/helpers.cpp
+//       ../snowflake_complete/tables.cpp -o golden
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "sim.h"
+
+const uint8_t  GOLDEN_SOUND_MODES = SOUND_FLASH + 1;
+const uint16_t GOLDEN_MAX_MARKS   = 64;
+
+typedef struct golden_case_t {
+    uint8_t  pattern;
+    uint8_t  var0;
+    uint8_t  sound;
+    uint32_t seed;
+    std::vector<uint32_t> marks; // the digest after every k frames
+} golden_case_t;
+
+// A fixed seed for each case, so that a new pattern does not change
+// the ones after it.
+static uint32_t caseSeed(uint8_t pattern, uint8_t var0, uint8_t sound) {
+    return DEFAULT_SEED_V + ((uint32_t)pattern << 16) + (var0 << 8) + sound;
+}
+
+// Made-up readings: a dim room, and a microphone mostly hearing
+// quiet talk with the odd loud bit. These are quieter than the ones
+// snowsim capture makes up, so that SOUND_VU lights part of the
+// chain rather than all of it, and SOUND_FLASH goes on and off.
+static uint16_t goldenRead(void *ctx, uint8_t pin) {
+    uint32_t &lcg = *(uint32_t *)ctx;
+    lcg = lcg * 1103515245UL + 12345UL;
+    uint16_t r = lcg >> 16;
+    if (pin == SIM_SOUND_PIN) return (r & 0x7) ? 20 + (r & 0x3f) : 100 + (r & 0xff);
+    return 300 + (r & 0xf);
+}
+
+static uint32_t fnv(uint32_t h, const uint8_t *d, uint16_t len) {
+    for (uint16_t i=0;i<len;i++) {
+        h ^= d[i];
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static void dumpFrame(uint32_t ms, const pixel_t *out) {
+    const uint8_t *b = (const uint8_t *)(const void *)out;
+    printf("%8u", ms);
+    for (uint16_t i=0;i<PIXEL_CHAIN_LENGTH * sizeof(pixel_t);i++) {
+        printf("%s%02x", (i % sizeof(pixel_t)) ? "" : " ", b[i]);
+    }
+    printf("\n");
+}
+
+// Runs one case for frames frames, marking the digest every k. If
+// dump_from is set, prints frames from there until the next mark.
+static void run(golden_case_t &c, uint32_t frames, uint32_t k, int32_t dump_from = -1) {
+    varn_indices_t v;
+    memset(&v, 0, sizeof(v));
+    v.pattern_idx = c.pattern;
+    v.var0_idx    = c.var0;
+    v.sound_idx   = c.sound;
+
+    uint32_t lcg = c.seed;
+    host_hal.millis      = 0;
+    host_hal.analog_read = goldenRead;
+    host_hal.ctx         = &lcg;
+
+    c.marks.clear();
+    sim_c *sim = sim_c::create(c.seed, v);
+    uint32_t h = 2166136261UL;
+    uint32_t done = 0;
+    while (done < frames) {
+        sim->sample();
+        if (sim->due(host_hal.millis)) {
+            sim->render(host_hal.millis);
+            uint32_t ms = host_hal.millis;
+            h = fnv(h, (const uint8_t *)&ms, sizeof(ms));
+            h = fnv(h, (const uint8_t *)(const void *)sim->out(), PIXEL_CHAIN_LENGTH * sizeof(pixel_t));
+            if ((dump_from >= 0) && (done >= (uint32_t)dump_from) && (done < dump_from + k)) {
+                dumpFrame(ms, sim->out());
+            }
+            done++;
+            if (!(done % k)) c.marks.push_back(h);
+        }
+        host_hal.millis += SIM_LOOP_MS;
+    }
+    sim_c::destroy(sim);
+}
+
+static int make(int argc, char **argv) {
+    uint32_t frames = 512;
+    uint32_t k      = 64;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:")) != -1) {
+        switch (opt) {
+            case 'n': frames = strtoul(optarg, 0, 0); break;
+            case 'k': k      = strtoul(optarg, 0, 0); break;
+            default: return 2;
+        }
+    }
+    if (!k || (frames < k) || (frames / k > GOLDEN_MAX_MARKS)) {
+        fprintf(stderr, "need 1 to %u marks of k frames\n", GOLDEN_MAX_MARKS);
+        return 2;
+    }
+    frames -= frames % k;
+
+    printf("# golden frame digests, from host/golden make -n %u -k %u\n", frames, k);
+    printf("# pattern var0 sound seed, then the digest after every %u frames\n", k);
+    printf("frames %u every %u\n", frames, k);
+    for (uint8_t p=0;p<sim_c::SIM_PATTERNS;p++) {
+        for (uint8_t v=0;v<VARIATION_0_COUNT;v++) {
+            for (uint8_t s=0;s<GOLDEN_SOUND_MODES;s++) {
+                golden_case_t c;
+                c.pattern = p;
+                c.var0    = v;
+                c.sound   = s;
+                c.seed    = caseSeed(p, v, s);
+                run(c, frames, k);
+                printf("%2u %u %u %08x", p, v, s, c.seed);
+                for (size_t i=0;i<c.marks.size();i++) printf(" %08x", c.marks[i]);
+                printf("\n");
+            }
+        }
+    }
+    return 0;
+}
+
+static int check(int argc, char **argv) {
+    bool dump = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "d")) != -1) {
+        switch (opt) {
+            case 'd': dump = true; break;
+            default: return 2;
+        }
+    }
+    if (optind != argc - 1) return 2;
+    FILE *f = fopen(argv[optind], "r");
+    if (!f) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    char line[16 + 9 * GOLDEN_MAX_MARKS + 32];
+    unsigned frames = 0, k = 0;
+    uint32_t cases = 0, bad = 0;
+    bool covered[sim_c::SIM_PATTERNS] = { false };
+    while (fgets(line, sizeof(line), f)) {
+        if ((line[0] == '#') || (line[0] == '\n')) continue;
+        if (!k) {
+            if ((sscanf(line, "frames %u every %u", &frames, &k) != 2) || !k ||
+                (frames / k > GOLDEN_MAX_MARKS)) {
+                fprintf(stderr, "%s: no frames line\n", argv[optind]);
+                return 1;
+            }
+            continue;
+        }
+        unsigned p, v, s, seed;
+        int used;
+        if (sscanf(line, "%u %u %u %x%n", &p, &v, &s, &seed, &used) != 4) {
+            fprintf(stderr, "%s: bad line: %s", argv[optind], line);
+            return 1;
+        }
+        std::vector<uint32_t> want;
+        const char *rest = line + used;
+        unsigned d;
+        int n;
+        while (sscanf(rest, " %x%n", &d, &n) == 1) {
+            want.push_back(d);
+            rest += n;
+        }
+        if (p >= sim_c::SIM_PATTERNS) {
+            printf("pattern %u var0 %u sound %u: no such pattern\n", p, v, s);
+            bad++;
+            continue;
+        }
+        covered[p] = true;
+
+        golden_case_t c;
+        c.pattern = p;
+        c.var0    = v;
+        c.sound   = s;
+        c.seed    = seed;
+        run(c, frames, k);
+        cases++;
+        size_t i = 0;
+        while ((i < want.size()) && (i < c.marks.size()) && (want[i] == c.marks[i])) i++;
+        if ((i == want.size()) && (i == c.marks.size())) continue;
+
+        printf("pattern %u var0 %u sound %u: differs in frames %u-%u\n",
+               p, v, s, (unsigned)i * k, (unsigned)(i + 1) * k - 1);
+        if (dump && !bad) {
+            printf("# golden dump %u %u %u %u %u\n", p, v, s, (unsigned)i * k, k);
+            run(c, frames, k, i * k);
+        }
+        bad++;
+    }
+    fclose(f);
+    if (!k) {
+        fprintf(stderr, "%s: no frames line\n", argv[optind]);
+        return 1;
+    }
+    for (uint8_t p=0;p<sim_c::SIM_PATTERNS;p++) {
+        if (!covered[p]) printf("pattern %u: not in %s\n", p, argv[optind]);
+    }
+    printf("%u of %u cases differ, %u frames each\n", bad, cases, frames);
+    return bad ? 1 : 0;
+}
+
+static int dump(int argc, char **argv) {
+    if ((argc < 4) || (argc > 6)) return 2;
+    golden_case_t c;
+    c.pattern = atoi(argv[1]);
+    c.var0    = atoi(argv[2]);
+    c.sound   = atoi(argv[3]);
+    uint32_t from  = (argc > 4) ? strtoul(argv[4], 0, 0) : 0;
+    uint32_t count = (argc > 5) ? strtoul(argv[5], 0, 0) : 64;
+    if ((c.pattern >= sim_c::SIM_PATTERNS) || (c.var0 >= VARIATION_0_COUNT) ||
+        (c.sound >= GOLDEN_SOUND_MODES) || !count) {
+        fprintf(stderr, "setting out of range\n");
+        return 2;
+    }
+    c.seed = caseSeed(c.pattern, c.var0, c.sound);
+    printf("# %u pixels, seed 0x%08x, pattern %u var0 %u sound %u\n",
+           PIXEL_CHAIN_LENGTH, c.seed, c.pattern, c.var0, c.sound);
+    run(c, from + count, count, from);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int rv = 2;
+    if ((argc >= 2) && !strcmp(argv[1], "make")) {
+        rv = make(argc - 1, argv + 1);
+    } else if ((argc >= 2) && !strcmp(argv[1], "check")) {
+        rv = check(argc - 1, argv + 1);
+    } else if ((argc >= 2) && !strcmp(argv[1], "dump")) {
+        rv = dump(argc - 1, argv + 1);
+    }
+    if (rv == 2) {
+        fprintf(stderr, "usage: golden make [-n frames] [-k every] > golden.txt\n"
+                        "       golden check [-d] golden.txt\n"
+                        "       golden dump pattern var0 sound [from [count]]\n");
+    }
+    return rv;
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#include "Arduino.h"
+#include "stored.h"
+
+thread_local volatile uint8_t  ADMUX, ADCSRA, ADCL, ADCH, PORTD, TCNT0;
+thread_local volatile uint16_t TCNT1;
+thread_local volatile uint8_t  PINB = 0xff, PCMSK0, PCIFR, PCICR;
+
+thread_local host_hal_t host_hal;
+
+HardwareSerial Serial;
+
+// eeprom_writer_c (stored.h) writes straight through to this, which
+// starts out erased
+static thread_local uint8_t host_eeprom[E2END + 1];
+static thread_local bool    eeprom_erased;
+
+static void eepromErase() {
+    if (eeprom_erased) return;
+    memset(host_eeprom, 0xff, sizeof(host_eeprom));
+    eeprom_erased = true;
+}
+
+void eeprom_writer_c::write(uint16_t addr, uint8_t d) {
+    eepromErase();
+    host_eeprom[addr & E2END] = d;
+}
+
+uint8_t eeprom_writer_c::read(uint16_t addr) {
+    eepromErase();
+    return host_eeprom[addr & E2END];
+}
+
+bool eeprom_writer_c::done() {
+    return true;
+}
+
+void eeprom_writer_c::flush() {
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t, uint8_t) {
+}
+
+int digitalRead(uint8_t) {
+    return HIGH;
+}
+
+int analogRead(uint8_t pin) {
+    if (!host_hal.analog_read) return 0;
+    return host_hal.analog_read(host_hal.ctx, pin);
+}
+
+unsigned long millis() {
+    return host_hal.millis;
+}
+
+unsigned long micros() {
+    return host_hal.millis * 1000UL;
+}
+
+// time only moves when the host program says so
+void delay(unsigned long) {
+}
+
+void delayMicroseconds(unsigned int) {
+}
+
@@ -0,0 +1,141 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Checks the oscillators in osc.h where no pattern's golden frames
+// reach them:
+//
+//   osccheck
+//
+// - oscSmooth() lands on the sine8() table at every entry, stays
+//   between each entry and the next all the way across, and never
+//   goes back the way it came.
+//   It leaves the other waves as oscWave() has them.
+// - an osc_c moving a sixteenth of a table step a tick goes through
+//   smooth() with no step bigger than the table's own slope allows,
+//   where value() holds still and then jumps.
+// - osc_bank_c steps each of its oscillators as one on its own would
+//   be stepped, wrapping when it would.
+//
+// It prints each check and whether it passed, and exits 1 if any
+// failed.
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O2 -I. -I../snowflake_complete osccheck.cpp
+//       ../snowflake_complete/tables.cpp -o osccheck
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "osc.h"
+
+static bool failed = false;
+
+static void report(const char *name, bool ok) {
+    printf("%-36s %s\n", name, ok ? "ok" : "BAD");
+    if (!ok) failed = true;
+}
+
+static void endpoints() {
+    bool on_table = true, between = true, one_way = true;
+    for (uint16_t i=0;i<256;i++) {
+        uint8_t a = sine8(i);
+        uint8_t b = sine8(i + 1);
+        if (oscSmooth(OSC_SINE, i << 8) != a) on_table = false;
+        uint8_t lo = a < b ? a : b;
+        uint8_t hi = a < b ? b : a;
+        uint8_t last = a;
+        for (uint16_t f=0;f<256;f++) {
+            uint8_t v = oscSmooth(OSC_SINE, (i << 8) | f);
+            if ((v < lo) || (v > hi)) between = false;
+            if ((b >= a) ? (v < last) : (v > last)) one_way = false;
+            last = v;
+        }
+    }
+    report("smooth sine on the table", on_table);
+    report("smooth sine between entries", between);
+    report("smooth sine one way between entries", one_way);
+
+    bool same = true;
+    const osc_wave_t others[] = { OSC_TRIANGLE, OSC_SQUARE, OSC_SAW };
+    for (osc_wave_t w : others) {
+        for (uint32_t ph=0;ph<0x10000;ph++) {
+            if (oscSmooth(w, ph) != oscWave(w, ph)) same = false;
+        }
+    }
+    report("smooth leaves other waves alone", same);
+}
+
+static void slow() {
+    const uint16_t freq = 0x10;
+    // the most one table step moves the sine
+    uint8_t slope = 0;
+    for (uint16_t i=0;i<256;i++) {
+        uint8_t d = abs((int)sine8(i + 1) - (int)sine8(i));
+        if (d > slope) slope = d;
+    }
+    uint8_t most_smooth = 0, most_value = 0;
+    osc_c osc(freq);
+    uint8_t last_s = osc.smooth(OSC_SINE);
+    uint8_t last_v = osc.value(OSC_SINE);
+    for (uint32_t t=0;t<0x10000UL/freq;t++) {
+        osc.step();
+        uint8_t s = osc.smooth(OSC_SINE);
+        uint8_t v = osc.value(OSC_SINE);
+        uint8_t ds = abs((int)s - (int)last_s);
+        uint8_t dv = abs((int)v - (int)last_v);
+        if (ds > most_smooth) most_smooth = ds;
+        if (dv > most_value)  most_value  = dv;
+        last_s = s;
+        last_v = v;
+    }
+    // a sixteenth of the slope, and one for the rounding
+    report("smooth sine at 1/16 step a tick", most_smooth <= slope * freq / 0x100 + 1);
+    printf("    most a tick: smooth %u, value %u\n", most_smooth, most_value);
+}
+
+static void bank() {
+    const uint16_t freqs[3] = { 0x0123, 0x0800, 0x4000 };
+    osc_bank_c<3> b;
+    osc_c alone[3];
+    for (uint8_t i=0;i<3;i++) {
+        b[i].setFreq(freqs[i]);
+        b[i].setPhase(i * 0x1000);
+        alone[i].setFreq(freqs[i]);
+        alone[i].setPhase(i * 0x1000);
+    }
+    bool same = true;
+    uint16_t wraps[3] = { 0, 0, 0 };
+    for (uint32_t t=0;t<0x10000UL;t++) {
+        b.step();
+        for (uint8_t i=0;i<3;i++) {
+            alone[i].step();
+            if ((b[i].getPhase() != alone[i].getPhase()) ||
+                (b[i].wrapped() != alone[i].wrapped())) same = false;
+            if (b[i].wrapped()) wraps[i]++;
+        }
+    }
+    // over 0x10000 steps each goes round freq times, give or take the
+    // one it started partway into
+    bool rounds = true;
+    for (uint8_t i=0;i<3;i++) {
+        if ((wraps[i] < freqs[i] - 1) || (wraps[i] > freqs[i] + 1)) rounds = false;
+    }
+    report("bank steps as each alone", same);
+    report("bank wraps freq times in 0x10000", rounds);
+}
+
+int main() {
+    endpoints();
+    slow();
+    bank();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,405 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Times the pieces every pattern is built from: the pixel_t
+// arithmetic, the PixChain_c calls that go over the whole chain (for
+// chains of 30, 60 and 120), log2int(), scale2mask(), ema_c, and a
+// color by hue from color.h against one from three sine8()s, and a
+// palette lookup (palette.h), on its own and while fading, and the
+// two random number generators (sensors.h, prng.h), down to a
+// Fun_Sparkle_c tick's worth of masks made either way. It prints
+// JSON, which tools/bench_compare.py compares with a baseline such as
+// primbench_host.json, to catch a change that slows one down.
+//
+// On a PC it gives the best ns an op of several runs:
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -DNDEBUG -I. -I../snowflake_complete
+//       primbench.cpp hal.cpp ../snowflake_complete/helpers.cpp
+//       ../snowflake_complete/tables.cpp -o primbench
+//   ./primbench > now.json
+//   ../tools/bench_compare.py primbench_host.json now.json
+//
+// NOT YET WORKING: the __AVR__ half of this file is meant to give
+// exact cycles an op on the ATmega328P, timed with Timer1 at clk/1
+// with interrupts off, less what an empty op takes. It has never been
+// compiled with avr-g++, let alone run, and there is no AVR baseline
+// to compare with; expect to fix it up the first time it is built.
+// The intent is to build it with the Arduino core (for pinMode())
+// and the sketch's own helpers.cpp, as for the sketch, run it under
+// simavr, which quits when the program sleeps with interrupts off,
+// and keep what the UART says at 38400 baud as primbench_avr.json:
+//
+//   avr-g++ -std=gnu++11 -Os -mmcu=atmega328p -DF_CPU=8000000UL
+//       -DSERIAL_DEBUG -DNDEBUG -I<core> -I<variant> -I../snowflake_complete
+//       primbench.cpp ../snowflake_complete/helpers.cpp
+//       ../snowflake_complete/tables.cpp <core.a> -o primbench.elf
+//   simavr -m atmega328p -f 8000000 primbench.elf > avr.json
+
+#include <stdio.h>
+#include <stdint.h>
+#include <Arduino.h>
+
+#include "pixel.h"
+#include "pixchain.h"
+#include "helpers.h"
+#include "ema.h"
+#include "color.h"
+#include "palette.h"
+#include "settings.h"
+#include "sensors.h"
+
+#ifdef __AVR__
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#else
+#include <time.h>
+#endif
+
+// keeps the compiler from throwing away an op whose result is unused
+template<class T>
+static inline void keep(T &v) {
+    asm volatile("" : : "r"(&v) : "memory");
+}
+
+// the chain is never sent, so any pin will do
+const uint8_t BENCH_PIN = 4;
+
+// inputs that change from op to op, so nothing folds to a constant
+const uint8_t IN_LEN = 16;
+static pixel_t  in_pix[IN_LEN];
+static uint32_t in_u32[IN_LEN];
+static uint8_t  in_u8[IN_LEN];
+
+static void makeInputs() {
+    uint32_t x = 0x2545f491;
+    for (uint8_t i=0;i<IN_LEN;i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        in_u32[i] = x;
+        in_pix[i] = pixel_t(x >> 8);
+        in_u8[i]  = x >> 3;
+    }
+}
+
+static bool first_result = true;
+
+static void result(const char *name, uint8_t len, double v) {
+    printf("%s\n    \"%s", first_result ? "" : ",", name);
+    if (len) printf("/%u", len);
+#ifdef __AVR__
+    printf("\": %lu", (unsigned long)v);
+#else
+    printf("\": %.2f", v);
+#endif
+    first_result = false;
+}
+
+#ifdef __AVR__
+
+static int uartPut(char c, FILE *) {
+    while (!(UCSR0A & _BV(UDRE0)));
+    UDR0 = c;
+    return 0;
+}
+static FILE uart_out;
+
+static void platformBegin() {
+    UCSR0A = _BV(U2X0);
+    UBRR0  = (F_CPU / 8 / 38400) - 1;
+    UCSR0B = _BV(TXEN0);
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+    fdev_setup_stream(&uart_out, uartPut, 0, _FDEV_SETUP_WRITE);
+    stdout = &uart_out;
+    // the core runs Timer1 at /64 for PWM; count every clock instead
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+}
+
+static const uint8_t REPS = 8;
+
+// fewest cycles f took, over a few calls
+template<class F>
+static uint16_t cyclesOf(F f) {
+    uint16_t best = 0xffff;
+    for (uint8_t r=0;r<REPS;r++) {
+        uint8_t sreg = SREG;
+        cli();
+        uint16_t t0 = TCNT1;
+        f(r);
+        uint16_t t1 = TCNT1;
+        SREG = sreg;
+        if ((uint16_t)(t1 - t0) < best) best = t1 - t0;
+    }
+    return best;
+}
+
+static uint16_t overhead;
+static const uint32_t OPS = 1;
+
+// ops is how many to time on a PC; here each is timed on its own
+template<class F>
+static double measure(F f, uint32_t ops = OPS) {
+    uint16_t c = cyclesOf(f);
+    return (c > overhead) ? c - overhead : 0;
+}
+
+static void calibrate() {
+    overhead = cyclesOf([](uint8_t r) { keep(r); });
+}
+
+#else
+
+static void platformBegin() { }
+
+static double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static const uint8_t  RUNS  = 21;
+static const uint32_t OPS   = 1 << 17;
+
+// best ns an op of several runs of OPS calls, less the loop itself
+static double overhead;
+
+template<class F>
+static double nsOf(F f, uint32_t ops) {
+    double best = 1e30;
+    for (uint8_t r=0;r<RUNS;r++) {
+        double t0 = nowNs();
+        for (uint32_t i=0;i<ops;i++) f((uint8_t)i);
+        double ns = (nowNs() - t0) / ops;
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+template<class F>
+static double measure(F f, uint32_t ops = OPS) {
+    double ns = nsOf(f, ops) - overhead;
+    return (ns > 0) ? ns : 0;
+}
+
+static void calibrate() {
+    overhead = nsOf([](uint8_t r) { keep(r); }, OPS);
+}
+
+#endif
+
+static void pixelBench() {
+    result("pixel.scale", 0, measure([](uint8_t r) {
+        pixel_t p = in_pix[r & (IN_LEN-1)];
+        p.scale(in_u8[r & (IN_LEN-1)]);
+        keep(p);
+    }));
+    result("pixel.mix", 0, measure([](uint8_t r) {
+        pixel_t p;
+        p.mix(in_pix[r & (IN_LEN-1)], in_pix[(r+1) & (IN_LEN-1)], in_u8[r & (IN_LEN-1)]);
+        keep(p);
+    }));
+    result("pixel.add", 0, measure([](uint8_t r) {
+        pixel_t p = in_pix[r & (IN_LEN-1)];
+        p.add(in_pix[(r+3) & (IN_LEN-1)]);
+        keep(p);
+    }));
+    result("pixel.from_u32", 0, measure([](uint8_t r) {
+        pixel_t p(in_u32[r & (IN_LEN-1)]);
+        keep(p);
+    }));
+}
+
+static void colorBench() {
+    result("color.hsv16", 0, measure([](uint8_t r) {
+        pixel_t p = hsv16(in_u32[r & (IN_LEN-1)], in_u8[r & (IN_LEN-1)], 0xff);
+        keep(p);
+    }));
+    result("color.hsl16", 0, measure([](uint8_t r) {
+        pixel_t p = hsl16(in_u32[r & (IN_LEN-1)], 0xff, in_u8[r & (IN_LEN-1)]);
+        keep(p);
+    }));
+    // what Fun_Rainbow_c does for each pixel
+    result("color.three_sine", 0, measure([](uint8_t r) {
+        uint8_t h = in_u8[r & (IN_LEN-1)];
+        pixel_t p(sine8(h), sine8(h + 85), sine8(h + 170));
+        keep(p);
+    }));
+    result("palette.lookup", 0, measure([](uint8_t r) {
+        pixel_t p = paletteColor(r & (PAL_COUNT-1), in_u8[r & (IN_LEN-1)]);
+        keep(p);
+    }));
+    static palette_fader_c fader;
+    fader.jump(PAL_FIRE);
+    fader.fadeTo(PAL_OCEAN, 1);
+    fader.step();
+    result("palette.fading", 0, measure([](uint8_t r) {
+        pixel_t p = fader.color(in_u8[r & (IN_LEN-1)]);
+        keep(p);
+    }));
+}
+
+static void tableBench() {
+    result("table.sine8", 0, measure([](uint8_t r) {
+        uint8_t v = sine8(in_u8[r & (IN_LEN-1)]);
+        keep(v);
+    }));
+    result("table.named_color", 0, measure([](uint8_t r) {
+        pixel_t p((pixel_color_t)(in_u8[r & (IN_LEN-1)] & 0xf));
+        keep(p);
+    }));
+    // what loop() looks up for every frame
+    result("table.frame_settings", 0, measure([](uint8_t r) {
+        varn_indices_t v;
+        v.brite_idx = r % getLength(brightnesses);
+        v.delay_idx = r % getLength(delays);
+        uint8_t  s = frameScale(v, in_u32[r & (IN_LEN-1)] & 0x1ff);
+        uint16_t d = delays[v.delay_idx];
+        keep(s);
+        keep(d);
+    }));
+}
+
+static void prngBench() {
+    static Sensors_c<A0, A1, A2, A3> sensors;
+    sensors.seed(in_u32[0]);
+    result("prng.rand32", 0, measure([](uint8_t) {
+        uint32_t v = sensors.rand32();
+        keep(v);
+    }));
+    result("prng.rand16", 0, measure([](uint8_t) {
+        uint16_t v = sensors.rand16();
+        keep(v);
+    }));
+    result("prng.randBits4", 0, measure([](uint8_t) {
+        uint8_t v = sensors.randBits(4);
+        keep(v);
+    }));
+    result("prng.randRange", PIXEL_CHAIN_LENGTH, measure([](uint8_t) {
+        uint8_t v = sensors.randRange(PIXEL_CHAIN_LENGTH);
+        keep(v);
+    }));
+    // Fun_Sparkle_c's two masks at var0_idx 7, as it used to make them
+    // and as it does now
+    result("prng.sparkle_rand32", PIXEL_CHAIN_LENGTH, measure([](uint8_t) {
+        uint32_t a = 0xffffffff;
+        uint32_t b = 0xffffffff;
+        for (uint8_t i=0;i<8;i++) {
+            a &= sensors.rand32();
+            b &= sensors.rand32();
+        }
+        keep(a);
+        keep(b);
+    }));
+    result("prng.sparkle_mask", PIXEL_CHAIN_LENGTH, measure([](uint8_t) {
+        uint32_t a = sensors.randomMask(PIXEL_CHAIN_LENGTH, 1);
+        uint32_t b = sensors.randomMask(PIXEL_CHAIN_LENGTH, 1);
+        keep(a);
+        keep(b);
+    }));
+}
+
+static void helperBench() {
+    result("log2int", 0, measure([](uint8_t r) {
+        uint32_t v = log2int(in_u32[r & (IN_LEN-1)]);
+        keep(v);
+    }));
+    result("scale2mask", PIXEL_CHAIN_LENGTH, measure([](uint8_t r) {
+        uint32_t m = scale2mask<0,3100,PIXEL_CHAIN_LENGTH,ALL_LIGHTS_MSK>(in_u32[r & (IN_LEN-1)] & 0xfff);
+        keep(m);
+    }));
+    static ema_c<uint16_t, uint32_t, 1, 32> ema;
+    ema.init(0);
+    result("ema.update", 0, measure([](uint8_t r) {
+        uint16_t v = ema.update(in_u32[r & (IN_LEN-1)] & 0x3ff);
+        keep(v);
+    }));
+}
+
+// The chain is on the stack and gone before the next is made; all
+// three at once would not fit in the AVR's 2KB.
+template<uint8_t N>
+static void chainBench() {
+    PixChain_c<N, BENCH_PIN> chain;
+    // a whole-chain op takes about N times as long as a pixel op
+    const uint32_t ops = OPS / N;
+    for (uint8_t i=0;i<N;i++) chain.set(i, in_pix[i & (IN_LEN-1)]);
+
+    result("chain.set", N, measure([&chain](uint8_t r) {
+        chain.set(r % N, in_pix[r & (IN_LEN-1)]);
+        keep(chain);
+    }));
+    result("chain.setAll", N, measure([&chain](uint8_t r) {
+        chain.setAll(in_pix[r & (IN_LEN-1)]);
+        keep(chain);
+    }, ops));
+    result("chain.rotate", N, measure([&chain](uint8_t r) {
+        chain.rotate(1, r & 1, ROTATE_ALL);
+        keep(chain);
+    }, ops));
+    result("chain.rotate_inner", N, measure([&chain](uint8_t r) {
+        chain.rotate(1, r & 1, ROTATE_INNER);
+        keep(chain);
+    }, ops));
+    result("chain.rotate_outer", N, measure([&chain](uint8_t r) {
+        chain.rotate(1, r & 1, ROTATE_OUTER);
+        keep(chain);
+    }, ops));
+    result("chain.copyToOut", N, measure([&chain](uint8_t r) {
+        chain.copyToOut(in_u32[r & (IN_LEN-1)], in_u8[r & (IN_LEN-1)]);
+        keep(chain);
+    }, ops));
+    result("chain.average", N, measure([&chain](uint8_t r) {
+        pixel_t p = chain.average(r % N, (r + 7) % N);
+        keep(p);
+    }));
+}
+
+static void run() {
+    platformBegin();
+    makeInputs();
+    calibrate();
+#ifdef __AVR__
+    printf("{\n  \"target\": \"avr\",\n  \"unit\": \"cycles\",\n  \"results\": {");
+#else
+    printf("{\n  \"target\": \"host\",\n  \"unit\": \"ns\",\n  \"results\": {");
+#endif
+    pixelBench();
+    helperBench();
+    colorBench();
+    tableBench();
+    prngBench();
+    chainBench<30>();
+    chainBench<60>();
+    chainBench<120>();
+    printf("\n  }\n}\n");
+}
+
+#ifdef __AVR__
+
+void setup() {
+    run();
+    while (!(UCSR0A & _BV(TXC0)));
+    cli();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sleep_cpu();
+}
+
+void loop() { }
+
+#else
+
+int main() {
+    run();
+    return 0;
+}
+
+#endif
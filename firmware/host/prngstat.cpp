@@ -0,0 +1,113 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Checks that every bit prng_c (prng.h) hands out comes up as often
+// as it should, drawn the way the patterns draw them: two 30-bit
+// masks a tick for Fun_Sparkle_c at each var0's density, and runs of
+// randBits() of the widths the patterns ask for. A bit that sticks, or
+// that follows the tick, shows up here long before it does on a unit.
+//
+//   prngstat [-n ticks] [-S seed]
+//
+// For each case it prints the odds a bit should be set, and the
+// fewest and most times any one bit was, over the ticks. It exits 1
+// if a bit is further from the odds than chance would put it.
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O2 -I. -I../snowflake_complete prngstat.cpp
+//       -o prngstat
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "prng.h"
+
+const uint8_t MASK_BITS = 30;
+
+static bool failed = false;
+
+// counts[] of n bits, each set with odds p, over ticks
+static void report(const char *name, const uint32_t *counts, uint8_t n,
+                   double p, uint32_t ticks) {
+    uint32_t lo = ticks, hi = 0;
+    for (uint8_t i=0;i<n;i++) {
+        if (counts[i] < lo) lo = counts[i];
+        if (counts[i] > hi) hi = counts[i];
+    }
+    // six sigma, so that a good generator all but never trips it
+    double want  = p * ticks;
+    double slack = 6.0 * sqrt(ticks * p * (1.0 - p)) + 1.0;
+    bool   bad   = (lo < want - slack) || (hi > want + slack);
+    printf("%-14s %9.5f %9.5f %9.5f%s\n", name, p,
+           (double)lo / ticks, (double)hi / ticks, bad ? "  BAD" : "");
+    if (bad) failed = true;
+}
+
+static void sparkle(uint32_t seed, uint32_t ticks) {
+    for (uint8_t var0=0;var0<8;var0++) {
+        uint8_t  density = 0x80 >> var0;
+        uint32_t counts[2 * MASK_BITS];
+        memset(counts, 0, sizeof(counts));
+        prng_c prng(seed);
+        for (uint32_t t=0;t<ticks;t++) {
+            uint32_t a = prng.randomMask(MASK_BITS, density);
+            uint32_t b = prng.randomMask(MASK_BITS, density);
+            for (uint8_t i=0;i<MASK_BITS;i++) {
+                counts[i]             += (a >> i) & 0x1;
+                counts[MASK_BITS + i] += (b >> i) & 0x1;
+            }
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "sparkle/%u", var0);
+        report(name, counts, 2 * MASK_BITS, density / 256.0, ticks);
+    }
+}
+
+static void bits(uint32_t seed, uint32_t ticks) {
+    static const uint8_t widths[] = { 2, 3, 4, 6 };
+    for (uint8_t w : widths) {
+        uint32_t counts[8];
+        memset(counts, 0, sizeof(counts));
+        prng_c prng(seed);
+        for (uint32_t t=0;t<ticks;t++) {
+            uint8_t r = prng.randBits(w);
+            for (uint8_t i=0;i<w;i++) counts[i] += (r >> i) & 0x1;
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "randBits/%u", w);
+        report(name, counts, w, 0.5, ticks);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t ticks = 1UL << 16;
+    uint32_t seed  = 1337;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:S:")) != -1) {
+        switch (opt) {
+            case 'n': ticks = strtoul(optarg, 0, 0); break;
+            case 'S': seed  = strtoul(optarg, 0, 0); break;
+            default:
+                fprintf(stderr, "usage: prngstat [-n ticks] [-S seed]\n");
+                return 2;
+        }
+    }
+
+    printf("%-14s %9s %9s %9s\n", "case", "odds", "fewest", "most");
+    sparkle(seed, ticks);
+    bits(seed, ticks);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __sim_h
+#define __sim_h
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <new>
+#include "settings.h"
+#include "sensors.h"
+#include "pixchain.h"
+#include "fun_stuff.h"
+#include "vm.h"
+#include "vm_progs.h"
+#include "clip.h"
+#include "clips.h"
+#include "palette.h"
+#include "patterns.h"
+
+// One snowflake, less the buttons, IR, power control and EEPROM: the
+// patterns, the sensors and the frame shaping, put together the way
+// loop() does it. The host program owns the clock and the ADC (see
+// Arduino.h), so two runs fed the same seed and readings produce the
+// same frames.
+
+// same pins as the sketch, so that readings can be told apart
+const uint8_t SIM_PIXEL_PIN = 4;
+const uint8_t SIM_LIGHT_PIN = A1;
+const uint8_t SIM_SOUND_PIN = A0;
+const uint8_t SIM_NOISE_PIN = A7;
+const uint8_t SIM_RF_PIN    = A6;
+
+// about how long a trip through loop() takes when it does not render,
+// which is mostly the 2ms settling delay in myVcc()
+const uint8_t SIM_LOOP_MS   = 3;
+
+typedef PixChain_c<PIXEL_CHAIN_LENGTH, SIM_PIXEL_PIN> sim_pixchain_t;
+typedef Sensors_c<SIM_LIGHT_PIN, SIM_SOUND_PIN, SIM_NOISE_PIN, SIM_RF_PIN> sim_sensors_t;
+
+class sim_c {
+    public:
+    // On the AVR all of this is global, so it starts out zeroed, and
+    // not every member is set by its constructor. Make sims with
+    // create() so that they start out the same way, every time.
+    static sim_c *create(uint32_t seed, const varn_indices_t &v) {
+        void *m = calloc(1, sizeof(sim_c));
+        return m ? new (m) sim_c(seed, v) : 0;
+    }
+    static void destroy(sim_c *s) {
+        if (!s) return;
+        s->~sim_c();
+        free(s);
+    }
+
+    private:
+    // Reads the light and sound sensors once each to prime their
+    // filters, as the sketch does at boot.
+    sim_c(uint32_t seed, const varn_indices_t &v) :
+        varns(v), ll(0), sl(0), msk(ALL_LIGHTS_MSK), scl(0), last_tick(0)
+#define SIM_PATTERN_INIT(name, cls, ...) , fun_##name(pixels, sensors, varns, ##__VA_ARGS__)
+        SNOWFLAKE_PATTERNS(SIM_PATTERN_INIT) {
+#undef SIM_PATTERN_INIT
+
+        // the same order as patterns[] in the sketch, from patterns.h
+        uint8_t n = 0;
+#define SIM_PATTERN_ADDR(name, ...) patterns[n++] = &fun_##name;
+        SNOWFLAKE_PATTERNS(SIM_PATTERN_ADDR)
+#undef SIM_PATTERN_ADDR
+
+        if (varns.pattern_idx >= SIM_PATTERNS) varns.pattern_idx = 0;
+        pixels.clear();
+        sensors.seed(seed);
+        patterns[varns.pattern_idx]->init();
+    }
+
+    public:
+    void setSettings(const varn_indices_t &v) {
+        bool new_pattern = v.pattern_idx != varns.pattern_idx;
+        varns = v;
+        if (varns.pattern_idx >= SIM_PATTERNS) varns.pattern_idx = 0;
+        if (new_pattern) patterns[varns.pattern_idx]->init();
+    }
+    const varn_indices_t &settings() const {
+        return varns;
+    }
+
+    // the top of loop(), every time around
+    void sample() {
+        ll  = sensors.light();
+        sl  = sensors.sound();
+        scl = frameScale(varns, ll);
+        msk = frameMask(varns, sl, thresh);
+    }
+
+    bool due(uint32_t now) const {
+        return (now - last_tick) > delays[varns.delay_idx];
+    }
+
+    void render(uint32_t now) {
+        tick(now);
+        copyOut();
+    }
+
+    // render() in two halves, for a caller that does its own output
+    // from work(), mask() and scale(), or checks it against copyOut()
+    void tick(uint32_t now) {
+        patterns[varns.pattern_idx]->tick();
+        last_tick = now;
+    }
+    void copyOut() {
+        pixels.copyToOut(msk, scl);
+    }
+    pixel_t *work() {
+        return pixels.getAll();
+    }
+    uint32_t mask() const {
+        return msk;
+    }
+    uint8_t scale() const {
+        return scl;
+    }
+    // PixChain_c::load() of the frame just rendered
+    uint32_t load() const {
+        return pixels.load(msk);
+    }
+
+    // PIXEL_CHAIN_LENGTH pixels, as they would go out on the wire
+    const pixel_t *out() const {
+        return pixels.getOut();
+    }
+
+    static const uint8_t SIM_PATTERNS = PATTERN_COUNT;
+    // the one the buttons change settings with
+    static const uint8_t SIM_SETTINGS_IDX = PAT_settings;
+
+    private:
+    varn_indices_t varns;
+    sim_pixchain_t pixels;
+    sim_sensors_t  sensors;
+    uint16_t       ll, sl;
+    uint32_t       msk;
+    uint8_t        scl;
+    thresholder_c  thresh;
+    uint32_t       last_tick;
+
+#define SIM_PATTERN_OBJECT(name, cls, ...) \
+    cls<sim_pixchain_t, sim_sensors_t, varn_indices_t> fun_##name;
+    SNOWFLAKE_PATTERNS(SIM_PATTERN_OBJECT)
+#undef SIM_PATTERN_OBJECT
+
+    Fun_Base_c<sim_pixchain_t, sim_sensors_t, varn_indices_t> *patterns[SIM_PATTERNS];
+};
+
+#endif
+
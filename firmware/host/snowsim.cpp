@@ -0,0 +1,364 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Records and plays back frame streams (see framestream.h).
+//
+//   snowsim capture [options] out.snfs
+//       -p pattern  -v variation  -d delay_idx  -b brite_idx
+//       -s sound_idx  -S seed  -n frames  -a readings.txt
+//   snowsim replay in.snfs     run it again, check every frame
+//   snowsim diff a.snfs b.snfs
+//   snowsim dump in.snfs
+//
+// readings.txt has a light and a sound reading (raw ADC counts) per
+// line, used in turn and over again. Without it the readings are made
+// up from the seed.
+//
+// To build, from this directory (without NDEBUG, so that a pattern
+// that strays off the end of the chain asserts, where the AVR build
+// would quietly wrap round):
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -I. -I../snowflake_complete
+//       snowsim.cpp hal.cpp ../snowflake_complete/helpers.cpp
+//       ../snowflake_complete/tables.cpp -o snowsim
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <deque>
+#include <vector>
+
+#include "sim.h"
+#include "framestream.h"
+
+typedef struct file_sink_t {
+    FILE *f;
+    void put(uint8_t c) { fputc(c, f); }
+} file_sink_t;
+
+typedef struct file_source_t {
+    FILE *f;
+    int get() { return fgetc(f); }
+} file_source_t;
+
+typedef fs_writer_c<file_sink_t>   fs_file_writer_t;
+typedef fs_reader_c<file_source_t> fs_file_reader_t;
+
+
+// Where capture gets its readings from, and records them as it goes.
+typedef struct capture_adc_t {
+    fs_file_writer_t *writer;
+    std::vector<uint16_t> trace; // light, sound, light, sound, ...
+    size_t   light_pos, sound_pos;
+    uint32_t lcg;
+} capture_adc_t;
+
+static uint16_t capture_read(void *ctx, uint8_t pin) {
+    capture_adc_t *adc = (capture_adc_t *)ctx;
+    bool is_sound = pin == SIM_SOUND_PIN;
+    uint16_t v;
+    if (adc->trace.size() >= 2) {
+        size_t &pos = is_sound ? adc->sound_pos : adc->light_pos;
+        v = adc->trace[(2 * pos + is_sound) % adc->trace.size()];
+        pos++;
+    } else {
+        adc->lcg = adc->lcg * 1103515245UL + 12345UL;
+        uint16_t r = adc->lcg >> 16;
+        // a dim room, and a microphone mostly hearing hiss with the
+        // odd loud bit
+        v = is_sound ? (r & 0x7) ? 480 + (r & 0x3f) : 200 + (r & 0x3ff)
+                     : 300 + (r & 0xf);
+    }
+    adc->writer->analog(pin, v);
+    return v;
+}
+
+static int capture(int argc, char **argv) {
+    varn_indices_t v;
+    memset(&v, 0, sizeof(v));
+    uint32_t seed   = DEFAULT_SEED_V;
+    uint32_t frames = 1000;
+    const char *readings = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:v:d:b:s:S:n:a:")) != -1) {
+        switch (opt) {
+            case 'p': v.pattern_idx = atoi(optarg); break;
+            case 'v': v.var0_idx    = atoi(optarg); break;
+            case 'd': v.delay_idx   = atoi(optarg); break;
+            case 'b': v.brite_idx   = atoi(optarg); break;
+            case 's': v.sound_idx   = atoi(optarg); break;
+            case 'S': seed          = strtoul(optarg, 0, 0); break;
+            case 'n': frames        = strtoul(optarg, 0, 0); break;
+            case 'a': readings      = optarg; break;
+            default: return 2;
+        }
+    }
+    if (optind != argc - 1) return 2;
+    if ((v.pattern_idx >= sim_c::SIM_PATTERNS) ||
+        (v.delay_idx   >= getLength(delays)) ||
+        (v.brite_idx   >= getLength(brightnesses)) ||
+        (v.var0_idx    >= VARIATION_0_COUNT) ||
+        (v.sound_idx   >  SOUND_FLASH)) {
+        fprintf(stderr, "setting out of range\n");
+        return 2;
+    }
+
+    file_sink_t sink = { fopen(argv[optind], "wb") };
+    if (!sink.f) {
+        perror(argv[optind]);
+        return 1;
+    }
+    fs_file_writer_t writer(sink);
+
+    capture_adc_t adc;
+    adc.writer = &writer;
+    adc.light_pos = adc.sound_pos = 0;
+    adc.lcg    = seed;
+    if (readings) {
+        FILE *rf = fopen(readings, "r");
+        if (!rf) {
+            perror(readings);
+            return 1;
+        }
+        unsigned l, s;
+        while (fscanf(rf, "%u %u", &l, &s) == 2) {
+            adc.trace.push_back(l);
+            adc.trace.push_back(s);
+        }
+        fclose(rf);
+    }
+
+    host_hal.millis      = 0;
+    host_hal.analog_read = capture_read;
+    host_hal.ctx         = &adc;
+
+    if (!writer.header(PIXEL_CHAIN_LENGTH, seed, &v, sizeof(v))) {
+        fprintf(stderr, "a chain of %u is too long to capture\n", PIXEL_CHAIN_LENGTH);
+        return 1;
+    }
+    sim_c *sim = sim_c::create(seed, v);
+    uint32_t done = 0;
+    while (done < frames) {
+        sim->sample();
+        if (sim->due(host_hal.millis)) {
+            sim->render(host_hal.millis);
+            writer.frame(host_hal.millis, sim->out());
+            done++;
+        }
+        host_hal.millis += SIM_LOOP_MS;
+    }
+    sim_c::destroy(sim);
+    writer.end();
+    fclose(sink.f);
+    return 0;
+}
+
+
+// Replay hands back the recorded readings in order.
+typedef struct reading_t {
+    uint8_t  pin;
+    uint16_t value;
+} reading_t;
+
+typedef struct replay_adc_t {
+    std::deque<reading_t> q;
+    bool mismatch;
+} replay_adc_t;
+
+static uint16_t replay_read(void *ctx, uint8_t pin) {
+    replay_adc_t *adc = (replay_adc_t *)ctx;
+    if (adc->q.empty()) {
+        adc->mismatch = true;
+        return 0;
+    }
+    if (adc->q.front().pin != pin) adc->mismatch = true;
+    uint16_t v = adc->q.front().value;
+    adc->q.pop_front();
+    return v;
+}
+
+static bool openStream(const char *fn, file_source_t &src, fs_file_reader_t &rdr) {
+    src.f = fopen(fn, "rb");
+    if (!src.f) {
+        perror(fn);
+        return false;
+    }
+    if (!rdr.header()) {
+        fprintf(stderr, "%s: not a frame stream\n", fn);
+        return false;
+    }
+    return true;
+}
+
+static varn_indices_t toSettings(const uint8_t *d, uint8_t len) {
+    varn_indices_t v;
+    memset(&v, 0, sizeof(v));
+    memcpy(&v, d, len < sizeof(v) ? len : sizeof(v));
+    return v;
+}
+
+static int replay(const char *fn) {
+    file_source_t src;
+    fs_file_reader_t rdr(src);
+    if (!openStream(fn, src, rdr)) return 1;
+    if (rdr.hdr.chain_len != PIXEL_CHAIN_LENGTH) {
+        fprintf(stderr, "recorded with %u pixels, not %u\n", rdr.hdr.chain_len, PIXEL_CHAIN_LENGTH);
+        return 1;
+    }
+
+    replay_adc_t adc;
+    adc.mismatch = false;
+    host_hal.millis      = 0;
+    host_hal.analog_read = replay_read;
+    host_hal.ctx         = &adc;
+
+    varn_indices_t v = toSettings(rdr.hdr.settings, rdr.hdr.settings_len);
+    // made when the first frame turns up, once the readings it takes
+    // at boot are in hand
+    sim_c *sim = 0;
+    uint32_t frame = 0;
+
+    while (true) {
+        fs_read_e r = rdr.next();
+        if (r == FS_READ_END) break;
+        switch (r) {
+            case FS_READ_ANALOG: {
+                reading_t a = { rdr.analog_pin, rdr.analog_value };
+                adc.q.push_back(a);
+                break;
+            }
+            case FS_READ_SETTINGS:
+                v = toSettings(rdr.settings, rdr.settings_len);
+                if (sim) sim->setSettings(v);
+                break;
+            case FS_READ_FRAME:
+                host_hal.millis = rdr.now_ms;
+                if (!sim) sim = sim_c::create(rdr.hdr.seed, v);
+                while (adc.q.size() >= 2) sim->sample();
+                sim->render(rdr.now_ms);
+                if (adc.mismatch || !adc.q.empty()) {
+                    fprintf(stderr, "frame %u: readings out of step\n", frame);
+                    return 1;
+                }
+                if (memcmp(sim->out(), rdr.pix, PIXEL_CHAIN_LENGTH * FS_BYTES_PER_PIX)) {
+                    const uint8_t *got = (const uint8_t *)(const void *)sim->out();
+                    for (uint8_t i=0;i<PIXEL_CHAIN_LENGTH * FS_BYTES_PER_PIX;i++) {
+                        if (got[i] != rdr.pix[i]) {
+                            fprintf(stderr, "frame %u (%ums) pixel %u: recorded %02x%02x%02x, replayed %02x%02x%02x\n",
+                                    frame, rdr.now_ms, i / FS_BYTES_PER_PIX,
+                                    rdr.pix[i - i % 3], rdr.pix[i - i % 3 + 1], rdr.pix[i - i % 3 + 2],
+                                    got[i - i % 3], got[i - i % 3 + 1], got[i - i % 3 + 2]);
+                            break;
+                        }
+                    }
+                    return 1;
+                }
+                frame++;
+                break;
+            default:
+                fprintf(stderr, "%s: bad record after frame %u\n", fn, frame);
+                return 1;
+        }
+    }
+    sim_c::destroy(sim);
+    fclose(src.f);
+    printf("%u frames replayed exactly\n", frame);
+    return 0;
+}
+
+
+// next frame in the stream, skipping everything else
+static bool nextFrame(fs_file_reader_t &rdr) {
+    while (true) {
+        fs_read_e r = rdr.next();
+        if (r == FS_READ_FRAME) return true;
+        if ((r == FS_READ_END) || (r == FS_READ_ERROR)) return false;
+    }
+}
+
+static int diff(const char *fna, const char *fnb) {
+    file_source_t srca, srcb;
+    fs_file_reader_t a(srca), b(srcb);
+    if (!openStream(fna, srca, a) || !openStream(fnb, srcb, b)) return 1;
+    if (a.hdr.chain_len != b.hdr.chain_len) {
+        printf("chain lengths differ: %u, %u\n", a.hdr.chain_len, b.hdr.chain_len);
+        return 1;
+    }
+
+    uint32_t frame = 0, differ = 0;
+    const uint16_t nbytes = a.hdr.chain_len * FS_BYTES_PER_PIX;
+    while (true) {
+        bool ha = nextFrame(a);
+        bool hb = nextFrame(b);
+        if (ha != hb) {
+            printf("%s ends after %u frames\n", ha ? fnb : fna, frame);
+            differ++;
+        }
+        if (!ha || !hb) break;
+        if ((a.now_ms != b.now_ms) || memcmp(a.pix, b.pix, nbytes)) {
+            if (differ < 20) {
+                printf("frame %u (%ums, %ums):", frame, a.now_ms, b.now_ms);
+                for (uint8_t i=0;i<a.hdr.chain_len;i++) {
+                    if (memcmp(a.pix + i * FS_BYTES_PER_PIX, b.pix + i * FS_BYTES_PER_PIX, FS_BYTES_PER_PIX)) {
+                        printf(" %u", i);
+                    }
+                }
+                printf("\n");
+            }
+            differ++;
+        }
+        frame++;
+    }
+    printf("%u of %u frames differ\n", differ, frame);
+    return differ ? 1 : 0;
+}
+
+static int dump(const char *fn) {
+    file_source_t src;
+    fs_file_reader_t rdr(src);
+    if (!openStream(fn, src, rdr)) return 1;
+    printf("# %u pixels, seed 0x%08x, settings", rdr.hdr.chain_len, rdr.hdr.seed);
+    for (uint8_t i=0;i<rdr.hdr.settings_len;i++) printf(" %u", rdr.hdr.settings[i]);
+    printf("\n");
+    while (nextFrame(rdr)) {
+        printf("%8u", rdr.now_ms);
+        for (uint16_t i=0;i<rdr.hdr.chain_len * FS_BYTES_PER_PIX;i++) {
+            printf("%s%02x", (i % FS_BYTES_PER_PIX) ? "" : " ", rdr.pix[i]);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+
+int main(int argc, char **argv) {
+    int rv = 2;
+    if ((argc >= 2) && !strcmp(argv[1], "capture")) {
+        rv = capture(argc - 1, argv + 1);
+    } else if ((argc == 3) && !strcmp(argv[1], "replay")) {
+        rv = replay(argv[2]);
+    } else if ((argc == 4) && !strcmp(argv[1], "diff")) {
+        rv = diff(argv[2], argv[3]);
+    } else if ((argc == 3) && !strcmp(argv[1], "dump")) {
+        rv = dump(argv[2]);
+    }
+    if (rv == 2) {
+        fprintf(stderr, "usage: snowsim capture [-p pat] [-v var] [-d delay] [-b brite] [-s sound]\n"
+                        "                       [-S seed] [-n frames] [-a readings.txt] out.snfs\n"
+                        "       snowsim replay in.snfs\n"
+                        "       snowsim diff a.snfs b.snfs\n"
+                        "       snowsim dump in.snfs\n");
+    }
+    return rv;
+}
+
@@ -0,0 +1,257 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Sends frames to a snowflake built with STREAM_ENABLE (see stream.h),
+// or checks the protocol end to end without one.
+//
+//   streamsend [-b baud] [-p pixels] [-n frames] /dev/ttyUSB0
+//
+// sends a moving rainbow, waiting for the ack after each frame, and
+// reports the frame rate and round trip times.
+//
+//   streamsend -L [-b baud] [-p pixels] [-n frames] [-e every]
+//
+// is the loopback: frames go byte by byte through the same stream_c
+// the receive interrupt uses, with every e'th one corrupted, and each
+// is checked on the way out. It reports how fast the parser runs here
+// and the frame rate the wire and show() allow at that baud.
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -DNDEBUG -I. -I../snowflake_complete
+//       streamsend.cpp hal.cpp ../snowflake_complete/helpers.cpp -o streamsend
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <poll.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#include "stream.h"
+
+// show() takes about this long a pixel, with interrupts off
+const double SHOW_US_PER_PIXEL = 30.0;
+// and loop() can take this long to notice a frame has come in
+const unsigned LOOP_MS = 3;
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void rainbow(std::vector<uint8_t> &grb, uint8_t n, uint32_t f) {
+    for (uint8_t i=0;i<n;i++) {
+        uint8_t h = (uint8_t)(i * 256 / n + f * 3);
+        uint8_t r = h < 85 ? 255 - h * 3 : h < 170 ? 0 : (h - 170) * 3;
+        uint8_t g = h < 85 ? h * 3 : h < 170 ? 255 - (h - 85) * 3 : 0;
+        uint8_t b = h < 85 ? 0 : h < 170 ? (h - 85) * 3 : 255 - (h - 170) * 3;
+        grb[i*3+0] = g;
+        grb[i*3+1] = r;
+        grb[i*3+2] = b;
+    }
+}
+
+static speed_t baudConst(uint32_t baud) {
+    switch (baud) {
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+#ifdef B500000
+        case 500000:  return B500000;
+#endif
+#ifdef B1000000
+        case 1000000: return B1000000;
+#endif
+        default:      return 0;
+    }
+}
+
+static int openPort(const char *path, uint32_t baud) {
+    speed_t sp = baudConst(baud);
+    if (!sp) {
+        fprintf(stderr, "%u baud is not supported here\n", baud);
+        return -1;
+    }
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct termios t;
+    tcgetattr(fd, &t);
+    cfmakeraw(&t);
+    cfsetispeed(&t, sp);
+    cfsetospeed(&t, sp);
+    t.c_cflag |= CLOCAL | CREAD;
+    t.c_cflag &= ~CRTSCTS;
+    t.c_cc[VMIN]  = 0;
+    t.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &t);
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int send(const char *path, uint32_t baud, uint8_t n, uint32_t frames) {
+    int fd = openPort(path, baud);
+    if (fd < 0) return 1;
+    // opening the port resets most Arduinos
+    sleep(2);
+    tcflush(fd, TCIFLUSH);
+
+    std::vector<uint8_t> grb(n * 3);
+    std::vector<uint8_t> buf(STREAM_HDR_LEN + n * 3 + 1);
+    std::vector<double>  rtt;
+    uint32_t lost = 0;
+    double start = nowSec();
+    for (uint32_t f=0;f<frames;f++) {
+        rainbow(grb, n, f);
+        uint16_t len = streamEncode(&buf[0], &grb[0], n);
+        double t0 = nowSec();
+        if (write(fd, &buf[0], len) != len) {
+            perror("write");
+            return 1;
+        }
+        // the ack, or give up on this one after 100ms
+        bool acked = false;
+        struct pollfd p = { fd, POLLIN, 0 };
+        while (!acked && (poll(&p, 1, 100) > 0)) {
+            uint8_t c;
+            while (read(fd, &c, 1) == 1) {
+                if (c == STREAM_ACK) acked = true;
+            }
+        }
+        if (acked) rtt.push_back((nowSec() - t0) * 1000.0);
+        else       lost++;
+    }
+    double secs = nowSec() - start;
+    close(fd);
+
+    std::sort(rtt.begin(), rtt.end());
+    printf("%u frames of %u pixels in %.2fs: %.1f fps, %u without an ack\n",
+           frames, n, secs, frames / secs, lost);
+    if (rtt.size()) {
+        printf("round trip ms: min %.2f  median %.2f  p99 %.2f  max %.2f\n",
+               rtt[0], rtt[rtt.size() / 2], rtt[(rtt.size() - 1) * 99 / 100], rtt.back());
+    }
+    return lost ? 1 : 0;
+}
+
+static int loopback(uint32_t baud, uint8_t n, uint32_t frames, uint32_t every) {
+    std::vector<uint8_t> target(n * 3);
+    std::vector<uint8_t> back(n * 3);
+    std::vector<uint8_t> grb(n * 3);
+    std::vector<uint8_t> buf(STREAM_HDR_LEN + n * 3 + 1);
+    std::vector<uint8_t> wire;
+    stream_c stream;
+    stream.begin(&target[0], &back[0], n);
+
+    // one long byte stream, with a little noise between frames, so the
+    // parser can be timed on its own
+    std::vector<bool> corrupt(frames);
+    uint32_t lcg = 1;
+    for (uint32_t f=0;f<frames;f++) {
+        rainbow(grb, n, f);
+        uint16_t len = streamEncode(&buf[0], &grb[0], n);
+        corrupt[f] = every && ((f % every) == every - 1);
+        if (corrupt[f]) {
+            lcg = lcg * 1103515245UL + 12345UL;
+            buf[STREAM_HDR_LEN + (lcg >> 8) % (n * 3)] ^= 1 << ((lcg >> 4) & 7);
+        }
+        wire.insert(wire.end(), buf.begin(), buf.begin() + len);
+        wire.push_back(0);
+    }
+
+    // the parser alone: what the interrupt costs, give or take the CPU
+    const uint32_t reps = 20;
+    double t0 = nowSec();
+    for (uint32_t r=0;r<reps;r++) {
+        for (size_t i=0;i<wire.size();i++) {
+            stream.rxByte(wire[i]);
+            // a frame boundary, and loop() takes it straight away,
+            // less the check and the copy
+            if (wire[i] == 0) stream.release();
+        }
+    }
+    double parse_s = nowSec() - t0;
+
+    // and frame by frame, checking each one
+    uint32_t good = 0, bad_ok = 0, wrong = 0;
+    size_t pos = 0;
+    for (uint32_t f=0;f<frames;f++) {
+        size_t end = pos + STREAM_HDR_LEN + n * 3 + 1;
+        for (;pos<end;pos++) stream.rxByte(wire[pos]);
+        pos++; // the noise byte
+        rainbow(grb, n, f);
+        bool got = stream.poll(f);
+        if (corrupt[f]) {
+            if (!got) bad_ok++;
+            else      wrong++;
+        } else if (got && std::equal(grb.begin(), grb.end(), target.begin())) {
+            good++;
+        } else {
+            wrong++;
+        }
+    }
+
+    uint32_t frame_bytes = STREAM_HDR_LEN + n * 3 + 1;
+    double wire_ms = frame_bytes * 10.0 * 1000.0 / baud;
+    double show_ms = n * SHOW_US_PER_PIXEL / 1000.0;
+    printf("%u frames of %u pixels: %u good, %u corrupt and rejected, %u wrong\n",
+           frames, n, good, bad_ok, wrong);
+    printf("parser: %.1f Mbyte/s here, %.0f ns a byte\n",
+           wire.size() * reps / parse_s / 1e6, parse_s * 1e9 / (wire.size() * reps));
+    printf("at %u baud: %u bytes a frame, %.2fms on the wire + %.2fms show = %.0f fps at most\n",
+           baud, frame_bytes, wire_ms, show_ms, 1000.0 / (wire_ms + show_ms));
+    printf("(plus up to %ums for loop() to get round to it, %.0f fps worst case)\n",
+           LOOP_MS, 1000.0 / (wire_ms + show_ms + LOOP_MS));
+    return wrong ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    uint32_t baud   = STREAM_BAUD;
+    unsigned pixels = 30;
+    uint32_t frames = 1000;
+    uint32_t every  = 7;
+    bool     lb     = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "Lb:p:n:e:")) != -1) {
+        switch (opt) {
+            case 'L': lb     = true; break;
+            case 'b': baud   = strtoul(optarg, 0, 0); break;
+            case 'p': pixels = atoi(optarg); break;
+            case 'n': frames = strtoul(optarg, 0, 0); break;
+            case 'e': every  = strtoul(optarg, 0, 0); break;
+            default:
+                fprintf(stderr, "usage: streamsend [-b baud] [-p pixels] [-n frames] /dev/tty...\n"
+                                "       streamsend -L [-b baud] [-p pixels] [-n frames] [-e every]\n");
+                return 2;
+        }
+    }
+    if (!pixels || (pixels > STREAM_MAX_PIXELS) || !baud) {
+        fprintf(stderr, "1 to %u pixels\n", STREAM_MAX_PIXELS);
+        return 2;
+    }
+    if (lb) return loopback(baud, pixels, frames, every);
+    if (optind >= argc) {
+        fprintf(stderr, "which port?\n");
+        return 2;
+    }
+    return send(argv[optind], baud, pixels, frames);
+}
+
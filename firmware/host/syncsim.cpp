@@ -0,0 +1,207 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Simulates a daisy chain of snowflakes keeping time with sync.h, and
+// reports how far apart their frames end up.
+//
+//   syncsim [-n nodes] [-l latency_ms] [-j jitter_ms] [-r drift_pct]
+//           [-d frame_ms] [-t seconds] [-w warmup_s] [-S seed]
+//
+// Each node has its own crystal-less clock (off by up to drift_pct
+// either way), boots at a random time in the first few seconds, and
+// runs loop() every 3-8ms. A frame from one node reaches the next
+// latency_ms plus up to jitter_ms late, on top of the time it takes
+// to cross the wire. The master changes pattern (and seed) every 30s.
+//
+// For every frame a node shows, the time is compared with when the
+// master showed the same frame. Exits non-zero if any node, after
+// the warmup, was a whole frame or more off.
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -DNDEBUG -I. -I../snowflake_complete
+//       syncsim.cpp hal.cpp ../snowflake_complete/helpers.cpp -o syncsim
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <vector>
+
+#include "sync.h"
+
+const uint32_t PATTERN_CHANGE_MS = 30000;
+const uint32_t BYTE_US = 10UL * 1000000UL / SYNC_BAUD;
+
+typedef struct node_t {
+    sync_node_c sync;
+    double   rate;       // local ms per true ms
+    int64_t  boot_us;
+    int64_t  next_loop_us;
+    uint32_t last_change;
+    std::vector<double> err_ms;
+} node_t;
+
+typedef struct event_t {
+    int64_t  at_us;
+    uint16_t node;
+    int16_t  byte;       // -1 for a trip through loop()
+    bool operator<(const event_t &o) const { return at_us > o.at_us; }
+} event_t;
+
+static uint32_t lcg_state;
+static double urand() {
+    lcg_state = lcg_state * 1103515245UL + 12345UL;
+    return (lcg_state >> 8) / 16777216.0;
+}
+
+static uint32_t localMs(const node_t &n, int64_t t_us) {
+    return (uint32_t)((t_us - n.boot_us) * n.rate / 1000.0);
+}
+
+int main(int argc, char **argv) {
+    unsigned nodes   = 8;
+    double latency   = 1.0;
+    double jitter    = 2.0;
+    double drift     = 2.0;
+    unsigned del     = 70;
+    unsigned seconds = 300;
+    unsigned warmup  = 20;
+    lcg_state        = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:j:r:d:t:w:S:")) != -1) {
+        switch (opt) {
+            case 'n': nodes   = atoi(optarg); break;
+            case 'l': latency = atof(optarg); break;
+            case 'j': jitter  = atof(optarg); break;
+            case 'r': drift   = atof(optarg); break;
+            case 'd': del     = atoi(optarg); break;
+            case 't': seconds = atoi(optarg); break;
+            case 'w': warmup  = atoi(optarg); break;
+            case 'S': lcg_state = strtoul(optarg, 0, 0); break;
+            default:
+                fprintf(stderr, "usage: syncsim [-n nodes] [-l latency_ms] [-j jitter_ms] [-r drift_pct]\n"
+                                "               [-d frame_ms] [-t seconds] [-w warmup_s] [-S seed]\n");
+                return 2;
+        }
+    }
+    if ((nodes < 1) || (del < 1)) return 2;
+
+    std::vector<node_t> net(nodes);
+    std::priority_queue<event_t> events;
+    for (unsigned i=0;i<nodes;i++) {
+        net[i].rate    = 1.0 + drift / 100.0 * (2.0 * urand() - 1.0);
+        net[i].boot_us = (int64_t)(urand() * 5e6);
+        net[i].next_loop_us = net[i].boot_us;
+        net[i].last_change  = 0;
+        event_t e = { net[i].boot_us, (uint16_t)i, -1 };
+        events.push(e);
+    }
+
+    // when the master showed each (seed, phase)
+    std::map<std::pair<uint32_t, uint16_t>, int64_t> shown_at;
+    // and when everyone else did, to compare afterwards
+    std::vector<std::vector<std::pair<std::pair<uint32_t, uint16_t>, int64_t> > > shows(nodes);
+
+    const int64_t end_us = (int64_t)seconds * 1000000;
+    uint32_t pattern = 0;
+    while (!events.empty() && (events.top().at_us < end_us)) {
+        event_t e = events.top();
+        events.pop();
+        node_t &n = net[e.node];
+        uint32_t now = localMs(n, e.at_us);
+
+        if (e.byte >= 0) {
+            n.sync.rxByte(e.byte, now);
+            continue;
+        }
+
+        if (n.sync.poll(now)) {
+            // follower restarting its pattern; nothing to do here
+        }
+        if (n.sync.isMaster()) {
+            if ((now - n.last_change) > PATTERN_CHANGE_MS) {
+                pattern = (pattern + 1) % 15;
+                n.last_change = now;
+            }
+            if (n.sync.lead(pattern, 0, 0)) {
+                lcg_state = lcg_state * 1103515245UL + 12345UL;
+                n.sync.restart(pattern, lcg_state);
+            }
+        }
+        uint8_t ticks = n.sync.ticksDue(now, del);
+        if (ticks) {
+            std::pair<uint32_t, uint16_t> key(n.sync.state().seed, n.sync.state().phase);
+            if (n.sync.isMaster()) {
+                shown_at[key] = e.at_us;
+            } else {
+                shows[e.node].push_back(std::make_pair(key, e.at_us));
+            }
+        }
+
+        uint8_t buf[SYNC_FRAME_LEN];
+        uint8_t len = n.sync.txFrame(buf, now);
+        if (len && (e.node + 1U < nodes)) {
+            int64_t t = e.at_us + (int64_t)((latency + jitter * urand()) * 1000.0);
+            for (uint8_t i=0;i<len;i++) {
+                t += BYTE_US;
+                event_t b = { t, (uint16_t)(e.node + 1), buf[i] };
+                events.push(b);
+            }
+        }
+
+        n.next_loop_us = e.at_us + 3000 + (int64_t)(urand() * 5000);
+        event_t l = { n.next_loop_us, e.node, -1 };
+        events.push(l);
+    }
+
+    const int64_t warm_us = (int64_t)warmup * 1000000;
+    double worst = 0;
+    printf("node hops   drift%%   trim%%   frames  matched   mean_ms    p99_ms    max_ms\n");
+    for (unsigned i=0;i<nodes;i++) {
+        node_t &n = net[i];
+        unsigned frames = 0;
+        for (size_t k=0;k<shows[i].size();k++) {
+            if (shows[i][k].second < warm_us) continue;
+            frames++;
+            std::map<std::pair<uint32_t, uint16_t>, int64_t>::iterator m = shown_at.find(shows[i][k].first);
+            if (m == shown_at.end()) continue;
+            n.err_ms.push_back((shows[i][k].second - m->second) / 1000.0);
+        }
+        std::vector<double> a;
+        double mean = 0;
+        for (size_t k=0;k<n.err_ms.size();k++) {
+            a.push_back(fabs(n.err_ms[k]));
+            mean += n.err_ms[k];
+        }
+        std::sort(a.begin(), a.end());
+        double p99 = a.size() ? a[(a.size() - 1) * 99 / 100] : 0;
+        double mx  = a.size() ? a.back() : 0;
+        if (a.size()) mean /= a.size();
+        if (n.sync.isMaster()) {
+            printf("%4u %4s %8.3f %7s %8s %8s %9s %9s %9s\n", i, "-", (n.rate - 1) * 100, "-", "-", "-", "-", "-", "-");
+            continue;
+        }
+        printf("%4u %4u %8.3f %7.3f %8u %7.1f%% %9.2f %9.2f %9.2f\n", i, n.sync.state().hops,
+               (n.rate - 1) * 100, n.sync.clockState().rateTrim() * 100.0 / 65536,
+               frames, frames ? 100.0 * a.size() / frames : 0.0, mean, p99, mx);
+        if (!frames || (a.size() < frames * 9 / 10)) worst = 1e9;
+        worst = std::max(worst, mx);
+    }
+    bool ok = worst < del;
+    printf("worst %.2fms against %ums frames: %s\n", worst, del, ok ? "ok" : "NOT sub-frame");
+    return ok ? 0 : 1;
+}
+
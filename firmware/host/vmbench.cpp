@@ -0,0 +1,214 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+// Runs the VM (vm.h) against the native patterns it has programs
+// for, tick for tick from the same seed, for every var0.
+//
+//   vmbench [-n ticks] [-s seed]
+//
+// checks that each VM program draws exactly what its pattern does,
+// from PROGMEM and from the EEPROM, and that a corrupt EEPROM image
+// falls back to the built-in program. Then it times both, and prints
+// the time a tick takes here and how many VM instructions that was.
+//
+// The times here only say how the two compare. For cycles on the
+// AVR, upload the program (tools/vmasm.py --upload) to a unit built
+// with PROFILE_ENABLE and compare the tick zone for the VM pattern
+// with the native one (tools/profile_report.py).
+//
+// To build, from this directory:
+//
+//   g++ -std=gnu++11 -O2 -DSERIAL_DEBUG -DNDEBUG -I. -I../snowflake_complete
+//       vmbench.cpp hal.cpp ../snowflake_complete/helpers.cpp
+//       ../snowflake_complete/tables.cpp -o vmbench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <new>
+
+#include "sim.h"
+
+typedef Fun_Rainbow_c<sim_pixchain_t, sim_sensors_t, varn_indices_t> rainbow_t;
+typedef Fun_Pulse_c  <sim_pixchain_t, sim_sensors_t, varn_indices_t> pulse_t;
+typedef Fun_VM_c     <sim_pixchain_t, sim_sensors_t, varn_indices_t> vm_t;
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// A pattern with its own pixels and sensors, zeroed the way globals
+// are on the AVR (see sim_c::create()).
+template<class PAT>
+class world_c {
+    public:
+    static world_c *create(uint32_t seed, uint8_t var0) {
+        void *m = calloc(1, sizeof(world_c));
+        return new (m) world_c(seed, var0);
+    }
+    static world_c *create(uint32_t seed, uint8_t var0, const uint8_t *prog, bool eep) {
+        void *m = calloc(1, sizeof(world_c));
+        return new (m) world_c(seed, var0, prog, eep);
+    }
+    static void destroy(world_c *w) {
+        w->~world_c();
+        free(w);
+    }
+
+    varn_indices_t varns;
+    sim_pixchain_t pixels;
+    sim_sensors_t  sensors;
+    PAT            pat;
+
+    private:
+    world_c(uint32_t seed, uint8_t var0) :
+        pat(pixels, sensors, varns) {
+        start(seed, var0);
+    }
+    world_c(uint32_t seed, uint8_t var0, const uint8_t *prog, bool eep) :
+        pat(pixels, sensors, varns, prog, eep) {
+        start(seed, var0);
+    }
+    void start(uint32_t seed, uint8_t var0) {
+        varns.var0_idx = var0;
+        pixels.clear();
+        sensors.seed(seed);
+        pat.init();
+    }
+};
+
+static void eepromLoad(const uint8_t *img, uint16_t len) {
+    for (uint16_t i=0;i<len;i++) eeprom_writer_c::write(VM_EEP_BASE + i, img[i]);
+}
+
+// the first tick at which the two differ, or -1
+template<class PAT>
+static long compare(uint32_t seed, uint8_t var0, const uint8_t *prog, bool eep, uint32_t ticks) {
+    world_c<PAT> *n = world_c<PAT>::create(seed, var0);
+    world_c<vm_t> *v = world_c<vm_t>::create(seed, var0, prog, eep);
+    long bad = -1;
+    if (eep && !v->pat.fromEeprom()) bad = 0;
+    for (uint32_t t=0;(t<ticks) && (bad < 0);t++) {
+        n->pat.tick();
+        v->pat.tick();
+        if (memcmp(n->pixels.getAll(), v->pixels.getAll(), PIXEL_CHAIN_LENGTH * sizeof(pixel_t))) bad = t;
+    }
+    world_c<PAT>::destroy(n);
+    world_c<vm_t>::destroy(v);
+    return bad;
+}
+
+template<class PAT>
+static uint16_t stepsOf(const PAT &) {
+    return 0;
+}
+static uint16_t stepsOf(const vm_t &p) {
+    return p.lastSteps();
+}
+
+// ns a tick, and the VM instructions a tick
+template<class PAT>
+static double timeTicks(world_c<PAT> *w, uint32_t ticks, double *steps) {
+    uint64_t st = 0;
+    double t0 = nowSec();
+    for (uint32_t t=0;t<ticks;t++) {
+        w->pat.tick();
+        st += stepsOf(w->pat);
+    }
+    double secs = nowSec() - t0;
+    *steps = (double)st / ticks;
+    return secs * 1e9 / ticks;
+}
+
+template<class PAT>
+static bool bench(const char *name, const uint8_t *prog, uint16_t prog_len, uint32_t seed, uint32_t ticks) {
+    bool ok = true;
+    // exactness first: every var0, from PROGMEM and from the EEPROM
+    eepromLoad(prog, prog_len);
+    for (uint8_t var0=0;var0<VARIATION_0_COUNT;var0++) {
+        for (uint8_t eep=0;eep<2;eep++) {
+            long bad = compare<PAT>(seed + var0, var0, prog, eep, ticks / 10 + 1);
+            if (bad >= 0) {
+                printf("%-8s var0 %u from %s: differs at tick %ld\n",
+                       name, var0, eep ? "EEPROM" : "PROGMEM", bad);
+                ok = false;
+            }
+        }
+    }
+
+    double native_ns = 0, vm_ns = 0, eep_ns = 0, steps = 0;
+    for (uint8_t var0=0;var0<VARIATION_0_COUNT;var0++) {
+        double s;
+        world_c<PAT> *n = world_c<PAT>::create(seed, var0);
+        native_ns += timeTicks(n, ticks, &s);
+        world_c<PAT>::destroy(n);
+        world_c<vm_t> *v = world_c<vm_t>::create(seed, var0, prog, false);
+        vm_ns += timeTicks(v, ticks, &s);
+        world_c<vm_t>::destroy(v);
+        steps += s;
+        v = world_c<vm_t>::create(seed, var0, prog, true);
+        eep_ns += timeTicks(v, ticks, &s);
+        world_c<vm_t>::destroy(v);
+    }
+    native_ns /= VARIATION_0_COUNT;
+    vm_ns     /= VARIATION_0_COUNT;
+    eep_ns    /= VARIATION_0_COUNT;
+    steps     /= VARIATION_0_COUNT;
+    printf("%-8s %4u %9.0f %9.0f %9.0f %6.1fx %8.1f  %s\n",
+           name, prog_len, native_ns, vm_ns, eep_ns, vm_ns / native_ns, steps, ok ? "same" : "DIFFERENT");
+    return ok;
+}
+
+// A program whose header is good but whose code is not should not
+// run; the VM falls back to the built-in one.
+static bool fallback(uint32_t seed) {
+    uint8_t img[sizeof(vm_prog_rainbow)];
+    memcpy(img, vm_prog_rainbow, sizeof(img));
+    img[VM_HDR_LEN + 3] ^= 0x10;
+    eepromLoad(img, sizeof(img));
+    world_c<vm_t> *v = world_c<vm_t>::create(seed, 0, vm_prog_pulse, true);
+    bool ok = !v->pat.fromEeprom();
+    world_c<vm_t>::destroy(v);
+    long bad = compare<pulse_t>(seed, 0, vm_prog_pulse, false, 100);
+    printf("corrupt EEPROM image: %s\n", (ok && (bad < 0)) ? "ignored" : "RUN");
+    return ok && (bad < 0);
+}
+
+int main(int argc, char **argv) {
+    uint32_t ticks = 20000;
+    uint32_t seed  = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+            case 'n': ticks = strtoul(optarg, 0, 0); break;
+            case 's': seed  = strtoul(optarg, 0, 0); break;
+            default:
+                fprintf(stderr, "usage: vmbench [-n ticks] [-s seed]\n");
+                return 2;
+        }
+    }
+    if (!ticks) ticks = 1;
+
+    printf("%u ticks of %u pixels, averaged over var0 0-%u\n",
+           ticks, PIXEL_CHAIN_LENGTH, VARIATION_0_COUNT - 1);
+    printf("%-8s %4s %9s %9s %9s %7s %8s\n",
+           "pattern", "size", "native ns", "vm ns", "eeprom ns", "vm/nat", "ops/tick");
+    bool ok = true;
+    ok &= bench<rainbow_t>("rainbow", vm_prog_rainbow, sizeof(vm_prog_rainbow), seed, ticks);
+    ok &= bench<pulse_t>  ("pulse",   vm_prog_pulse,   sizeof(vm_prog_pulse),   seed, ticks);
+    ok &= fallback(seed);
+    return ok ? 0 : 1;
+}
+
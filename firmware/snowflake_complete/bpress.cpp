@@ -0,0 +1,159 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include "bpress.h"
+
+volatile bp_event_t buttons_c::ring[BP_RING_LEN];
+volatile uint8_t    buttons_c::ring_head      = 0;
+volatile uint8_t    buttons_c::ring_tail      = 0;
+volatile uint8_t    buttons_c::overflow_count = 0;
+
+uint8_t           buttons_c::masks[BP_BUTTONS];
+volatile uint8_t  buttons_c::raw  = 0;
+volatile uint8_t  buttons_c::down = 0;
+uint8_t           buttons_c::held_at_boot = 0;
+volatile uint32_t buttons_c::edge_ms[BP_BUTTONS];
+volatile uint32_t buttons_c::press_ms[BP_BUTTONS];
+uint16_t          buttons_c::short_time = 0;
+uint16_t          buttons_c::med_time   = 0;
+uint16_t          buttons_c::long_time  = 0;
+volatile bool     buttons_c::wake_armed   = false;
+volatile bool     buttons_c::wake_pressed = false;
+
+void buttons_c::begin(uint8_t pin0, uint8_t pin1,
+                      uint16_t short_ms, uint16_t med_ms, uint16_t long_ms) {
+    short_time = short_ms;
+    med_time   = med_ms;
+    long_time  = long_ms;
+    const uint8_t pins[BP_BUTTONS] = { pin0, pin1 };
+    for (uint8_t b=0;b<BP_BUTTONS;b++) {
+        pinMode(pins[b], INPUT_PULLUP);
+        masks[b] = _BV(pins[b] - 8);
+    }
+    noInterrupts();
+    ring_head = ring_tail = 0;
+    overflow_count = 0;
+    // A button held down at boot, such as the press that woke it, is
+    // let go of without counting as a press.
+    raw  = _levels();
+    down = raw;
+    held_at_boot = raw;
+    for (uint8_t b=0;b<BP_BUTTONS;b++) edge_ms[b] = press_ms[b] = millis();
+    PCMSK0 |= masks[0] | masks[1];
+    PCIFR   = _BV(PCIF0);
+    PCICR  |= _BV(PCIE0);
+    interrupts();
+}
+
+// which buttons are down right now, a bit a button
+uint8_t buttons_c::_levels() {
+    uint8_t pins = PINB;
+    uint8_t l = 0;
+    for (uint8_t b=0;b<BP_BUTTONS;b++) {
+        if (!(pins & masks[b])) l |= _BV(b);
+    }
+    return l;
+}
+
+// Takes a debounced edge and queues it. Interrupts must be off.
+void buttons_c::_edge(uint8_t b, bool is_down, uint32_t ms) {
+    bp_t kind = bp_none;
+    if (is_down) {
+        down |= _BV(b);
+        press_ms[b] = ms;
+    } else {
+        down &= ~_BV(b);
+        uint32_t held = ms - press_ms[b];
+        kind = (held_at_boot & _BV(b)) ? bp_none :
+               held < short_time ? bp_short :
+               held < med_time   ? bp_medium :
+               held < long_time  ? bp_long : bp_verylong;
+        held_at_boot &= ~_BV(b);
+    }
+
+    uint8_t next = (ring_head + 1) & (BP_RING_LEN - 1);
+    if (next == ring_tail) {
+        if (overflow_count < 0xff) overflow_count++;
+        return;
+    }
+    volatile bp_event_t &ev = ring[ring_head];
+    ev.button = b;
+    ev.down   = is_down;
+    ev.kind   = kind;
+    ev.ms     = ms;
+    ring_head = next;
+}
+
+void buttons_c::_pcint_isr() {
+    uint32_t ms  = millis();
+    uint8_t  now = _levels();
+    uint8_t  changed = now ^ raw;
+    raw = now;
+    for (uint8_t b=0;b<BP_BUTTONS;b++) {
+        uint8_t m = _BV(b);
+        if (!(changed & m)) continue;
+        // an edge soon after the last one is the contacts bouncing
+        bool steady = (ms - edge_ms[b]) >= BP_DEBOUNCE_MILLIS;
+        edge_ms[b] = ms;
+        if (steady && ((now ^ down) & m)) _edge(b, now & m, ms);
+    }
+    if (wake_armed && now) {
+        sleep_disable();
+        wake_armed   = false;
+        wake_pressed = true;
+    }
+}
+
+ISR(PCINT0_vect) {
+    buttons_c::_pcint_isr();
+}
+
+void buttons_c::poll() {
+    noInterrupts();
+    uint32_t ms = millis();
+    for (uint8_t b=0;b<BP_BUTTONS;b++) {
+        uint8_t m = _BV(b);
+        if (((raw ^ down) & m) && ((ms - edge_ms[b]) >= BP_DEBOUNCE_MILLIS)) {
+            _edge(b, raw & m, edge_ms[b]);
+        }
+    }
+    interrupts();
+}
+
+bool buttons_c::next(bp_event_t &ev) {
+    uint8_t tail = ring_tail;
+    if (tail == ring_head) return false;
+    volatile bp_event_t &e = ring[tail];
+    ev.button = e.button;
+    ev.down   = e.down;
+    ev.kind   = e.kind;
+    ev.ms     = e.ms;
+    ring_tail = (tail + 1) & (BP_RING_LEN - 1);
+    return true;
+}
+
+uint8_t buttons_c::overflows() {
+    noInterrupts();
+    uint8_t o = overflow_count;
+    overflow_count = 0;
+    interrupts();
+    return o;
+}
+
+void buttons_c::armWake() {
+    noInterrupts();
+    wake_pressed = false;
+    wake_armed   = true;
+    interrupts();
+}
@@ -13,6 +13,7 @@
 #define __BPRESS_H
 
 #include <Arduino.h>
+#include "debug.h"
 
 typedef enum bp_t {
     bp_none = 0,
@@ -22,35 +23,79 @@ typedef enum bp_t {
     bp_verylong,
 } bp_t;
 
-template<uint8_t PIN, uint16_t SHORT_TIME, uint16_t MED_TIME, uint16_t LONG_TIME>
-class Button_c {
-    private:
-        uint8_t bvals;
-        uint8_t last_bvals;
-        uint32_t down_time;
+// The buttons are serviced by the PCINT0 (port B) pin change handler,
+// so a press is seen however long loop() is held up by show(), an
+// EEPROM write or myVcc(). The handler timestamps each edge with
+// millis() and debounces by time: an edge is taken if the button has
+// been steady for BP_DEBOUNCE_MILLIS, and the rest of the bounce is
+// ignored. If the bounce ends the other way from how it started,
+// there is no edge left to see that, so poll() takes the level once
+// it has been steady long enough, stamped with when it last moved.
+//
+// Each press and release goes into a small ring buffer, filled only
+// by the handler (or poll(), with interrupts off) and emptied only by
+// next(), so next() never has to turn interrupts off. A release carries how long the button
+// was held, sorted against the press lengths given to begin().
+//
+// While the sketch is asleep with interrupts on (pctrl_wakeable),
+// pressing either button wakes it; see armWake().
+//
+// host/buttonsim.cpp runs this against made-up bounces to check it.
+
+const uint8_t BP_BUTTONS         = 2;
+const uint8_t BP_RING_LEN        = 8; // must be a power of 2
+const uint8_t BP_DEBOUNCE_MILLIS = 20;
+
+typedef struct bp_event_t {
+    uint8_t  button;   // 0 or 1, in the order given to begin()
+    bool     down;
+    bp_t     kind;     // for a release, how long it was held (bp_none
+                       // if it was already down at begin())
+    uint32_t ms;       // millis() at the edge
+} bp_event_t;
+
+class buttons_c {
     public:
-        Button_c() : bvals(0xff), down_time(0) {
-            pinMode(PIN,INPUT_PULLUP);
-        };
-        bp_t pressed() {
-            uint32_t now = millis();
-            bp_t rv = bp_none;
-            bvals <<= 1;
-            bvals |= digitalRead(PIN) ? 1 : 0;
-            if (!bvals && last_bvals) {
-                down_time = now;
-            } else if (down_time && ((bvals & 0x0f) == 0x1)) {
-                uint32_t duration = now - down_time;
-                Serial.print("duration ");
-                Serial.println(duration);
-                rv = duration < SHORT_TIME ? bp_short :
-                     duration < MED_TIME   ? bp_medium : 
-                     duration < LONG_TIME  ? bp_long: bp_verylong;
-                down_time = 0;
-            }
-            last_bvals = bvals;
-            return rv;
+        // Both pins must be on port B (Arduino pins 8 to 13).
+        static void begin(uint8_t pin0, uint8_t pin1,
+                          uint16_t short_ms, uint16_t med_ms, uint16_t long_ms);
+
+        // settles a button whose bounce ended with no edge to see it
+        static void poll();
+
+        // the oldest event not yet taken; false if there are none
+        static bool next(bp_event_t &ev);
+
+        // events the ring had no room for since the last call
+        static uint8_t overflows();
+
+        // Call just before sleeping: the next press wakes the sketch,
+        // and woke() says so once it is running again.
+        static void armWake();
+        static bool woke() {
+            return wake_pressed;
         }
+
+        static void _pcint_isr();
+
+    private:
+        static volatile bp_event_t ring[BP_RING_LEN];
+        static volatile uint8_t    ring_head;
+        static volatile uint8_t    ring_tail;
+        static volatile uint8_t    overflow_count;
+
+        static uint8_t           masks[BP_BUTTONS];
+        static volatile uint8_t  raw;         // as last seen, a bit a button
+        static volatile uint8_t  down;        // debounced
+        static uint8_t           held_at_boot;
+        static volatile uint32_t edge_ms[BP_BUTTONS];
+        static volatile uint32_t press_ms[BP_BUTTONS];
+        static uint16_t          short_time, med_time, long_time;
+        static volatile bool     wake_armed;
+        static volatile bool     wake_pressed;
+
+        static uint8_t _levels();
+        static void _edge(uint8_t b, bool is_down, uint32_t ms);
 };
 
 #endif
@@ -0,0 +1,157 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __clip_h
+#define __clip_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "fun_stuff.h"
+
+// Plays back a clip: frames made ahead of time on a PC, for looks
+// that would be hard to work out a tick at a time, like a logo reveal.
+// host/clipenc.cpp makes clips from a capture (framestream.h) or a
+// CSV timeline; the ones built in are in clips.h.
+//
+// A clip is
+//
+//   'C' 'l' pixels frames (2 bytes) palette_len  palette ... frames ...
+//
+// The palette is palette_len colors, 3 bytes each in pixel_t order,
+// and then each color in the frames is one byte, an index into it. A
+// palette_len of 0 means there is no palette, and colors are 3 bytes.
+//
+// Each frame is a change from the one before it (the first, from all
+// off), as ops that between them cover every pixel:
+//
+//   00nnnnnn               n+1 pixels stay as they are
+//   01nnnnnn color         n+1 pixels of one color
+//   1nnnnnnn color ...     n+1 pixels, each with its own color
+//
+// Frames are decoded one a tick, from flash straight into the chain's
+// working buffer, so playing a clip takes no more RAM however long it
+// is. After the last frame it starts over.
+
+const uint8_t CLIP_MAGIC0   = 'C';
+const uint8_t CLIP_MAGIC1   = 'l';
+const uint8_t CLIP_HDR_LEN  = 6;
+const uint8_t CLIP_OP_SKIP  = 0x00;
+const uint8_t CLIP_OP_RUN   = 0x40;
+const uint8_t CLIP_OP_LIT   = 0x80;
+const uint8_t CLIP_MAX_SKIP = 64;
+const uint8_t CLIP_MAX_RUN  = 64;
+const uint8_t CLIP_MAX_LIT  = 128;
+
+class clip_player_c {
+    public:
+    clip_player_c(const uint8_t *c) : clip(c), pos(0), frame(0), frames(0), pixels(0),
+        palette_len(0) { };
+
+    // false if this is not a clip
+    bool begin() {
+        frames = 0;
+        if ((pgm_read_byte(clip) != CLIP_MAGIC0) ||
+            (pgm_read_byte(clip + 1) != CLIP_MAGIC1)) return false;
+        pixels = pgm_read_byte(clip + 2);
+        frames = pgm_read_byte(clip + 3) | (pgm_read_byte(clip + 4) << 8);
+        palette_len = pgm_read_byte(clip + 5);
+        rewind();
+        return frames != 0;
+    }
+
+    void rewind() {
+        frame = 0;
+        pos   = CLIP_HDR_LEN + (uint16_t)palette_len * sizeof(pixel_t);
+    }
+
+    // Decodes the next frame into buf, which holds len pixels. Pixels
+    // past len are dropped; ones the clip does not have are left off.
+    void next(pixel_t *buf, uint8_t len) {
+        if (!frames) return;
+        if (!frame) memset((void *)buf, 0, (uint16_t)len * sizeof(pixel_t));
+        const uint8_t *p = clip + pos;
+        uint8_t i = 0;
+        while (i < pixels) {
+            uint8_t op = pgm_read_byte(p++);
+            uint8_t n;
+            if (op & CLIP_OP_LIT) {
+                n = (op & 0x7f) + 1;
+                for (uint8_t j=0;j<n;j++,i++) {
+                    pixel_t c = _color(p);
+                    if (i < len) buf[i] = c;
+                }
+            } else if (op & CLIP_OP_RUN) {
+                n = (op & 0x3f) + 1;
+                pixel_t c = _color(p);
+                for (uint8_t j=0;j<n;j++,i++) {
+                    if (i < len) buf[i] = c;
+                }
+            } else {
+                i += (op & 0x3f) + 1;
+            }
+        }
+        pos = p - clip;
+        if (++frame == frames) rewind();
+    }
+
+    uint16_t frameCount() const {
+        return frames;
+    }
+
+    private:
+    const uint8_t *clip;
+    uint16_t pos;
+    uint16_t frame;
+    uint16_t frames;
+    uint8_t  pixels;
+    uint8_t  palette_len;
+
+    // the color at p, which is moved past it
+    pixel_t _color(const uint8_t *&p) const {
+        const uint8_t *c = p;
+        if (palette_len) {
+            c = clip + CLIP_HDR_LEN + (uint16_t)pgm_read_byte(p) * sizeof(pixel_t);
+            p += 1;
+        } else {
+            p += sizeof(pixel_t);
+        }
+        pixel_t px;
+        px.d[0] = pgm_read_byte(c);
+        px.d[1] = pgm_read_byte(c + 1);
+        px.d[2] = pgm_read_byte(c + 2);
+        return px;
+    }
+};
+
+// plays a clip, one frame a tick
+template<class PIX_C, class SENS_C, class VARNS_C>
+class Fun_Clip_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
+    typedef Fun_Base_c<PIX_C, SENS_C, VARNS_C> parent_t;
+
+    public:
+    Fun_Clip_c(PIX_C &inp, SENS_C &insens, VARNS_C &invarns, const uint8_t *clip) :
+        parent_t(inp,insens,invarns), player(clip) { };
+
+    void init() {
+        parent_t::pixels.clear();
+        if (!player.begin()) DEBUG_PRINTLN_F("clip: not a clip");
+    }
+
+    void _tick() {
+        player.next(parent_t::pixels.getAll(), parent_t::pixels.len());
+    }
+
+    private:
+    clip_player_c player;
+};
+
+#endif
+
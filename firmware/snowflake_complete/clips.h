@@ -0,0 +1,77 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __clips_h
+#define __clips_h
+
+#include <stdint.h>
+#include <Arduino.h>
+
+// Clips for Fun_Clip_c (clip.h). Made by host/clipenc from the
+// sources in tools/clips; edit those, not this.
+
+// reveal: 74 frames of 30 pixels, 621 bytes
+const uint8_t PROGMEM clip_reveal[] = {
+    0x43, 0x6c, 0x1e, 0x4a, 0x00, 0x20, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff,
+    0xee, 0xe4, 0xff, 0xf8, 0xf1, 0xff, 0xdd, 0xc9, 0xff, 0xf1, 0xe2, 0xff,
+    0xcc, 0xae, 0xff, 0xea, 0xd4, 0xff, 0xbc, 0x94, 0xff, 0xe4, 0xc6, 0xff,
+    0xab, 0x79, 0xff, 0xdd, 0xb7, 0xff, 0x9a, 0x5e, 0xff, 0xd6, 0xa9, 0xff,
+    0x89, 0x43, 0xff, 0xcf, 0x9a, 0xff, 0x78, 0x28, 0xff, 0xc8, 0x8c, 0xff,
+    0x69, 0x23, 0xdf, 0xaf, 0x7a, 0xdf, 0x5a, 0x1e, 0xbf, 0x96, 0x69, 0xbf,
+    0x4b, 0x19, 0x9f, 0x7d, 0x58, 0x9f, 0x3c, 0x14, 0x80, 0x64, 0x46, 0x80,
+    0x2d, 0x0f, 0x60, 0x4b, 0x34, 0x60, 0x1e, 0x0a, 0x40, 0x32, 0x23, 0x40,
+    0x0f, 0x05, 0x20, 0x19, 0x12, 0x20, 0x1d, 0x1d, 0x1d, 0x1d, 0x40, 0x01,
+    0x02, 0x40, 0x01, 0x18, 0x00, 0x82, 0x01, 0x00, 0x01, 0x19, 0x42, 0x01,
+    0x1a, 0x45, 0x01, 0x02, 0x40, 0x01, 0x13, 0x05, 0x82, 0x01, 0x00, 0x01,
+    0x14, 0x47, 0x01, 0x15, 0x4a, 0x01, 0x02, 0x40, 0x01, 0x0e, 0x0a, 0x82,
+    0x01, 0x00, 0x01, 0x0f, 0x4c, 0x01, 0x10, 0x4f, 0x01, 0x02, 0x40, 0x01,
+    0x09, 0x0f, 0x82, 0x01, 0x00, 0x01, 0x0a, 0x51, 0x01, 0x0b, 0x54, 0x01,
+    0x02, 0x40, 0x01, 0x04, 0x14, 0x82, 0x01, 0x00, 0x01, 0x05, 0x56, 0x01,
+    0x06, 0x59, 0x01, 0x02, 0x40, 0x01, 0x5a, 0x01, 0x00, 0x41, 0x01, 0x5d,
+    0x01, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x41, 0x02, 0x40, 0x03, 0x43,
+    0x02, 0x40, 0x03, 0x43, 0x02, 0x40, 0x03, 0x43, 0x02, 0x40, 0x03, 0x43,
+    0x02, 0x40, 0x03, 0x43, 0x02, 0x40, 0x03, 0x41, 0x02, 0x41, 0x04, 0x40,
+    0x05, 0x43, 0x04, 0x40, 0x05, 0x43, 0x04, 0x40, 0x05, 0x43, 0x04, 0x40,
+    0x05, 0x43, 0x04, 0x40, 0x05, 0x43, 0x04, 0x40, 0x05, 0x41, 0x04, 0x41,
+    0x06, 0x40, 0x07, 0x43, 0x06, 0x40, 0x07, 0x43, 0x06, 0x40, 0x07, 0x43,
+    0x06, 0x40, 0x07, 0x43, 0x06, 0x40, 0x07, 0x43, 0x06, 0x40, 0x07, 0x41,
+    0x06, 0x41, 0x08, 0x40, 0x09, 0x43, 0x08, 0x40, 0x09, 0x43, 0x08, 0x40,
+    0x09, 0x43, 0x08, 0x40, 0x09, 0x43, 0x08, 0x40, 0x09, 0x43, 0x08, 0x40,
+    0x09, 0x41, 0x08, 0x41, 0x0a, 0x40, 0x0b, 0x43, 0x0a, 0x40, 0x0b, 0x43,
+    0x0a, 0x40, 0x0b, 0x43, 0x0a, 0x40, 0x0b, 0x43, 0x0a, 0x40, 0x0b, 0x43,
+    0x0a, 0x40, 0x0b, 0x41, 0x0a, 0x41, 0x0c, 0x40, 0x0d, 0x43, 0x0c, 0x40,
+    0x0d, 0x43, 0x0c, 0x40, 0x0d, 0x43, 0x0c, 0x40, 0x0d, 0x43, 0x0c, 0x40,
+    0x0d, 0x43, 0x0c, 0x40, 0x0d, 0x41, 0x0c, 0x41, 0x0e, 0x40, 0x0f, 0x43,
+    0x0e, 0x40, 0x0f, 0x43, 0x0e, 0x40, 0x0f, 0x43, 0x0e, 0x40, 0x0f, 0x43,
+    0x0e, 0x40, 0x0f, 0x43, 0x0e, 0x40, 0x0f, 0x41, 0x0e, 0x41, 0x10, 0x40,
+    0x11, 0x43, 0x10, 0x40, 0x11, 0x43, 0x10, 0x40, 0x11, 0x43, 0x10, 0x40,
+    0x11, 0x43, 0x10, 0x40, 0x11, 0x43, 0x10, 0x40, 0x11, 0x41, 0x10, 0x1d,
+    0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d,
+    0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x41, 0x12, 0x40, 0x13, 0x43,
+    0x12, 0x40, 0x13, 0x43, 0x12, 0x40, 0x13, 0x43, 0x12, 0x40, 0x13, 0x43,
+    0x12, 0x40, 0x13, 0x43, 0x12, 0x40, 0x13, 0x41, 0x12, 0x41, 0x14, 0x40,
+    0x15, 0x43, 0x14, 0x40, 0x15, 0x43, 0x14, 0x40, 0x15, 0x43, 0x14, 0x40,
+    0x15, 0x43, 0x14, 0x40, 0x15, 0x43, 0x14, 0x40, 0x15, 0x41, 0x14, 0x41,
+    0x16, 0x40, 0x17, 0x43, 0x16, 0x40, 0x17, 0x43, 0x16, 0x40, 0x17, 0x43,
+    0x16, 0x40, 0x17, 0x43, 0x16, 0x40, 0x17, 0x43, 0x16, 0x40, 0x17, 0x41,
+    0x16, 0x41, 0x18, 0x40, 0x19, 0x43, 0x18, 0x40, 0x19, 0x43, 0x18, 0x40,
+    0x19, 0x43, 0x18, 0x40, 0x19, 0x43, 0x18, 0x40, 0x19, 0x43, 0x18, 0x40,
+    0x19, 0x41, 0x18, 0x41, 0x1a, 0x40, 0x1b, 0x43, 0x1a, 0x40, 0x1b, 0x43,
+    0x1a, 0x40, 0x1b, 0x43, 0x1a, 0x40, 0x1b, 0x43, 0x1a, 0x40, 0x1b, 0x43,
+    0x1a, 0x40, 0x1b, 0x41, 0x1a, 0x41, 0x1c, 0x40, 0x1d, 0x43, 0x1c, 0x40,
+    0x1d, 0x43, 0x1c, 0x40, 0x1d, 0x43, 0x1c, 0x40, 0x1d, 0x43, 0x1c, 0x40,
+    0x1d, 0x43, 0x1c, 0x40, 0x1d, 0x41, 0x1c, 0x41, 0x1e, 0x40, 0x1f, 0x43,
+    0x1e, 0x40, 0x1f, 0x43, 0x1e, 0x40, 0x1f, 0x43, 0x1e, 0x40, 0x1f, 0x43,
+    0x1e, 0x40, 0x1f, 0x43, 0x1e, 0x40, 0x1f, 0x41, 0x1e, 0x5d, 0x00, 0x1d,
+    0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d,
+};
+
+#endif
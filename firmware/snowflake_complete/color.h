@@ -0,0 +1,99 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __color_h
+#define __color_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "pixel.h"
+
+// Colors by hue, saturation and value (or lightness) rather than by
+// how much red, green and blue. A hue is 16 bits, 0x10000 all the way
+// round from red through green and blue and back; the 8-bit versions
+// take the top byte of that.
+//
+// Round the wheel are six sectors. In each one channel is at the
+// value, one at the floor the saturation leaves (p below), and one
+// ramps between the two. The ramp down is the value less the ramp up,
+// so a color is two 8x8 multiplies and a jump on the sector, with no
+// divides and no table lookups.
+
+// a scaled by b/256, with 255 taken as all of it
+inline uint8_t scale8(uint8_t a, uint8_t b) {
+    return ((uint16_t)a * b + a) >> 8;
+}
+
+// a color of hue h whose channels run from p up to v
+inline pixel_t hueRamp(uint16_t h, uint8_t p, uint8_t v) {
+    // h * 6 / 256, without a 32-bit multiply
+    uint16_t x      = (h >> 8) * 6 + (((h & 0xff) * 6) >> 8);
+    uint8_t  sector = x >> 8;
+    uint8_t  up     = p + scale8(v - p, x & 0xff);
+    uint8_t  down   = v - (up - p);
+    switch (sector) {
+        case 0:  return pixel_t(v,    up,   p);
+        case 1:  return pixel_t(down, v,    p);
+        case 2:  return pixel_t(p,    v,    up);
+        case 3:  return pixel_t(p,    down, v);
+        case 4:  return pixel_t(up,   p,    v);
+        default: return pixel_t(v,    p,    down);
+    }
+}
+
+inline pixel_t hsv16(uint16_t h, uint8_t s, uint8_t v) {
+    return hueRamp(h, v - scale8(v, s), v);
+}
+inline pixel_t hsv8(uint8_t h, uint8_t s, uint8_t v) {
+    return hsv16(((uint16_t)h << 8) | h, s, v);
+}
+
+// Lightness 128 is the pure hue, 0 black and 255 white, whatever the
+// saturation.
+inline pixel_t hsl16(uint16_t h, uint8_t s, uint8_t l) {
+    uint8_t c = scale8(s, (l < 128) ? l : 255 - l);
+    return hueRamp(h, l - c, l + c);
+}
+inline pixel_t hsl8(uint8_t h, uint8_t s, uint8_t l) {
+    return hsl16(((uint16_t)h << 8) | h, s, l);
+}
+
+// A color to work on before it is turned into a pixel.
+typedef struct hsv_t {
+    uint16_t h;
+    uint8_t  s;
+    uint8_t  v;
+
+    hsv_t(uint16_t ih = 0, uint8_t is = 0xff, uint8_t iv = 0xff) : h(ih), s(is), v(iv) { };
+
+    void rotate(int16_t dh) {
+        h += dh;
+    }
+    void saturate(uint8_t f) {
+        s = scale8(s, f);
+    }
+    void dim(uint8_t f) {
+        v = scale8(v, f);
+    }
+    pixel_t toPixel() const {
+        return hsv16(h, s, v);
+    }
+} hsv_t;
+
+// A random color that is bright and not washed out, from 32 random
+// bits: any hue, full value, and at least 3/4 saturation. Any 24 bits
+// as a pixel_t is mostly some shade of muddy white.
+inline pixel_t vividColor(uint32_t r) {
+    return hsv16(r, 0xc0 | (r >> 26), 0xff);
+}
+
+#endif
+
@@ -12,12 +12,26 @@
 #ifndef __DEBUG_H
 #define __DEBUG_H
 
-#define SERIAL_DEBUG
-
-#ifdef SERIAL_DEBUG
+// Pick one (or neither). SERIAL_DEBUG prints text with the Arduino
+// Serial object, and blocks whenever its buffer is full, which at 
+// 19200 baud is most of the time. TRACE_DEBUG writes compact binary
+// records into a ring that is sent from the UART interrupt; use 
+// tools/trace_decode.py to read them.
+// #define SERIAL_DEBUG
+#define TRACE_DEBUG
+
+// DEBUG_ROOM() is true if one more line or record would go out
+// without waiting, for code that runs between frames and would rather
+// send it later than hold a frame up.
+
+#if defined(SERIAL_DEBUG)
     #define DEBUG_FLUSH() \
         Serial.flush()
 
+    // a name and a 5 digit value, and the line end
+    #define DEBUG_ROOM() \
+        (Serial.availableForWrite() >= 32)
+
     #define DEBUG_INIT(speed) \
         Serial.begin(speed); \
         Serial.println(F("debug init!"))
@@ -48,6 +62,28 @@
         DEBUG_PVAR_FMT(v,DEC)
 
 
+#elif defined(TRACE_DEBUG)
+    #include "trace.h"
+
+    #define DEBUG_FLUSH() \
+        trace_c::flush()
+
+    #define DEBUG_ROOM() \
+        trace_c::room()
+
+    #define DEBUG_INIT(speed) \
+        trace_c::begin(speed); \
+        TRACE()
+
+    #define DEBUG_PRINTLN_FMT(v,f)  TRACE(v)
+    #define DEBUG_PRINTLN(...)      TRACE(__VA_ARGS__)
+    #define DEBUG_PRINTLN_F(v)      TRACE()
+    #define DEBUG_PRINT_FMT(v,f)    TRACE(v)
+    #define DEBUG_PRINT(...)        TRACE(__VA_ARGS__)
+    #define DEBUG_PRINT_F(v)        TRACE()
+    #define DEBUG_PVAR_FMT(v,f)     TRACE(v)
+    #define DEBUG_PVAR(v)           TRACE(v)
+
 #else
     #define DEBUG_INIT(speed)
     #define DEBUG_PRINTLN(v)
@@ -60,6 +96,7 @@
     #define DEBUG_PVAR_F(v)
     #define DEBUG_PVAR_FMT(v,f)
     #define DEBUG_FLUSH()
+    #define DEBUG_ROOM()            true
 #endif
 
 
@@ -0,0 +1,182 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __energy_h
+#define __energy_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "debug.h"
+#include "helpers.h"
+#include "pixel.h"
+#include "stored.h"
+
+// How hard each pattern drives the LEDs, so that the ones that go easy
+// on a battery can be picked out. For each pattern and var0 it keeps
+// the average load of the frames sent (PixChain_c::load(): the mask
+// applied, but not the brightness), weighted by how long each frame
+// stayed on the chain. While the unit runs the MCU never sleeps, and
+// the chain's idle draw and the IR receiver's do not change, so that
+// and the brightness are what tell one pattern's current from
+// another's. tools/energy_report.py turns the table into mA at each of
+// brightnesses[], from an EEPROM image read off a unit
+//
+//   avrdude -p m328p -c usbtiny -U eeprom:r:unit.eep:r
+//
+// or made by host/energysim.cpp. Timer0 stops in power-down, so the
+// time asleep is not known here; the report takes the sleeping draw as
+// it is.
+//
+// In the EEPROM the table is a header,
+//
+//   version | patterns | variations | crc8 of those three
+//
+// then three bytes a cell, pattern by pattern and var0 by var0: the
+// average (0xffff is every channel full on), low byte first, and the
+// number of ENERGY_UNIT_MILLIS it is the average of. That stops at
+// ENERGY_MAX_UNITS, after which it follows about the last hour spent
+// in the cell. A cell that has never been written is erased (0xff).
+//
+// Time in a cell is added up in RAM, and goes into the EEPROM when the
+// pattern or var0 changes, every ENERGY_SAVE_UNITS, and at shutdown.
+// A table for some other number of patterns is wiped by begin().
+
+// #define ENERGY_ENABLE
+
+// after the settings log, which stops here only with ENERGY_ENABLE,
+// up to VM_EEP_BASE
+const uint16_t ENERGY_EEP_BASE    = 0x100;
+const uint16_t ENERGY_EEP_SIZE    = 0x200;
+
+const uint8_t  ENERGY_VERSION     = 1;
+const uint8_t  ENERGY_HDR_LEN     = 4;
+const uint8_t  ENERGY_CELL_LEN    = 3;
+const uint16_t ENERGY_UNIT_MILLIS = 15000;
+const uint8_t  ENERGY_MAX_UNITS   = 254;
+const uint8_t  ENERGY_SAVE_UNITS  = 240; // an hour
+
+template<uint8_t NPATTERNS, uint8_t NVARS, uint8_t CHAIN_LENGTH, int EEP_BASE_ADDR, int EEP_SIZE>
+class energy_c {
+
+    static_assert(ENERGY_HDR_LEN + (uint16_t)NPATTERNS * NVARS * ENERGY_CELL_LEN <= EEP_SIZE,
+                  "energy table does not fit");
+    // up to two units' worth of the heaviest frames
+    static_assert(2.0 * ENERGY_UNIT_MILLIS * 255 * sizeof(pixel_t) * CHAIN_LENGTH < 4294967296.0,
+                  "chain too long for the unit sum");
+
+    public:
+    energy_c() : cur_pattern(0xff), cur_var(0), last_ms(0), last_load(0),
+                 unit_load(0), unit_ms(0), sum(0), units(0) { };
+
+    // Checks the header, and wipes the table if it is not for this
+    // many patterns and variations (or is still the settings log that
+    // used to be here).
+    void begin() {
+        uint8_t hdr[ENERGY_HDR_LEN];
+        hdr[0] = ENERGY_VERSION;
+        hdr[1] = NPATTERNS;
+        hdr[2] = NVARS;
+        hdr[3] = crc8(hdr, 3);
+        bool ok = true;
+        for (uint8_t j=0;j<ENERGY_HDR_LEN;j++) {
+            if (eeprom_writer_c::read(EEP_BASE_ADDR + j) != hdr[j]) ok = false;
+        }
+        if (ok) return;
+        DEBUG_PRINTLN_F("energy table wiped");
+        for (uint16_t a=ENERGY_HDR_LEN;a<ENERGY_HDR_LEN+CELLS*ENERGY_CELL_LEN;a++) {
+            _update(EEP_BASE_ADDR + a, 0xff);
+        }
+        for (uint8_t j=0;j<ENERGY_HDR_LEN;j++) _update(EEP_BASE_ADDR + j, hdr[j]);
+    }
+
+    // A frame has just gone out; load is PixChain_c::load() of it.
+    void frame(uint8_t pattern, uint8_t var, uint32_t now, uint32_t load) {
+        // the last frame was on until now
+        if (cur_pattern != 0xff) _add(now);
+        if ((pattern != cur_pattern) || (var != cur_var)) {
+            save();
+            cur_pattern = pattern;
+            cur_var     = var;
+        }
+        last_ms   = now;
+        last_load = load;
+    }
+
+    // Folds the time in the current cell into the EEPROM. Less than
+    // half a unit left over is dropped.
+    void save() {
+        if (unit_ms >= ENERGY_UNIT_MILLIS / 2) _closeUnit();
+        unit_load = 0;
+        unit_ms   = 0;
+        if (!units || (cur_pattern >= NPATTERNS) || (cur_var >= NVARS)) {
+            sum   = 0;
+            units = 0;
+            return;
+        }
+        uint16_t a   = _cellAddr(cur_pattern, cur_var);
+        uint16_t avg = eeprom_writer_c::read(a) | ((uint16_t)eeprom_writer_c::read(a + 1) << 8);
+        uint8_t  n   = eeprom_writer_c::read(a + 2);
+        if (n > ENERGY_MAX_UNITS) n = 0;
+
+        uint16_t total_units = n + units;
+        avg = ((uint32_t)avg * n + sum) / total_units;
+        n   = (total_units > ENERGY_MAX_UNITS) ? ENERGY_MAX_UNITS : total_units;
+        _update(a,     avg & 0xff);
+        _update(a + 1, avg >> 8);
+        _update(a + 2, n);
+
+        DEBUG_PRINTLN_F("energy saved");
+        DEBUG_PVAR(cur_pattern);
+        DEBUG_PVAR(cur_var);
+        DEBUG_PVAR(avg);
+        DEBUG_PVAR(n);
+        sum   = 0;
+        units = 0;
+    }
+
+    private:
+    static const uint16_t CELLS = (uint16_t)NPATTERNS * NVARS;
+
+    uint8_t  cur_pattern; // 0xff before the first frame
+    uint8_t  cur_var;
+    uint32_t last_ms;
+    uint32_t last_load;
+    uint32_t unit_load;   // load times ms, so far this unit
+    uint16_t unit_ms;
+    uint32_t sum;         // of the averages of the units so far
+    uint8_t  units;
+
+    void _add(uint32_t now) {
+        uint32_t dt = now - last_ms;
+        if (dt > ENERGY_UNIT_MILLIS) dt = ENERGY_UNIT_MILLIS;
+        unit_load += last_load * dt;
+        unit_ms   += dt;
+        if (unit_ms >= ENERGY_UNIT_MILLIS) _closeUnit();
+        if (units >= ENERGY_SAVE_UNITS) save();
+    }
+
+    void _closeUnit() {
+        // 255 * 257 is 0xffff
+        sum += (unit_load / unit_ms) * 257 / (sizeof(pixel_t) * CHAIN_LENGTH);
+        units    += 1;
+        unit_load = 0;
+        unit_ms   = 0;
+    }
+
+    static uint16_t _cellAddr(uint8_t pattern, uint8_t var) {
+        return EEP_BASE_ADDR + ENERGY_HDR_LEN + ((uint16_t)pattern * NVARS + var) * ENERGY_CELL_LEN;
+    }
+    static void _update(uint16_t addr, uint8_t d) {
+        if (eeprom_writer_c::read(addr) != d) eeprom_writer_c::write(addr, d);
+    }
+};
+
+#endif
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __entropy_h
+#define __entropy_h
+
+#include <stdint.h>
+#include <Arduino.h>
+
+// Collects entropy from ADC readings the firmware is taking anyway.
+// The bottom two bits of each conversion are mostly noise, and when
+// in the loop a reading happens, as seen by the free-running Timer1,
+// wobbles with interrupts, serial traffic and the like. These get 
+// folded into a byte and, every few samples, stirred into a 32b pool
+// with an xorshift step.
+//
+// The credit given is deliberately stingy: a quarter of a bit per
+// sample. 
+const uint8_t ENTROPY_SAMPLES_PER_BIT = 4;
+const uint8_t ENTROPY_POOL_BITS       = 32;
+
+class entropy_pool_c {
+    public:
+    entropy_pool_c() : pool(0x6a09e667UL), stage(0), nsamples(0), est_bits(0) { };
+
+    void add(uint16_t sample) {
+        uint8_t jitter = TCNT1;
+        stage = (stage << 3) | (stage >> 5);
+        stage ^= (sample & 0x3) ^ jitter;
+        nsamples += 1;
+        if (nsamples >= ENTROPY_SAMPLES_PER_BIT) {
+            nsamples = 0;
+            _mix(stage);
+            if (est_bits < ENTROPY_POOL_BITS) est_bits += 1;
+        }
+    }
+
+    // bits of entropy we think are in the pool
+    uint8_t estimate() const {
+        return est_bits;
+    }
+    bool ready() const {
+        return est_bits >= ENTROPY_POOL_BITS;
+    }
+
+    // hand out the pool and start counting again
+    uint32_t take() {
+        _mix(stage);
+        est_bits = 0;
+        return pool;
+    }
+
+    private:
+    uint32_t pool;
+    uint8_t  stage;
+    uint8_t  nsamples;
+    uint8_t  est_bits;
+
+    void _mix(uint8_t b) {
+        pool ^= b;
+        pool ^= pool << 13;
+        pool ^= pool >> 17;
+        pool ^= pool << 5;
+    }
+};
+
+#endif
+
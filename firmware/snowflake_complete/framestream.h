@@ -0,0 +1,272 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __framestream_h
+#define __framestream_h
+
+#include <stdint.h>
+
+// A compact binary record of what went out to the pixels, with
+// enough alongside it to play the run back exactly. Everything is
+// little-endian.
+//
+// header:
+//   'S' 'N' 'F' 'S', version, chain length, pixel format,
+//   seed (4 bytes), settings length, settings (varn_indices_t)
+//
+// then records, each starting with a tag byte:
+//   'A' pin, value (2 bytes)     an analogRead() result, in the
+//                                order they were taken
+//   'V' length, settings         the settings changed
+//   'F' dt, runs                 a frame
+//   'E'                          end of stream
+//
+// dt is milliseconds since the previous frame (or the start), as a
+// varint: 7 bits a byte, low bits first, high bit set on all but the
+// last byte. The frame itself is a delta against the previous one
+// (all zeros to begin with): runs of
+//
+//   skip, count, count pixels
+//
+// repeated until skip + count adds up to the chain length, so a
+// frame that did not change is just 'F', dt, length, 0.
+//
+// The writer and reader are templated on something with put(uint8_t)
+// or get() (which returns -1 at the end), so that they can sit on a
+// file, a buffer or the UART.
+
+const uint8_t FS_VERSION       = 1;
+const uint8_t FS_PIXEL_GRB888  = 0; // pixel_t order, as sent on the wire
+const uint8_t FS_BYTES_PER_PIX = 3;
+const uint8_t FS_MAX_CHAIN     = 64;
+const uint8_t FS_MAX_SETTINGS  = 32;
+
+typedef enum fs_tag_e {
+    FS_TAG_ANALOG   = 'A',
+    FS_TAG_SETTINGS = 'V',
+    FS_TAG_FRAME    = 'F',
+    FS_TAG_END      = 'E',
+} fs_tag_e;
+
+typedef struct fs_header_t {
+    uint8_t  version;
+    uint8_t  chain_len;
+    uint8_t  pixel_format;
+    uint32_t seed;
+    uint8_t  settings_len;
+    uint8_t  settings[FS_MAX_SETTINGS];
+} fs_header_t;
+
+template<class SINK_C>
+class fs_writer_c {
+    public:
+    fs_writer_c(SINK_C &insink) : sink(insink), chain_len(0), last_ms(0) { };
+
+    // false, with nothing written, for a chain the reader would not
+    // take either
+    bool header(uint8_t len, uint32_t seed, const void *settings, uint8_t settings_len) {
+        if (!len || (len > FS_MAX_CHAIN)) return false;
+        chain_len = len;
+        for (uint16_t i=0;i<sizeof(prev);i++) prev[i] = 0;
+        sink.put('S'); sink.put('N'); sink.put('F'); sink.put('S');
+        sink.put(FS_VERSION);
+        sink.put(len);
+        sink.put(FS_PIXEL_GRB888);
+        _put32(seed);
+        _putBlock(settings, settings_len);
+        return true;
+    }
+
+    void analog(uint8_t pin, uint16_t value) {
+        sink.put(FS_TAG_ANALOG);
+        sink.put(pin);
+        sink.put(value & 0xff);
+        sink.put(value >> 8);
+    }
+
+    void settings(const void *settings, uint8_t settings_len) {
+        sink.put(FS_TAG_SETTINGS);
+        _putBlock(settings, settings_len);
+    }
+
+    // pix is chain length * 3 bytes, as in PixChain_c::getOut()
+    void frame(uint32_t now_ms, const void *pix) {
+        if (!chain_len) return;
+        const uint8_t *p = (const uint8_t *)pix;
+        sink.put(FS_TAG_FRAME);
+        _putVarint(now_ms - last_ms);
+        last_ms = now_ms;
+
+        uint8_t i = 0;
+        do {
+            uint8_t skip = 0;
+            while ((i < chain_len) && _same(p, i)) {
+                skip++; i++;
+            }
+            uint8_t count = 0;
+            while ((i + count < chain_len) && !_same(p, i + count)) count++;
+            sink.put(skip);
+            sink.put(count);
+            for (uint16_t b=i*FS_BYTES_PER_PIX; b<(i+count)*FS_BYTES_PER_PIX; b++) {
+                sink.put(p[b]);
+                prev[b] = p[b];
+            }
+            i += count;
+        } while (i < chain_len);
+    }
+
+    void end() {
+        sink.put(FS_TAG_END);
+    }
+
+    private:
+    SINK_C   &sink;
+    uint8_t  chain_len;
+    uint32_t last_ms;
+    uint8_t  prev[FS_MAX_CHAIN * FS_BYTES_PER_PIX];
+
+    bool _same(const uint8_t *p, uint8_t n) const {
+        for (uint8_t b=0;b<FS_BYTES_PER_PIX;b++) {
+            if (p[n*FS_BYTES_PER_PIX+b] != prev[n*FS_BYTES_PER_PIX+b]) return false;
+        }
+        return true;
+    }
+    void _put32(uint32_t v) {
+        for (uint8_t i=0;i<4;i++) {
+            sink.put(v & 0xff);
+            v >>= 8;
+        }
+    }
+    void _putVarint(uint32_t v) {
+        while (v >= 0x80) {
+            sink.put((v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        sink.put(v);
+    }
+    void _putBlock(const void *d, uint8_t len) {
+        const uint8_t *p = (const uint8_t *)d;
+        sink.put(len);
+        for (uint8_t i=0;i<len;i++) sink.put(p[i]);
+    }
+};
+
+
+typedef enum fs_read_e {
+    FS_READ_ANALOG,
+    FS_READ_SETTINGS,
+    FS_READ_FRAME,
+    FS_READ_END,
+    FS_READ_ERROR,
+} fs_read_e;
+
+template<class SOURCE_C>
+class fs_reader_c {
+    public:
+    fs_reader_c(SOURCE_C &insrc) : src(insrc) {
+        hdr.chain_len = 0;
+        now_ms = 0;
+    };
+
+    bool header() {
+        if ((src.get() != 'S') || (src.get() != 'N') ||
+            (src.get() != 'F') || (src.get() != 'S')) return false;
+        hdr.version      = src.get();
+        hdr.chain_len    = src.get();
+        hdr.pixel_format = src.get();
+        hdr.seed         = 0;
+        for (uint8_t i=0;i<4;i++) {
+            hdr.seed |= (uint32_t)(uint8_t)src.get() << (i*8);
+        }
+        if ((hdr.version != FS_VERSION) ||
+            (hdr.pixel_format != FS_PIXEL_GRB888) ||
+            !hdr.chain_len || (hdr.chain_len > FS_MAX_CHAIN)) return false;
+        for (uint16_t i=0;i<sizeof(pix);i++) pix[i] = 0;
+        return _getBlock(hdr.settings, hdr.settings_len);
+    }
+
+    // Reads the next record. What it held is left in analog_pin and
+    // analog_value, settings, or now_ms and pix.
+    fs_read_e next() {
+        int tag = src.get();
+        switch (tag) {
+            case FS_TAG_ANALOG: {
+                int p = src.get();
+                int l = src.get();
+                int h = src.get();
+                if ((p < 0) || (l < 0) || (h < 0)) return FS_READ_ERROR;
+                analog_pin   = p;
+                analog_value = l | (h << 8);
+                return FS_READ_ANALOG;
+            }
+            case FS_TAG_SETTINGS:
+                return _getBlock(settings, settings_len) ? FS_READ_SETTINGS : FS_READ_ERROR;
+            case FS_TAG_FRAME:
+                return _getFrame() ? FS_READ_FRAME : FS_READ_ERROR;
+            case FS_TAG_END:
+                return FS_READ_END;
+            default:
+                return FS_READ_ERROR;
+        }
+    }
+
+    fs_header_t hdr;
+    uint8_t     analog_pin;
+    uint16_t    analog_value;
+    uint8_t     settings_len;
+    uint8_t     settings[FS_MAX_SETTINGS];
+    uint32_t    now_ms;
+    uint8_t     pix[FS_MAX_CHAIN * FS_BYTES_PER_PIX];
+
+    private:
+    SOURCE_C &src;
+
+    bool _getFrame() {
+        uint32_t dt = 0;
+        for (uint8_t shift=0; shift<32; shift+=7) {
+            int c = src.get();
+            if (c < 0) return false;
+            dt |= (uint32_t)(c & 0x7f) << shift;
+            if (!(c & 0x80)) break;
+        }
+        now_ms += dt;
+
+        uint8_t i = 0;
+        do {
+            int skip  = src.get();
+            int count = src.get();
+            if ((skip < 0) || (count < 0) ||
+                (i + skip + count > hdr.chain_len)) return false;
+            i += skip;
+            for (uint16_t b=i*FS_BYTES_PER_PIX; b<(i+count)*FS_BYTES_PER_PIX; b++) {
+                int c = src.get();
+                if (c < 0) return false;
+                pix[b] = c;
+            }
+            i += count;
+        } while (i < hdr.chain_len);
+        return true;
+    }
+    bool _getBlock(uint8_t *d, uint8_t &len) {
+        int l = src.get();
+        if ((l < 0) || (l > FS_MAX_SETTINGS)) return false;
+        len = l;
+        for (uint8_t i=0;i<len;i++) {
+            int c = src.get();
+            if (c < 0) return false;
+            d[i] = c;
+        }
+        return true;
+    }
+};
+
+#endif
+
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __frametime_h
+#define __frametime_h
+
+#include <stdint.h>
+#include "debug.h"
+
+// A histogram of how late each frame was relative to the delay asked
+// for, the shortest and longest gaps between frames, and counts of
+// frames rendered and of frames where show() was skipped because the
+// IR decoder was busy. The buckets are relative to the delay, so that
+// the jitter is told apart the same way at 70ms as at 1000ms: bucket
+// 0 is a frame that went early (streamed, or catching up), buckets 1
+// to 8 are 0 to 7ms late, one ms each, and from there each bucket is
+// twice as wide as the last, up to the last, which holds 512ms late
+// and over.
+//
+// The numbers are kept per pattern and delay setting. When either
+// changes, the finished set goes out the debug channel from idle(),
+// between frames and a line at a time, and only when the line would
+// go without waiting, so that sending it never makes a frame late.
+// Frames are not counted while that goes on, nor is the first one
+// after the change, whose gap straddles it.
+const uint8_t FT_BUCKETS = 16;
+const uint8_t FT_EXACT   = 8;  // late by 0..7ms, one bucket each
+const uint8_t FT_HEADER  = 8;  // lines before the buckets
+const uint8_t FT_IDLE    = 0xff;
+
+class frametime_c {
+    public:
+    frametime_c() : pattern(0), delay_idx(0), next_pattern(0), next_delay_idx(0),
+                    dump_at(FT_IDLE) {
+        reset();
+    };
+
+    // interval is the time since the last frame, deadline the delay
+    // that was asked for. Frames go when interval > deadline, so on 
+    // time means late by 0.
+    void frame(uint16_t interval, uint16_t deadline, bool shown) {
+        if (dump_at != FT_IDLE) return;
+        _inc(late_hist[_bucket(interval, deadline)]);
+        if (interval < interval_min) interval_min = interval;
+        if (interval > interval_max) interval_max = interval;
+        this_deadline = deadline;
+        if (shown) _inc(rendered);
+        else       _inc(dropped_ir);
+    }
+
+    void retag(uint8_t new_pattern, uint8_t new_delay_idx) {
+        if (dump_at != FT_IDLE) {
+            // changed again before the last set was out
+            next_pattern   = new_pattern;
+            next_delay_idx = new_delay_idx;
+            return;
+        }
+        if ((new_pattern == pattern) && (new_delay_idx == delay_idx)) return;
+        next_pattern   = new_pattern;
+        next_delay_idx = new_delay_idx;
+        dump_at        = 0;
+    }
+
+    // Call between frames. Sends the next line of a finished set, if
+    // there is one and it would go out without waiting.
+    void idle() {
+        if (dump_at == FT_IDLE) return;
+        if (!rendered && !dropped_ir) {
+            _done();
+            return;
+        }
+        if (!DEBUG_ROOM()) return;
+        if (dump_at < FT_HEADER) {
+            switch (dump_at) {
+                case 0: DEBUG_PRINTLN_F("frame times"); break;
+                case 1: DEBUG_PVAR(pattern);            break;
+                case 2: DEBUG_PVAR(delay_idx);          break;
+                case 3: DEBUG_PVAR(this_deadline);      break;
+                case 4: DEBUG_PVAR(rendered);           break;
+                case 5: DEBUG_PVAR(dropped_ir);         break;
+                case 6: DEBUG_PVAR(interval_min);       break;
+                case 7: DEBUG_PVAR(interval_max);       break;
+            }
+            dump_at++;
+            return;
+        }
+        // then each bucket with anything in it, its number and its
+        // count a line each
+        uint8_t i = dump_at - FT_HEADER;
+        uint8_t b = i >> 1;
+        if (i & 0x1) {
+            DEBUG_PVAR(late_hist[b]);
+        } else {
+            while ((b < FT_BUCKETS) && !late_hist[b]) b++;
+            if (b == FT_BUCKETS) {
+                DEBUG_PRINTLN_F("frame times end");
+                _done();
+                return;
+            }
+            DEBUG_PVAR(b);
+        }
+        dump_at = FT_HEADER + 2 * b + (i & 0x1) + 1;
+    }
+
+    void reset() {
+        for (uint8_t i=0;i<FT_BUCKETS;i++) late_hist[i] = 0;
+        interval_min  = 0xffff;
+        interval_max  = 0;
+        this_deadline = 0;
+        rendered      = 0;
+        dropped_ir    = 0;
+    }
+
+    private:
+    uint16_t late_hist[FT_BUCKETS];
+    uint16_t interval_min;
+    uint16_t interval_max;
+    uint16_t this_deadline;
+    uint16_t rendered;
+    uint16_t dropped_ir;
+    uint8_t  pattern;
+    uint8_t  delay_idx;
+    uint8_t  next_pattern;
+    uint8_t  next_delay_idx;
+    uint8_t  dump_at;      // next line to send, or FT_IDLE
+
+    // the set is out; start on the next
+    void _done() {
+        pattern   = next_pattern;
+        delay_idx = next_delay_idx;
+        reset();
+        dump_at   = FT_IDLE;
+    }
+
+    static uint8_t _bucket(uint16_t interval, uint16_t deadline) {
+        if (interval <= deadline) return 0;
+        uint16_t late = interval - deadline - 1;
+        if (late < FT_EXACT) return 1 + late;
+        // 8..15 is the first doubling bucket
+        uint8_t b = FT_EXACT + 1;
+        late >>= 4;
+        while (late && (b < FT_BUCKETS - 1)) {
+            late >>= 1;
+            b++;
+        }
+        return b;
+    }
+    static void _inc(uint16_t &c) {
+        if (c != 0xffff) c += 1;
+    }
+};
+
+#endif
+
@@ -16,6 +16,12 @@
 #include "helpers.h"
 #include "tables.h"
 #include "helpers.h"
+#include "osc.h"
+#include "color.h"
+
+// var0 bit that makes the patterns that pick random colors pick vivid
+// ones (see vividColor())
+const uint8_t VAR0_VIVID = 0x4;
 
 template<class PIX_C, class SENS_C, class VARNS_C>
 class Fun_Base_c {
@@ -34,6 +40,12 @@ class Fun_Base_c {
     PIX_C &pixels;
     SENS_C &sensors;
     VARNS_C &varns;
+
+    // any 24 bits, or a vivid color if var0 has VAR0_VIVID set
+    pixel_t randomColor() {
+        uint32_t r = sensors.rand32();
+        return (varns.var0_idx & VAR0_VIVID) ? vividColor(r) : pixel_t(r);
+    }
 };
 
 
@@ -50,13 +62,10 @@ class Fun_Sparkle_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
 
     void _tick() { 
         if (true) {
-            uint32_t a  = 0xffffffff;
-            uint32_t b  = 0xffffffff;
-
-            for (uint8_t i=0;i<parent_t::varns.var0_idx+1;i++) {
-                a &= parent_t::sensors.rand32();
-                b &= parent_t::sensors.rand32();
-            };
+            // each bit is lit with probability 1/2^(var0_idx+1)
+            uint8_t  density = 0x80 >> (parent_t::varns.var0_idx & 0x7);
+            uint32_t a = parent_t::sensors.randomMask(parent_t::pixels.len(), density);
+            uint32_t b = parent_t::sensors.randomMask(parent_t::pixels.len(), density);
 
             for (uint8_t i=0;i<parent_t::pixels.len();i++) {
                 bool ab = a & 0x1;
@@ -87,11 +96,9 @@ class Fun_Sparse_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
     void _tick() { 
         if (!ttl) {
             parent_t::pixels.clear(last_victim);
-            ttl = 0 + (parent_t::sensors.rand32() & 0x3);
-            uint8_t victim = parent_t::sensors.rand32() % parent_t::pixels.len();
-            uint32_t color = parent_t::sensors.rand32();
-            pixel_t np(color);
-            parent_t::pixels.set(victim,np);
+            ttl = 0 + parent_t::sensors.randBits(2);
+            uint8_t victim = parent_t::sensors.randRange(parent_t::pixels.len());
+            parent_t::pixels.set(victim,parent_t::randomColor());
             last_victim = victim;
             return;
         };
@@ -119,12 +126,11 @@ class Fun_Chaser_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
         uint8_t dirmsk = 0x3 & parent_t::varns.var0_idx;
 
         if (true) {
-            uint32_t a  = parent_t::sensors.rand32();
+            uint16_t a  = parent_t::sensors.rand16();
 
             if (true) {
                 if ((a & 0xff) < 0x10) {
-                    pixel_t np(parent_t::sensors.rand32());
-                    parent_t::pixels.set(0,np);
+                    parent_t::pixels.set(0,parent_t::randomColor());
                 } else if ((a & 0xff) < 0x40) {
                     parent_t::pixels.clear(0);
                 }
@@ -133,8 +139,7 @@ class Fun_Chaser_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
 
             if (true) {
                 if (((a >> 8)& 0xff) < 0x10) {
-                    pixel_t np(parent_t::sensors.rand32());
-                    parent_t::pixels.set(1,np);
+                    parent_t::pixels.set(1,parent_t::randomColor());
                 } else if (((a >> 8) & 0xff) < 0x40) {
                     parent_t::pixels.clear(1);
                 }
@@ -159,7 +164,7 @@ class Fun_Rainbow_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
     public:
 
     Fun_Rainbow_c(PIX_C &inp, SENS_C &insens, VARNS_C &invarns) :
-        parent_t(inp,insens,invarns), count(0) {};
+        parent_t(inp,insens,invarns), osc(0x100) {};
 
     void _tick() { 
 
@@ -168,18 +173,19 @@ class Fun_Rainbow_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
         uint8_t b_phase = pgm_read_byte(b_phases + idx);
 
         if (true) {
+            // 8 steps round the sine from each pixel to the next
+            osc_sweep_c r = osc.sweep(0, 8 << 8);
+            osc_sweep_c g = osc.sweep((uint16_t)g_phase << 8, 8 << 8);
+            osc_sweep_c b = osc.sweep((uint16_t)b_phase << 8, 8 << 8);
             for (uint8_t i=0;i<parent_t::pixels.len();i++) {
-                uint8_t r = sine8(count + 8*i);
-                uint8_t g = sine8(count + g_phase + 8*i);
-                uint8_t b = sine8(count + b_phase + 8*i);
-                parent_t::pixels.set(i,r,g,b);
+                parent_t::pixels.set(i, r.next(OSC_SINE), g.next(OSC_SINE), b.next(OSC_SINE));
             }
         }
-        count += 1;
+        osc.step();
     };
 
     private:
-    uint32_t count;
+    osc_c osc;
 
 };
 
@@ -198,8 +204,8 @@ class Fun_Snake_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
         just_inited = true;
     }
     void _tick() { 
-        uint32_t a = parent_t::sensors.rand32();
-        if (just_inited || ((a & 0xff) < 0x05)) {
+        uint8_t a = parent_t::sensors.rand8();
+        if (just_inited || (a < 0x05)) {
             just_inited = false;
             uint32_t rcolor = parent_t::sensors.rand32();
 
@@ -216,7 +222,8 @@ class Fun_Snake_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
         } 
       
         for (uint8_t i=0;i<PULSE_LEN+2;i++) {
-            uint8_t pidx = start + i;
+            // the snake runs off the end of the chain and onto the start
+            uint8_t pidx = (start + i) % parent_t::pixels.len();
             if ((i==0) || (i==PULSE_LEN+1)) {
                 parent_t::pixels.set(pidx,0);
             } else {
@@ -248,9 +255,9 @@ class Fun_Leaves_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
         parent_t(inp,insens,invarns) { };
 
     void _tick() { 
-        uint8_t group = parent_t::sensors.rand32() & 0x7;
-        if (group < 7) {
-            bool use_black = !(parent_t::sensors.rand32() & 0xf);
+        uint8_t group = parent_t::sensors.randBits(3);
+        if (group < 6) {
+            bool use_black = !parent_t::sensors.randBits(4);
             pixel_t np(use_black ? 0 : parent_t::sensors.rand32());
             for (uint8_t i=0;i<PIXELS_PER_LEAF;i++) {
                 parent_t::pixels.set(i+group*PIXELS_PER_LEAF,np);
@@ -282,11 +289,11 @@ class Fun_Flash_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
             // start a flash
             pixel_t np(P_WHITE);
             parent_t::pixels.setAll(np);
-            ttl = parent_t::sensors.rand32() & 0xf;
+            ttl = parent_t::sensors.randBits(4);
         } else {
             ttl -= 1;
             if (!ttl) {
-                ttw = parent_t::sensors.rand32() & 0x3f;
+                ttw = parent_t::sensors.randBits(6);
                 parent_t::pixels.clear();
             }
         }
@@ -339,7 +346,7 @@ class Fun_Cylon_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
         }
 
         for (uint8_t i=0;i<4;i+=1) {
-            uint8_t loc = fromProgMem8(cylons,row*4 +i);
+            uint8_t loc = cylons[row*4 +i];
             loc += orient * 5;
             loc = loc % parent_t::pixels.len();
             parent_t::pixels.set(loc, pixel_t(pc));
@@ -366,9 +373,7 @@ class Fun_Solid_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
 
     void _tick() { 
         if (!divcount) {
-            uint32_t color = parent_t::sensors.rand32();
-            pixel_t np(color);
-            parent_t::pixels.setAll(np);
+            parent_t::pixels.setAll(parent_t::randomColor());
         }
         divcount += 1;
         divcount &= 0x7;
@@ -399,8 +404,7 @@ class Fun_MiniCircle_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
             for (uint8_t i=0;i<PIXELS_PER_LEAF-1;i++) {
                 colors[i] = colors[i+1];
             }
-            pixel_t np(parent_t::sensors.rand32());
-            colors[PIXELS_PER_LEAF-1] = np;
+            colors[PIXELS_PER_LEAF-1] = parent_t::randomColor();
         }
         count += 1;
     };
@@ -430,7 +434,7 @@ class Fun_Inching_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
     }
     void _tick() {
         uint8_t dirmsk = 0x3 & parent_t::varns.var0_idx;
-        uint8_t move_size = parent_t::sensors.rand32() & 0xf;
+        uint8_t move_size = parent_t::sensors.randBits(4);
 
         if (move_size < pgm_read_byte(cuts0 + dirmsk)) {
             // stay
@@ -448,14 +452,15 @@ class Fun_Inching_c: public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
             }
         }
 
-        if (!(parent_t::sensors.rand32() & 0xf)) {
+        if (!parent_t::sensors.randBits(4)) {
             cp = pixel_t(parent_t::sensors.rand32());
         } 
         for (uint8_t i=0;i<3;i++) {
+            // a third of the way round the chain from each other
             uint8_t offset = i * (parent_t::pixels.len() / 3);
-            parent_t::pixels.set(pidxs[0] + offset,0);
-            parent_t::pixels.set(pidxs[1] + offset,cp);
-            parent_t::pixels.set(pidxs[2] + offset,0);
+            parent_t::pixels.set((pidxs[0] + offset) % parent_t::pixels.len(),0);
+            parent_t::pixels.set((pidxs[1] + offset) % parent_t::pixels.len(),cp);
+            parent_t::pixels.set((pidxs[2] + offset) % parent_t::pixels.len(),0);
         }
     }
 
@@ -471,32 +476,22 @@ class Fun_Pulse_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
 
     public:
     Fun_Pulse_c(PIX_C &inp, SENS_C &insens, VARNS_C &invarns) :
-        parent_t(inp,insens,invarns), dir(false), bright(0), color(0) {};
+        parent_t(inp,insens,invarns), color(0) {};
 
     void _tick() {
-        if (!bright) color = pixel_t(parent_t::sensors.rand32());
+        // brightness goes up and back down by var0 + 1 a tick, so this
+        // many steps round the triangle
+        osc.setFreq((uint16_t)(parent_t::varns.var0_idx + 1) << 7);
+        // a new color each time it goes dark
+        if (osc.wrapped()) color = pixel_t(parent_t::sensors.rand32());
         pixel_t adjColor = color;
-        adjColor.scale(bright);
+        adjColor.scale(osc.value(OSC_TRIANGLE));
         parent_t::pixels.setAll(adjColor);
-        uint8_t before_bright = bright;
-        if (dir) {
-            bright -= (parent_t::varns.var0_idx + 1);
-            if (bright > before_bright) {
-                bright = 0;
-                dir = false;
-            }
-        } else {
-            bright += (parent_t::varns.var0_idx + 1);
-            if (bright < before_bright) {
-                bright = 255;
-                dir = true;
-            }
-        }
+        osc.step();
     }
 
     private:
-        bool dir;
-        uint8_t bright;
+        osc_c osc;
         pixel_t color;
 
 };
@@ -583,27 +578,34 @@ class Fun_Lines_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
     public:
 
     Fun_Lines_c(PIX_C &inp, SENS_C &insens, VARNS_C &invarns) :
-        parent_t(inp,insens,invarns), count(0) {};
+        parent_t(inp,insens,invarns), osc(0x100), tips_count(0) {};
 
     void _tick() {
         uint8_t idx = parent_t::varns.var0_idx & 0x7;
         uint8_t g_phase = pgm_read_byte(g_phases + idx);
         uint8_t b_phase = pgm_read_byte(b_phases + idx);
 
+        // in and out along each arm, a pixel a tick
+        uint8_t j = (osc.getPhase() >> 8) & 0x7;
+        if (j > 3) j = 7-j;
+        uint16_t along = (uint16_t)(8*j) << 8;
+        uint8_t r = osc.value(OSC_SINE, along);
+        uint8_t g = osc.value(OSC_SINE, along + ((uint16_t)g_phase << 8));
+        uint8_t b = osc.value(OSC_SINE, along + ((uint16_t)b_phase << 8));
+
         parent_t::pixels.setAll(0);
         for (uint8_t i=0;i<6;i++) {
-            uint8_t j = count & 0x7;
-            if (j > 3) j = 7-j;
-            uint8_t r = sine8(count + 8*j);
-            uint8_t g = sine8(count + g_phase + 8*j);
-            uint8_t b = sine8(count + b_phase + 8*j);
-            parent_t::pixels.set(pgm_read_byte(line_elems + j)+5*i, r,g,b);
-            if (!(count % 20)) parent_t::pixels.set(2 + 5*i, parent_t::sensors.rand32());
+            // the last two of each line are on the next arm round
+            parent_t::pixels.set((pgm_read_byte(line_elems + j)+5*i) % parent_t::pixels.len(), r,g,b);
+            if (!tips_count) parent_t::pixels.set(2 + 5*i, parent_t::sensors.rand32());
         }
-        count += 1;
+        osc.step();
+        // new tips every 20 ticks
+        if (++tips_count == 20) tips_count = 0;
     };
     private:
-        uint32_t count;
+        osc_c osc;
+        uint8_t tips_count;
 };
 
 
@@ -12,22 +12,11 @@
 #include <stdint.h>
 #include <Arduino.h>
 #include "helpers.h"
-#include "ema.h"
-
-uint8_t fromProgMem8(const uint8_t *pbase, uint8_t idx) {
-    return pgm_read_byte(pbase + idx);
-}
-uint16_t fromProgMem16(const uint16_t *pbase, uint8_t idx) {
-    return pgm_read_word(pbase + idx);
-}
-uint32_t fromProgMem32(const uint32_t *pbase, uint8_t idx) {
-    return pgm_read_dword(pbase + idx);
-}
 
 
 // cribbed from: https://graphics.stanford.edu/~seander/bithacks.html#IntegerLog
 
-static const uint8_t PROGMEM _magic_log_constants[32] = {
+static const progmem_array<uint8_t, 32> _magic_log_constants PROGMEM = {
   0, 9, 1, 10, 13, 21, 2, 29, 11, 14, 16, 18, 22, 25, 3, 30,
   8, 12, 20, 28, 15, 17, 24, 7, 19, 27, 23, 6, 26, 5, 4, 31
 };
@@ -41,15 +30,25 @@ uint32_t log2int(uint32_t v) {
     v |= v >> 8;
     v |= v >> 16;
 
-    return fromProgMem8(_magic_log_constants,(uint32_t)(v * 0x07C4ACDDU) >> 27);
+    return _magic_log_constants[(uint32_t)(v * 0x07C4ACDDU) >> 27];
 }
 
-uint32_t thresholder(uint16_t in) {
-    static ema_c<uint16_t, uint32_t, 1, 64>  avg_filter;
-    uint16_t avg = avg_filter.update(in);
-    return (in > avg);
-};
+uint8_t crc8_update(uint8_t crc, uint8_t b) {
+    crc ^= b;
+    for (uint8_t i=0;i<8;i++) {
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+    return crc;
+}
 
+uint8_t crc8(const uint8_t *d, uint8_t len) {
+    uint8_t crc = 0;
+    while (len--) crc = crc8_update(crc, *d++);
+    return crc;
+}
+
+
+#ifdef __AVR__
 
 int freeRam() {
   extern int __heap_start, *__brkval;
@@ -57,3 +56,84 @@ int freeRam() {
   return (int) &v - (__brkval == 0 ? (int) &__heap_start : (int) __brkval);
 }
 
+extern uint8_t _end;
+extern uint8_t __stack;
+
+// lowest byte found touched, and where the scan up to it has got to
+static uint8_t *stack_low = 0;
+static uint8_t *scan_at   = 0;
+
+// Runs from .init1, before the stack pointer is even set up, so it 
+// has to be done without using the stack at all.
+void stackPaint(void) __attribute__ ((naked, used, section (".init1")));
+void stackPaint(void) {
+    __asm volatile (
+        "    ldi r30,lo8(_end)\n"
+        "    ldi r31,hi8(_end)\n"
+        "    ldi r24,%[canary]\n"
+        "    ldi r25,hi8(__stack)\n"
+        "    rjmp 2f\n"
+        "1:\n"
+        "    st Z+,r24\n"
+        "2:\n"
+        "    cpi r30,lo8(__stack)\n"
+        "    cpc r31,r25\n"
+        "    brlo 1b\n"
+        "    breq 1b\n"
+        : : [canary] "M" (STACK_CANARY));
+}
+
+// A frame can leave bytes of its own unwritten, such as an array it
+// never fills, so a scan down from the stack can stop at a gap above
+// where the stack really got to. This scans up from the bottom to the
+// first byte that is not canary instead, a run at a time so that it
+// stays cheap enough for every time through the loop, or all of it
+// with whole. A pass that finds nothing below the last mark starts
+// over from the bottom.
+uint16_t stackFreeMin(bool whole) {
+    if (!stack_low) stack_low = (uint8_t *)SP;
+    if (whole || !scan_at || (scan_at >= stack_low)) scan_at = &_end;
+    for (uint16_t n=0;(whole || (n<STACK_SCAN_RUN)) && (scan_at<stack_low);n++) {
+        if (*scan_at != STACK_CANARY) {
+            stack_low = scan_at;
+            break;
+        }
+        scan_at++;
+    }
+    return stack_low - &_end;
+}
+
+// An interrupt's frame goes just below SP and is gone again when it
+// returns, so interrupts only need to be kept out while a run of
+// bytes is painted, not for all of it. One that comes in between runs
+// leaves its mark, which is stack that really was used.
+void stackRepaint() {
+    // leave a little room below the stack pointer for this function
+    uint8_t *top = (uint8_t *)SP - 8;
+    uint8_t *p   = &_end;
+    stack_low = top;
+    scan_at   = 0;
+    while (p <= top) {
+        uint8_t sreg = SREG;
+        noInterrupts();
+        for (uint8_t n=0;(n<32) && (p<=top);n++) {
+            *p++ = STACK_CANARY;
+        }
+        SREG = sreg;
+    }
+}
+
+#else
+
+int freeRam() {
+    return 0x7fff;
+}
+
+uint16_t stackFreeMin(bool) {
+    return 0xffff;
+}
+
+void stackRepaint() {
+}
+
+#endif
@@ -12,6 +12,10 @@
 #ifndef __helpers_h
 #define __helpers_h
 
+#include <stdint.h>
+#include "ema.h"
+#include "progmem.h"
+
 template<typename T, int size>
 int getLength(T(&)[size]){return size;}
 
@@ -29,18 +33,25 @@ T wrapIncr(T &in, uint8_t len) {
     return in;
 };
 
-uint8_t  fromProgMem8(const uint8_t   *pbase, uint8_t idx);
-uint16_t fromProgMem16(const uint16_t *pbase, uint8_t idx);
-uint32_t fromProgMem32(const uint32_t *pbase, uint8_t idx);
-
 // fast base2 log using lookup table
 uint32_t log2int(uint32_t in);
 
-// routine to take a time series and return true when
-// a given sample is larger than the average
-uint32_t thresholder(uint16_t in);
+// takes a time series and says when a sample is larger than the
+// average; each user needs its own, as it keeps the average
+class thresholder_c {
+    public:
+    thresholder_c() {
+        avg_filter.init(0);
+    };
+    bool update(uint16_t in) {
+        uint16_t avg = avg_filter.update(in);
+        return (in > avg);
+    }
+    private:
+    ema_c<uint16_t, uint32_t, 1, 64> avg_filter;
+};
 
-const uint8_t PROGMEM cylons[] = {
+const progmem_array<uint8_t, 36> cylons PROGMEM = {
       1,  2, 27, 28 ,
       0,  3, 29, 26 ,
       4, 25,  4, 25 ,
@@ -81,8 +92,28 @@ uint32_t scale2mask(uint16_t in) {
     return omsk;
 };
 
+// crc-8, polynomial 0x07
+uint8_t crc8(const uint8_t *d, uint8_t len);
+// one more byte, for data that is not all in one place
+uint8_t crc8_update(uint8_t crc, uint8_t b);
+
 int freeRam();
 
+// Free RAM is painted with STACK_CANARY before anything else runs at
+// boot (see helpers.cpp). stackFreeMin() scans up from the end of the
+// data for the first byte the stack has touched, and so returns the
+// fewest bytes there have ever been between the stack and the heap.
+// It scans STACK_SCAN_RUN bytes a call, so a new low can take one
+// call for every STACK_SCAN_RUN bytes free to show up, unless whole
+// is set.
+// stackRepaint() paints it all again, down from the current stack
+// pointer, to start a fresh measurement.
+const uint8_t STACK_CANARY   = 0xc5;
+const uint8_t STACK_SCAN_RUN = 64;
+
+uint16_t stackFreeMin(bool whole = false);
+void stackRepaint();
+
 #endif
 
 
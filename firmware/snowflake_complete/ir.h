@@ -13,7 +13,8 @@
 #define __IR_H
 
 #include <stdint.h>
-#include <IRLib2.h>
+#include <Arduino.h>
+#include "debug.h"
 
 typedef enum ir_decode_status_e {
     ir_nothing,
@@ -44,56 +45,279 @@ typedef struct ir_decoded_t {
 } ir_decoded_t;
 
 
+// The receiver is serviced by its own INT0/INT1 handler. Every edge
+// is timestamped with Timer1 (free running, /8 prescale) and the
+// length of the period that just ended is pushed into a small ring
+// buffer. The actual protocol decode happens in the main loop, from
+// code(), so the ISR stays a handful of instructions long.
+//
+// Only two protocols are understood: NEC (32b) and Sony (12b). Both
+// carry enough redundancy to reject a frame that had an edge moved 
+// or lost while interrupts were held off: NEC sends the command byte
+// followed by its complement and Sony remotes repeat every frame at
+// least three times, so we ask to see the same Sony code twice.
+
+const uint8_t IR_RING_LEN = 32; // must be a power of 2
+
+// Timer1 ticks per microsecond with the /8 prescaler
+const uint8_t IR_TICKS_PER_US = F_CPU / 8000000UL;
+
+// an edge this long after the previous one is just a gap
+const uint8_t IR_GAP_MILLIS   = 20;
+
+typedef enum ir_rx_state_e {
+    ir_st_idle,
+    ir_st_nec_hdr_space,
+    ir_st_nec_mark,
+    ir_st_nec_space,
+    ir_st_sony_space,
+    ir_st_sony_mark,
+} ir_rx_state_e;
+
+typedef enum ir_protocol_e {
+    ir_proto_none,
+    ir_proto_nec,
+    ir_proto_sony,
+} ir_protocol_e;
+
 template<uint8_t PIN, uint8_t wait_time>
 class ir_c {
+    // INT0 and INT1 are both on port D
+    static_assert((PIN == 2) || (PIN == 3), "IR input must be on INT0 or INT1");
+
     public:
-        ir_c() : recv(PIN), wait_count(0) {
-            recv.enableIRIn();
+        ir_c() : state(ir_st_idle), protocol(ir_proto_none), last_sony(0), last_sony_ms(0), 
+                 pending(ir_nothing), wait_count(0) { 
+            last_returned.status = ir_nothing;
+            last_returned.value  = ir_button_invalid;
         };
+
+        // Timer1 gets set up as a PWM timer by the Arduino core's
+        // init(), which runs after constructors, so this must be
+        // called from setup().
+        void begin() {
+            TCCR1A = 0;
+            TCCR1B = _BV(CS11);
+            pinMode(PIN, INPUT);
+            restart();
+        }
         void restart() {
-            recv.disableIRIn();
-            recv.enableIRIn();
+            noInterrupts();
+            ring_head = ring_tail = 0;
+            overflow  = false;
+            last_edge_t  = TCNT1;
+            last_edge_ms = millis();
+            interrupts();
+            state   = ir_st_idle;
+            pending = ir_nothing;
+            attachInterrupt(digitalPinToInterrupt(PIN), edge_isr, CHANGE);
         }
         ir_decoded_t code() {
             ir_decoded_t rv = {ir_nothing, ir_button_invalid };
-            if (recv.getResults()) {
-                decoder.decode();
-                if ((decoder.protocolNum == SONY) && (decoder.bits == 12)) {
+
+            _drain();
+
+            if (pending == ir_decoded) {
+                if ((protocol == ir_proto_sony) && (bits == 12)) {
                     rv = decodeSony();
-                } else if ((decoder.protocolNum == NEC) && (decoder.bits == 32)) {
+                } else if ((protocol == ir_proto_nec) && (bits == 32)) {
                     rv = decodeNEC();
                 } else {
                     rv.status = ir_error;
                 }
-                if (rv.status == ir_error) {
-                    decoder.dumpResults();
-                }
-                recv.enableIRIn();
+            } else if (pending == ir_error) {
+                rv.status = ir_error;
+            }
+            pending = ir_nothing;
 
-                if (rv.status == ir_decoded) {
-                    if (wait_count && (rv.value == last_returned.value)) {
-                        rv.status = ir_nothing;
-                    }  else {
-                        last_returned = rv;
-                    }
+            if (rv.status == ir_error) {
+                DEBUG_PVAR_FMT(value, HEX);
+                DEBUG_PVAR(bits);
+            }
+
+            if (rv.status == ir_decoded) {
+                if (wait_count && (rv.value == last_returned.value)) {
+                    rv.status = ir_nothing;
+                }  else {
+                    last_returned = rv;
+                    wait_count = wait_time;
                 }
             }
             if (wait_count) wait_count -= 1;
             return rv;
         };
-        // routine to tell us if a decode is in progress. Notice
-        // that these variables are not in this class; they are 
-        // globals created by the IRLib2 library. :-(
+        // routine to tell us if a decode is in progress. 
         bool isIdle() {
-            return (recvGlobal.currentState == STATE_FINISHED) ||
-                   (recvGlobal.currentState == STATE_READY_TO_BEGIN);
-};
+            if (ring_head != ring_tail) return false;
+            if (state == ir_st_idle) return true;
+            noInterrupts();
+            uint32_t since = millis() - last_edge_ms;
+            interrupts();
+            return since > IR_GAP_MILLIS;
+        };
+
     private:
+        // Each ring entry is the length of a period in timer ticks, 
+        // with the LSB replaced by 1 if the period was a mark (IR
+        // carrier present, receiver output low).
+        static volatile uint16_t ring[IR_RING_LEN];
+        static volatile uint8_t  ring_head;
+        static volatile uint8_t  ring_tail;
+        static volatile bool     overflow;
+        static volatile uint16_t last_edge_t;
+        static volatile uint32_t last_edge_ms;
+
+        static void edge_isr() {
+            uint16_t now_t  = TCNT1;
+            uint32_t now_ms = millis();
+            // a rising edge ends a mark
+            bool was_mark = PIND & _BV(PIN);
+            uint16_t d = now_t - last_edge_t;
+            if ((now_ms - last_edge_ms) > IR_GAP_MILLIS) d = 0xfffe;
+            last_edge_t  = now_t;
+            last_edge_ms = now_ms;
+
+            uint8_t next = (ring_head + 1) & (IR_RING_LEN - 1);
+            if (next == ring_tail) {
+                overflow = true;
+                return;
+            }
+            ring[ring_head] = (d & 0xfffe) | (was_mark ? 1 : 0);
+            ring_head = next;
+        }
+
+        // is a duration within +/- 25% of the nominal?
+        static bool _near(uint16_t ticks, uint16_t nominal_us) {
+            uint16_t nom = nominal_us * IR_TICKS_PER_US;
+            uint16_t tol = nom >> 2;
+            return (ticks > (nom - tol)) && (ticks < (nom + tol));
+        }
+
+        void _fail() {
+            if (state != ir_st_idle) pending = ir_error;
+            state = ir_st_idle;
+        }
+
+        void _finish(ir_protocol_e proto) {
+            protocol = proto;
+            pending  = ir_decoded;
+            state    = ir_st_idle;
+        }
+
+        void _drain() {
+            while (ring_tail != ring_head) {
+                if (overflow) {
+                    noInterrupts();
+                    ring_tail = ring_head;
+                    overflow  = false;
+                    interrupts();
+                    _fail();
+                    return;
+                }
+                uint16_t e = ring[ring_tail];
+                ring_tail = (ring_tail + 1) & (IR_RING_LEN - 1);
+                _step(e & 0xfffe, e & 0x1);
+                if (pending != ir_nothing) return;
+            }
+        }
+
+        void _step(uint16_t d, bool mark) {
+            switch (state) {
+                case ir_st_idle:
+                    // spaces while idle are just the gap before a frame
+                    if (!mark) break;
+                    if (_near(d, 9000)) {
+                        state = ir_st_nec_hdr_space;
+                    } else if (_near(d, 2400)) {
+                        state = ir_st_sony_space;
+                        value = 0;
+                        bits  = 0;
+                    }
+                    break;
+
+                case ir_st_nec_hdr_space:
+                    if (mark) { 
+                        _fail(); 
+                    } else if (_near(d, 4500)) {
+                        state = ir_st_nec_mark;
+                        value = 0;
+                        bits  = 0;
+                    } else {
+                        // 2250us is a repeat code, which we ignore, as
+                        // does anything else that is not a full frame.
+                        state = ir_st_idle;
+                    }
+                    break;
+
+                case ir_st_nec_mark:
+                    if (!mark || !_near(d, 560)) {
+                        _fail();
+                    } else if (bits == 32) {
+                        // this is the stop bit
+                        _finish(ir_proto_nec);
+                    } else {
+                        state = ir_st_nec_space;
+                    }
+                    break;
+
+                case ir_st_nec_space:
+                    if (mark) {
+                        _fail();
+                    } else {
+                        value <<= 1;
+                        if (_near(d, 1690)) {
+                            value |= 1;
+                        } else if (!_near(d, 560)) {
+                            _fail();
+                            break;
+                        }
+                        bits += 1;
+                        state = ir_st_nec_mark;
+                    }
+                    break;
+
+                case ir_st_sony_space:
+                    if (mark || !_near(d, 600)) {
+                        _fail();
+                    } else {
+                        state = ir_st_sony_mark;
+                    }
+                    break;
+
+                case ir_st_sony_mark:
+                    if (!mark) {
+                        _fail();
+                    } else {
+                        value <<= 1;
+                        if (_near(d, 1200)) {
+                            value |= 1;
+                        } else if (!_near(d, 600)) {
+                            _fail();
+                            break;
+                        }
+                        bits += 1;
+                        if (bits == 12) {
+                            _finish(ir_proto_sony);
+                        } else {
+                            state = ir_st_sony_space;
+                        }
+                    }
+                    break;
+
+                default:
+                    state = ir_st_idle;
+                    break;
+            }
+        }
+
         ir_decoded_t decodeNEC() {
             ir_decoded_t rv = {ir_error, ir_button_invalid };
-            if ((decoder.protocolNum == NEC) && (decoder.bits == 32)) {
-                DEBUG_PVAR_FMT(decoder.value,HEX);
-                switch (decoder.value & 0xffff) {
+            // the command byte is followed by its complement
+            uint8_t cmd  = (value >> 8) & 0xff;
+            uint8_t ncmd = value & 0xff;
+            if ((bits == 32) && ((uint8_t)~cmd == ncmd)) {
+                DEBUG_PVAR_FMT(value,HEX);
+                switch (value & 0xffff) {
                     case 0xa25d: // "1"
                         rv.value = ir_button_next_pattern; 
                         break;
@@ -154,9 +378,19 @@ class ir_c {
         };
         ir_decoded_t decodeSony() {
             ir_decoded_t rv = {ir_error, ir_button_invalid };
-            if ((decoder.protocolNum == SONY) && (decoder.bits == 12)) {
+            // Only believe a Sony code once it has been seen twice in
+            // a row. The remote sends at least three copies 45ms apart.
+            uint32_t now = millis();
+            bool confirmed = (value == last_sony) && ((now - last_sony_ms) < 100);
+            last_sony    = confirmed ? 0 : value;
+            last_sony_ms = now;
+            if (!confirmed) {
+                rv.status = ir_nothing;
+                return rv;
+            }
+            if (bits == 12) {
                 rv.status = ir_decoded;
-                switch (decoder.value) {
+                switch (value) {
                     case 0x010 : /* 1 */ rv.value = ir_button_next_pattern;   break;
                     case 0x810 : /* 2 */ rv.value = ir_button_next_variation; break;
                     case 0x410 : /* 3 */ rv.value = ir_button_save;           break;
@@ -173,11 +407,29 @@ class ir_c {
             }
             return rv;
         }
-        IRrecv recv;
-        IRdecode decoder;
+        ir_rx_state_e state;
+        ir_protocol_e protocol;
+        uint32_t value;
+        uint8_t  bits;
+        uint16_t last_sony;
+        uint32_t last_sony_ms;
+        ir_decode_status_e pending;
         ir_decoded_t last_returned;
         uint8_t wait_count;
 };
 
+template<uint8_t PIN, uint8_t wait_time>
+volatile uint16_t ir_c<PIN, wait_time>::ring[IR_RING_LEN];
+template<uint8_t PIN, uint8_t wait_time>
+volatile uint8_t  ir_c<PIN, wait_time>::ring_head = 0;
+template<uint8_t PIN, uint8_t wait_time>
+volatile uint8_t  ir_c<PIN, wait_time>::ring_tail = 0;
+template<uint8_t PIN, uint8_t wait_time>
+volatile bool     ir_c<PIN, wait_time>::overflow = false;
+template<uint8_t PIN, uint8_t wait_time>
+volatile uint16_t ir_c<PIN, wait_time>::last_edge_t = 0;
+template<uint8_t PIN, uint8_t wait_time>
+volatile uint32_t ir_c<PIN, wait_time>::last_edge_ms = 0;
+
 #endif
 
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __memwatch_h
+#define __memwatch_h
+
+#include <stdint.h>
+#include "debug.h"
+#include "helpers.h"
+
+// Keeps the stack high-water mark (as the least free RAM seen) for 
+// each pattern and each sound mode. update() is cheap enough to call 
+// every time through the loop. When the pattern or mode changes, the
+// low point for the one just finished is reported over the debug
+// channel and the free RAM is repainted so that the next measurement
+// starts fresh.
+template<uint8_t NPATTERNS, uint8_t NMODES>
+class memwatch_c {
+    public:
+    memwatch_c() : cur_pattern(0), cur_mode(0) {
+        for (uint8_t i=0;i<NPATTERNS;i++) pattern_min[i] = 0xffff;
+        for (uint8_t i=0;i<NMODES;i++)    mode_min[i]    = 0xffff;
+    };
+
+    // returns the least free RAM seen since the last repaint
+    uint16_t update(uint8_t pattern, uint8_t mode) {
+        bool changed = (pattern != cur_pattern) || (mode != cur_mode);
+        // the whole of the free RAM before a change, so that the one
+        // just finished gets all of its low point
+        uint16_t f = stackFreeMin(changed);
+        if (f < pattern_min[cur_pattern]) pattern_min[cur_pattern] = f;
+        if (f < mode_min[cur_mode])       mode_min[cur_mode] = f;
+
+        if (changed) {
+            DEBUG_PRINTLN_F("stack low water");
+            DEBUG_PVAR(cur_pattern);
+            DEBUG_PVAR(cur_mode);
+            DEBUG_PVAR(f);
+            cur_pattern = pattern < NPATTERNS ? pattern : 0;
+            cur_mode    = mode    < NMODES    ? mode    : 0;
+            stackRepaint();
+        }
+        return f;
+    }
+
+    uint16_t patternMin(uint8_t pattern) const {
+        return pattern_min[pattern];
+    }
+    uint16_t modeMin(uint8_t mode) const {
+        return mode_min[mode];
+    }
+
+    void report() {
+        DEBUG_PRINTLN_F("stack low water by pattern");
+        for (uint8_t i=0;i<NPATTERNS;i++) {
+            DEBUG_PVAR(i);
+            DEBUG_PVAR(pattern_min[i]);
+            // the trace ring is small; this is on demand, so wait
+            DEBUG_FLUSH();
+        }
+        DEBUG_PRINTLN_F("stack low water by sound mode");
+        for (uint8_t i=0;i<NMODES;i++) {
+            DEBUG_PVAR(i);
+            DEBUG_PVAR(mode_min[i]);
+            DEBUG_FLUSH();
+        }
+    }
+
+    private:
+    uint16_t pattern_min[NPATTERNS];
+    uint16_t mode_min[NMODES];
+    uint8_t  cur_pattern;
+    uint8_t  cur_mode;
+};
+
+#endif
+
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "helpers.h"
+#include "mirror.h"
+#include "uart.h"
+
+#ifdef MIRROR_ENABLE
+
+uint8_t          mirror_c::buf[MIRROR_BYTES];
+uint8_t          mirror_c::crc   = 0;
+uint8_t          mirror_c::seq   = 0;
+uint16_t         mirror_c::drops = 0;
+uint16_t         mirror_c::hdr_drops = 0;
+volatile bool    mirror_c::busy  = false;
+volatile uint8_t mirror_c::pos   = 0;
+
+void mirror_c::begin() {
+    uart_c::begin(MIRROR_BAUD);
+    uart_c::txSource(_next);
+}
+
+void mirror_c::frame(const pixel_t *out) {
+    if (busy) {
+        drops += 1;
+        return;
+    }
+    memcpy(buf, out, MIRROR_BYTES);
+    crc  = crc8(buf, MIRROR_BYTES);
+    seq += 1;
+    // drops can change while this frame goes out
+    hdr_drops = drops;
+    pos  = 0;
+    uint8_t sreg = SREG;
+    noInterrupts();
+    busy = true;
+    uart_c::txStart();
+    SREG = sreg;
+}
+
+// from the UART interrupt
+int16_t mirror_c::_next(bool &more) {
+    if (!busy) {
+        more = false;
+        return -1;
+    }
+    uint8_t p = pos++;
+    uint8_t b;
+    more = true;
+    switch (p) {
+        case 0:  b = MIRROR_SYNC;       break;
+        case 1:  b = seq;               break;
+        case 2:  b = hdr_drops & 0xff;  break;
+        case 3:  b = hdr_drops >> 8;    break;
+        case 4:  b = PIXEL_CHAIN_LENGTH; break;
+        default:
+            if (p < MIRROR_HDR_LEN + MIRROR_BYTES) {
+                b = buf[p - MIRROR_HDR_LEN];
+            } else {
+                b    = crc;
+                more = false;
+                busy = false;
+            }
+            break;
+    }
+    return b;
+}
+
+#endif
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __mirror_h
+#define __mirror_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "debug.h"
+#include "pixel.h"
+#include "settings.h"
+
+// Sends a copy of every frame that goes out to the pixels up the UART,
+// so that tools/mirror_view.py can draw what the snowflake is showing.
+// A frame is
+//
+//   0xb4, seq, dropped (2 bytes), n, G R B ... (n pixels), crc8
+//
+// with seq counting frames sent and dropped counting (and wrapping)
+// frames there was no room for, and the crc over the pixel bytes.
+// 0xb4 is not a trace record (see trace.h), so the two can share the
+// wire; a frame is never split by trace records.
+//
+// frame() copies the pixels and returns; the bytes go out from the
+// UART interrupt. There is room for one frame, so if the last one is
+// still going out, this one is dropped. At MIRROR_BAUD a 30 pixel 
+// frame takes about 3.8ms, so everything but the fastest speeds gets
+// every frame.
+//
+// Needs the UART to itself, or shared with TRACE_DEBUG (which then
+// runs at MIRROR_BAUD too).
+
+// #define MIRROR_ENABLE
+
+#if defined(MIRROR_ENABLE) && (defined(SERIAL_DEBUG) || defined(SYNC_ENABLE) || defined(STREAM_ENABLE))
+#error "MIRROR_ENABLE needs the UART; SERIAL_DEBUG, SYNC_ENABLE and STREAM_ENABLE use it too"
+#endif
+
+const uint32_t MIRROR_BAUD    = 250000; // exact at 8MHz with U2X
+const uint8_t  MIRROR_SYNC    = 0xb4;
+const uint8_t  MIRROR_HDR_LEN = 5;
+const uint8_t  MIRROR_BYTES   = PIXEL_CHAIN_LENGTH * sizeof(pixel_t);
+
+class mirror_c {
+    public:
+        static void begin();
+        // out is what show() just sent
+        static void frame(const pixel_t *out);
+        static uint16_t dropped() {
+            return drops;
+        }
+        static int16_t _next(bool &more);
+    private:
+        static uint8_t buf[MIRROR_BYTES];
+        static uint8_t crc;
+        static uint8_t seq;
+        static uint16_t drops;
+        static uint16_t hdr_drops;
+        static volatile bool    busy;
+        static volatile uint8_t pos;
+};
+
+#endif
@@ -0,0 +1,144 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __osc_h
+#define __osc_h
+
+#include <stdint.h>
+#include "tables.h"
+
+// Oscillators for patterns that move in waves. Each is a 16-bit phase
+// that goes up by its frequency every step(), so a frequency of 256
+// goes once round a 256-step wave a tick, and smaller ones move more
+// slowly without stalling. The top byte of the phase is the position
+// in the wave; smooth() also uses the bottom byte, to interpolate
+// (host/osccheck.cpp checks it against the table).
+//
+// Patterns that draw the same wave along the chain take a sweep(),
+// which steps the phase from pixel to pixel with an add, rather than
+// working out the whole argument again for every pixel.
+
+typedef enum osc_wave_t {
+    OSC_SINE,     // sine8()
+    OSC_TRIANGLE, // 0 up to 255 and back down
+    OSC_SQUARE,   // 0 for the first half, 255 for the second
+    OSC_SAW,      // 0 up to 255, then back to 0
+} osc_wave_t;
+
+// The wave at phase ph, to 8 bits of phase. The triangle has 9, as it
+// goes both ways.
+inline uint8_t oscWave(osc_wave_t w, uint16_t ph) {
+    switch (w) {
+        case OSC_SINE:     return sine8(ph >> 8);
+        case OSC_TRIANGLE: {
+            uint16_t t = ph << 1;
+            if (ph & 0x8000) t = ~t;
+            return t >> 8;
+        }
+        case OSC_SQUARE:   return (ph & 0x8000) ? 0xff : 0;
+        case OSC_SAW:      return ph >> 8;
+        default:           return 0;
+    }
+}
+
+// The same, with the sine interpolated between table entries.
+inline uint8_t oscSmooth(osc_wave_t w, uint16_t ph) {
+    if (w != OSC_SINE) return oscWave(w, ph);
+    uint8_t i = ph >> 8;
+    uint8_t a = sine8(i);
+    uint8_t b = sine8(i + 1);
+    uint8_t f = ph & 0xff;
+    return (b >= a) ? a + (((uint16_t)(b - a) * f) >> 8) :
+                      a - (((uint16_t)(a - b) * f) >> 8);
+}
+
+// Walks a wave along the chain: next() gives a value and moves on by
+// the step it was made with.
+class osc_sweep_c {
+    public:
+    osc_sweep_c(uint16_t start, uint16_t instep) : ph(start), step(instep) { };
+
+    uint8_t next(osc_wave_t w) {
+        uint8_t v = oscWave(w, ph);
+        ph += step;
+        return v;
+    }
+
+    private:
+    uint16_t ph;
+    uint16_t step;
+};
+
+class osc_c {
+    public:
+    osc_c(uint16_t infreq = 0, uint16_t inphase = 0) : phase(inphase), freq(infreq) { };
+
+    void setFreq(uint16_t f) {
+        freq = f;
+    }
+    void setPhase(uint16_t p) {
+        phase = p;
+    }
+    uint16_t getPhase() const {
+        return phase;
+    }
+    uint16_t getFreq() const {
+        return freq;
+    }
+
+    void step() {
+        phase += freq;
+    }
+
+    // true if the last step() went round past 0 (or nothing has moved
+    // it yet), so the wave is starting over
+    bool wrapped() const {
+        return phase < freq || (!phase);
+    }
+
+    uint8_t value(osc_wave_t w, uint16_t offset = 0) const {
+        return oscWave(w, phase + offset);
+    }
+    uint8_t smooth(osc_wave_t w, uint16_t offset = 0) const {
+        return oscSmooth(w, phase + offset);
+    }
+
+    // from offset ahead of the phase, step further on for each pixel
+    osc_sweep_c sweep(uint16_t offset, uint16_t step) const {
+        return osc_sweep_c(phase + offset, step);
+    }
+
+    private:
+    uint16_t phase;
+    uint16_t freq;
+};
+
+// N oscillators stepped together, for a pattern with several things
+// moving at their own speeds.
+template<uint8_t N>
+class osc_bank_c {
+    public:
+    void step() {
+        for (uint8_t i=0;i<N;i++) osc[i].step();
+    }
+    osc_c &operator[](uint8_t i) {
+        return osc[i];
+    }
+    const osc_c &operator[](uint8_t i) const {
+        return osc[i];
+    }
+
+    private:
+    osc_c osc[N];
+};
+
+#endif
+
@@ -0,0 +1,192 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __palette_h
+#define __palette_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "fun_stuff.h"
+#include "osc.h"
+
+// Gradient palettes: 16 colors evenly spaced round a loop, so that a
+// pattern can turn any 8-bit number into a color with one lookup and
+// one mix. Index 16*i is stop i exactly; those in between mix the two
+// stops either side, and past the last stop it goes back to the first.
+//
+// The palettes are in flash, as red, green, blue for each stop, and
+// cost no RAM. A palette_fader_c fades from one to another over a
+// number of ticks, by looking up the color in both and mixing.
+
+const uint8_t PALETTE_STOPS = 16;
+
+typedef enum palette_name_t {
+    PAL_RAINBOW,
+    PAL_ICE,
+    PAL_FIRE,
+    PAL_OCEAN,
+    PAL_FOREST,
+    PAL_LAVA,
+    PAL_PARTY,
+    PAL_SUNSET,
+    PAL_COUNT,
+} palette_name_t;
+
+const uint8_t palettes[PAL_COUNT][PALETTE_STOPS * 3] PROGMEM = {
+    { // rainbow
+        0xff,0x00,0x00, 0xff,0x60,0x00, 0xff,0xbf,0x00, 0xdf,0xff,0x00,
+        0x80,0xff,0x00, 0x20,0xff,0x00, 0x00,0xff,0x40, 0x00,0xff,0x9f,
+        0x00,0xff,0xff, 0x00,0x9f,0xff, 0x00,0x40,0xff, 0x20,0x00,0xff,
+        0x80,0x00,0xff, 0xdf,0x00,0xff, 0xff,0x00,0xbf, 0xff,0x00,0x60,
+    },
+    { // ice
+        0xff,0xff,0xff, 0xcf,0xe7,0xff, 0xa0,0xd0,0xff, 0x70,0xb0,0xff,
+        0x40,0x80,0xff, 0x10,0x50,0xff, 0x00,0x30,0xd7, 0x00,0x18,0x9c,
+        0x00,0x00,0x60, 0x00,0x30,0x84, 0x00,0x60,0xa8, 0x14,0x8c,0xc8,
+        0x50,0xb0,0xe0, 0x8c,0xd4,0xf7, 0xb8,0xe8,0xff, 0xdb,0xf3,0xff,
+    },
+    { // fire
+        0x00,0x00,0x00, 0x40,0x00,0x00, 0x80,0x00,0x00, 0xc0,0x10,0x00,
+        0xff,0x20,0x00, 0xff,0x58,0x00, 0xff,0x90,0x00, 0xff,0xb8,0x20,
+        0xff,0xe0,0x40, 0xff,0xb8,0x20, 0xff,0x90,0x00, 0xff,0x58,0x00,
+        0xff,0x20,0x00, 0xc0,0x10,0x00, 0x80,0x00,0x00, 0x40,0x00,0x00,
+    },
+    { // ocean
+        0x00,0x00,0x40, 0x00,0x10,0x70, 0x00,0x20,0xa0, 0x00,0x50,0xb0,
+        0x00,0x80,0xc0, 0x00,0xa8,0xc8, 0x00,0xd0,0xd0, 0x20,0xe8,0xc8,
+        0x40,0xff,0xc0, 0x20,0xc0,0xc0, 0x00,0x80,0xc0, 0x00,0x50,0xb0,
+        0x00,0x20,0xa0, 0x00,0x10,0x80, 0x00,0x00,0x60, 0x00,0x00,0x50,
+    },
+    { // forest
+        0x00,0x30,0x00, 0x00,0x58,0x08, 0x00,0x80,0x10, 0x30,0xa0,0x08,
+        0x60,0xc0,0x00, 0x70,0xa0,0x00, 0x80,0x80,0x00, 0x50,0x70,0x10,
+        0x20,0x60,0x20, 0x10,0x80,0x30, 0x00,0xa0,0x40, 0x20,0x80,0x20,
+        0x40,0x60,0x00, 0x20,0x50,0x08, 0x00,0x40,0x10, 0x00,0x38,0x08,
+    },
+    { // lava
+        0x00,0x00,0x00, 0x20,0x00,0x00, 0x40,0x00,0x00, 0x70,0x00,0x00,
+        0xa0,0x00,0x00, 0xd0,0x20,0x00, 0xff,0x40,0x00, 0xff,0x70,0x10,
+        0xff,0xa0,0x20, 0xd0,0x58,0x10, 0xa0,0x10,0x00, 0x70,0x08,0x00,
+        0x40,0x00,0x00, 0x28,0x00,0x00, 0x10,0x00,0x00, 0x08,0x00,0x00,
+    },
+    { // party
+        0x80,0x00,0xff, 0xc0,0x00,0xc0, 0xff,0x00,0x80, 0xff,0x20,0x40,
+        0xff,0x40,0x00, 0xff,0x80,0x00, 0xff,0xc0,0x00, 0xa0,0xe0,0x00,
+        0x40,0xff,0x00, 0x20,0xe0,0x80, 0x00,0xc0,0xff, 0x00,0x80,0xff,
+        0x00,0x40,0xff, 0x20,0x20,0xe0, 0x40,0x00,0xc0, 0x60,0x00,0xe0,
+    },
+    { // sunset
+        0x40,0x00,0x60, 0x70,0x00,0x70, 0xa0,0x00,0x80, 0xd0,0x10,0x60,
+        0xff,0x20,0x40, 0xff,0x40,0x20, 0xff,0x60,0x00, 0xff,0x88,0x10,
+        0xff,0xb0,0x20, 0xff,0x88,0x10, 0xff,0x60,0x00, 0xe0,0x38,0x18,
+        0xc0,0x10,0x30, 0x90,0x08,0x48, 0x60,0x00,0x60, 0x50,0x00,0x60,
+    },
+};
+
+inline pixel_t paletteStop(uint8_t pal, uint8_t stop) {
+    const uint8_t *p = palettes[pal % PAL_COUNT] + 3 * (stop % PALETTE_STOPS);
+    return pixel_t(pgm_read_byte(p), pgm_read_byte(p + 1), pgm_read_byte(p + 2));
+}
+
+// the color at idx in palette pal
+inline pixel_t paletteColor(uint8_t pal, uint8_t idx) {
+    uint8_t stop = idx >> 4;
+    pixel_t a = paletteStop(pal, stop);
+    uint8_t f = idx << 4;
+    if (!f) return a;
+    pixel_t c;
+    c.mix(a, paletteStop(pal, stop + 1), f);
+    return c;
+}
+
+// Looks colors up in one palette, or while it is fading, in a mix of
+// the one it was and the one it is going to.
+class palette_fader_c {
+    public:
+    palette_fader_c(uint8_t pal = 0) : from(pal), to(pal), progress(0xff), rate(0) { };
+
+    // straight to pal, with no fade
+    void jump(uint8_t pal) {
+        from = to = pal;
+        progress = 0xff;
+    }
+
+    // from whatever it is now to pal, rate/255 of the way a step. A
+    // fade that is not done yet is cut short.
+    void fadeTo(uint8_t pal, uint8_t inrate) {
+        from     = to;
+        to       = pal;
+        progress = 0;
+        rate     = inrate ? inrate : 1;
+    }
+
+    void step() {
+        uint8_t p = progress + rate;
+        progress = (p < progress) ? 0xff : p;
+    }
+
+    bool fading() const {
+        return progress != 0xff;
+    }
+    uint8_t target() const {
+        return to;
+    }
+
+    pixel_t color(uint8_t idx) const {
+        pixel_t b = paletteColor(to, idx);
+        if (!fading()) return b;
+        pixel_t c;
+        c.mix(paletteColor(from, idx), b, progress);
+        return c;
+    }
+
+    private:
+    uint8_t from;
+    uint8_t to;
+    uint8_t progress;
+    uint8_t rate;
+};
+
+// The palette var0 picks, turning slowly round the snowflake. A new
+// var0 fades into the next palette over about a second.
+template<class PIX_C, class SENS_C, class VARNS_C>
+class Fun_Palette_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
+    typedef Fun_Base_c<PIX_C, SENS_C, VARNS_C> parent_t;
+
+    public:
+    Fun_Palette_c(PIX_C &inp, SENS_C &insens, VARNS_C &invarns) :
+        parent_t(inp,insens,invarns), osc(0x180) { };
+
+    void init() {
+        fader.jump(parent_t::varns.var0_idx % PAL_COUNT);
+    }
+
+    void _tick() {
+        uint8_t pal = parent_t::varns.var0_idx % PAL_COUNT;
+        if (pal != fader.target()) fader.fadeTo(pal, PALETTE_FADE_RATE);
+
+        // the whole palette once round the chain
+        osc_sweep_c s = osc.sweep(0, 0x10000UL / parent_t::pixels.len());
+        for (uint8_t i=0;i<parent_t::pixels.len();i++) {
+            parent_t::pixels.set(i, fader.color(s.next(OSC_SAW)));
+        }
+        fader.step();
+        osc.step();
+    }
+
+    private:
+    static const uint8_t PALETTE_FADE_RATE = 16;
+    osc_c osc;
+    palette_fader_c fader;
+};
+
+#endif
+
@@ -0,0 +1,62 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __patterns_h
+#define __patterns_h
+
+#include "fun_stuff.h"
+
+// Every pattern, in the order that pattern_idx counts them, for the
+// sketch and the host programs (host/sim.h) to build their patterns[]
+// from, so that the two cannot drift apart. Each entry is
+//
+//   PATTERN(name, class, extra constructor arguments)
+//
+// which is a fun_<name> object of class<pixels, sensors, varns>, made
+// with (pixels, sensors, varns, extra arguments...). The tools that
+// name patterns (tools/*_report.py) read the names from here too.
+//
+// New patterns go at the end, as the index is what the EEPROM, the IR
+// remote's auto mode and the energy table remember.
+
+#define SNOWFLAKE_PATTERNS(PATTERN) \
+    PATTERN(chaser,     Fun_Chaser_c) \
+    PATTERN(sparkle,    Fun_Sparkle_c) \
+    PATTERN(rainbow,    Fun_Rainbow_c) \
+    PATTERN(sparse,     Fun_Sparse_c) \
+    PATTERN(snake,      Fun_Snake7_c) \
+    PATTERN(leaves,     Fun_Leaves_c) \
+    PATTERN(flash,      Fun_Flash_c) \
+    PATTERN(cylon,      Fun_Cylon_c) \
+    PATTERN(solid,      Fun_Solid_c) \
+    PATTERN(minicircle, Fun_MiniCircle_c) \
+    PATTERN(inching,    Fun_Inching_c) \
+    PATTERN(pulse,      Fun_Pulse_c) \
+    PATTERN(fade,       Fun_Fade_c) \
+    PATTERN(lines,      Fun_Lines_c) \
+    PATTERN(settings,   Fun_Settings_c) \
+    PATTERN(vm,         Fun_VM_c, vm_prog_arms) \
+    PATTERN(reveal,     Fun_Clip_c, clip_reveal) \
+    PATTERN(palette,    Fun_Palette_c)
+
+// the snake the sketch uses is 7 pixels long
+template<class PIX_C, class SENS_C, class VARNS_C>
+using Fun_Snake7_c = Fun_Snake_c<PIX_C, SENS_C, VARNS_C, 7>;
+
+// PAT_chaser, PAT_sparkle, ... and PATTERN_COUNT
+#define _PATTERN_ENUM(name, ...) PAT_##name,
+enum pattern_id_t : uint8_t {
+    SNOWFLAKE_PATTERNS(_PATTERN_ENUM)
+    PATTERN_COUNT
+};
+#undef _PATTERN_ENUM
+
+#endif
@@ -13,6 +13,22 @@
 
 // #define INTERRUPTABLE // probably not a great idea
 
+// Send the frame a pixel at a time with interrupts enabled briefly
+// in between, so that millis(), the IR decoder and the UART do not 
+// have to wait out the whole frame.
+#define CHUNKED_SHOW
+
+// longest gap allowed between pixels, kept under the ~50us after
+// which the LEDs latch, and the time to wait to be sure they have
+const uint8_t SHOW_GAP_MAX_US   = 40;
+const uint8_t SHOW_LATCH_US     = 80;
+const uint8_t SHOW_MAX_RESTARTS = 3;
+// Timer0 is running at /64 for millis(), so a tick is 8us at 8MHz.
+// A gap read as n ticks may have been most of n+1, so a gap is only
+// taken if it reads under SHOW_GAP_TICKS, which is then under 40us.
+const uint8_t SHOW_TICK_US      = 64 / (F_CPU / 1000000UL);
+const uint8_t SHOW_GAP_TICKS    = SHOW_GAP_MAX_US / SHOW_TICK_US;
+
 template<uint8_t CHAIN_LENGTH, uint8_t OPIN>
 class PixChain_c {
 
@@ -21,6 +37,7 @@ class PixChain_c {
     pixel_t outdata[CHAIN_LENGTH];
 
     pixel_t temppixel;
+    mutable uint16_t show_restarts;
     uint8_t safen(const uint8_t n) const {
 #ifndef __AVR__
         assert(n<CHAIN_LENGTH);
@@ -37,7 +54,14 @@ class PixChain_c {
     }
     public:
 
-    PixChain_c() { 
+    // true if show() leaves interrupts serviceable while it runs
+#ifdef CHUNKED_SHOW
+    static const bool IRQ_FRIENDLY = true;
+#else
+    static const bool IRQ_FRIENDLY = false;
+#endif
+
+    PixChain_c() : show_restarts(0) { 
         _finish_setup();
     }
 
@@ -46,16 +70,20 @@ class PixChain_c {
     }
 
     // copy "working" buffer to output buffer, optionally applying
-    // a mask for scaling factor
+    // a mask for scaling factor. On chains longer than 32 the mask
+    // starts over every 32 pixels.
     void copyToOut(uint32_t mask = -1, uint8_t scale = -1) {
 
-        uint32_t max_mask = (uint32_t)-1 >> (32-CHAIN_LENGTH);
-        mask &= max_mask;
+        if (CHAIN_LENGTH < 32) {
+            uint32_t max_mask = (uint32_t)-1 >> ((32-CHAIN_LENGTH) & 31);
+            mask &= max_mask;
+        }
+        const uint32_t first_mask = mask;
 
         for (uint8_t i=0;i<CHAIN_LENGTH;i++) {
             pixel_t np(0,0,0);
 
-            
+            if ((CHAIN_LENGTH > 32) && i && !(i & 31)) mask = first_mask;
             if (mask & 0x1) {
                 np = pixdata[i];
                 np.scale(scale);
@@ -162,6 +190,26 @@ class PixChain_c {
     pixel_t *getAll() {
         return pixdata;
     }
+    // what the last copyToOut() left to be sent
+    const pixel_t *getOut() const {
+        return outdata;
+    }
+
+    // Every channel of every pixel the mask lets through, added up, as
+    // copyToOut() would send them at full scale. What the chain draws
+    // goes up with this, times the scale.
+    uint32_t load(uint32_t mask = -1) const {
+        const uint32_t first_mask = mask;
+        uint32_t sum = 0;
+        for (uint8_t i=0;i<CHAIN_LENGTH;i++) {
+            if ((CHAIN_LENGTH > 32) && i && !(i & 31)) mask = first_mask;
+            if (mask & 0x1) {
+                for (uint8_t c=0;c<sizeof(pixel_t);c++) sum += pixdata[i].d[c];
+            }
+            mask >>= 1;
+        }
+        return sum;
+    }
 
     void dump() {
         for (uint8_t i=0;i<CHAIN_LENGTH;i++) {
@@ -172,23 +220,21 @@ class PixChain_c {
         }
     }
 
-    void show() const {
-#ifndef INTERRUPTABLE
-        noInterrupts();
-#endif
-
+    private:
+    // bit-bang count bytes out to the chain. Must be called with
+    // interrupts off.
+    void _send(const uint8_t *buf, uint16_t count) const {
 #ifdef __AVR__
 
         volatile uint8_t *port = &PORTD;
-        volatile uint8_t *ptr = (uint8_t *)(void *)outdata;        
+        volatile uint8_t *ptr = (uint8_t *)(void *)buf;
         volatile uint8_t b = *ptr++;
         uint8_t pinmask = 0x1 << OPIN;
         volatile uint8_t hi = *port | pinmask;
         volatile uint8_t lo = *port & ~pinmask;
-        volatile uint16_t i = sizeof(outdata);
+        volatile uint16_t i = count;
 
 #if F_CPU >= 14000000 && F_CPU <= 19000000
-        DEBUG_PRINTLN("This is 16 MHz code");
         volatile uint8_t next, bit;
 
         next = lo;
@@ -235,12 +281,9 @@ class PixChain_c {
 #if F_CPU > 7000000 && F_CPU <= 9000000
 
         volatile uint8_t n1, n2 = 0;  // First, next bits out
-        if (false) {
-            uint8_t tmp = hi;
-            hi = lo;
-            lo = tmp; 
-            n1 = lo;
-        }
+        // n1 must start out low, otherwise the first bit sent is
+        // whatever happened to be in the register
+        n1 = lo;
 
         if(b & 0x80) n1 = hi;
 
@@ -330,15 +373,75 @@ class PixChain_c {
 #endif
 
 #else
+        (void)buf;
+        (void)count;
+#endif
+    };
+
+#ifdef CHUNKED_SHOW
+    // Send the frame one pixel at a time, opening a short window
+    // between pixels so that pending interrupts get serviced. The
+    // LEDs only latch after the line has been low for 50us or so;
+    // if an ISR holds us up longer than that, the chain has already
+    // latched a partial frame, so wait for the latch to be certain
+    // and start over. Returns false if it never got through, which
+    // is when interrupts are busiest, so rather than send the frame
+    // with them off it is left for the next tick.
+    bool _showChunked() const {
+        const uint8_t *base = (const uint8_t *)(void *)outdata;
+
+        for (uint8_t attempt=0; attempt<SHOW_MAX_RESTARTS; attempt++) {
+            bool overrun = false;
+            noInterrupts();
+            _send(base, sizeof(pixel_t));
+            for (uint8_t n=1; n<CHAIN_LENGTH; n++) {
+                uint8_t t0 = TCNT0;
+                interrupts();
+                asm volatile("nop\n\t" "nop\n\t" "nop\n\t" "nop\n\t");
+                noInterrupts();
+                if ((uint8_t)(TCNT0 - t0) >= SHOW_GAP_TICKS) {
+                    overrun = true;
+                    break;
+                }
+                _send(base + n * sizeof(pixel_t), sizeof(pixel_t));
+            }
+            interrupts();
+            if (!overrun) return true;
+            show_restarts += 1;
+            delayMicroseconds(SHOW_LATCH_US);
+        }
+        return false;
+    }
+#endif
+
+    public:
+    // true if the frame went out
+    bool show() const {
+#if defined(CHUNKED_SHOW) && defined(__AVR__)
+        return _showChunked();
+#else
+#ifndef INTERRUPTABLE
+        noInterrupts();
+#endif
+        _send((const uint8_t *)(void *)outdata, sizeof(outdata));
+#ifndef __AVR__
         // DEBUG_PRINT("\033[H\033[J");
         DEBUG_PRINTLN("... setting leds...");
 #endif
-
 #ifndef INTERRUPTABLE
         interrupts();
+#endif
+        return true;
 #endif
     };
 
+    // number of times a chunked show() had to start over, counting
+    // each try of a frame that was given up on
+    uint16_t showRestarts() const {
+        return show_restarts;
+    }
+
+
 
     pixel_t average(pixel_t a, pixel_t b) {
         pixel_t o;
@@ -3,6 +3,7 @@
 
 #include <avr/sleep.h>
 #include <avr/power.h>
+#include "stored.h"
 
 typedef enum pc_shutdown_mode_t {
     pctrl_running,
@@ -34,6 +35,8 @@ class powerControl_c {
         void shutdown(pc_shutdown_mode_t mode = pctrl_off) {
             DEBUG_PRINTLN_F("shutdown");
             DEBUG_PVAR(mode);
+            // don't lose a settings save that is still being written
+            eeprom_writer_c::flush();
             delay(100);
 
             if (mode == pctrl_running) return;
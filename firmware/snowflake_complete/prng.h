@@ -0,0 +1,117 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __prng_h
+#define __prng_h
+
+#include <stdint.h>
+
+// A cheap generator for the patterns, which mostly want a handful of
+// bits at a time. It is a 32b xorshift (shifts of 13, 17 and 5), one
+// lane of the Tausworthe generator in Sensors_c's worth of work
+// rather than four. Unlike a power-of-two LCG, whose bit k repeats
+// every 2^(k+1) draws, every bit of it goes through the same 2^32 - 1
+// long cycle, so the low bits are as good as the high ones, and a
+// pattern that draws the same number of words every tick does not
+// land on the same few states; Fun_Sparkle_c's masks lean on both
+// (host/prngstat.cpp checks them). It is still not a great generator,
+// so Sensors_c reseeds it from the good one now and again. Going by
+// instruction counts, a step is a fifth or so of a rand32(); neither
+// has been timed on the AVR yet.
+class prng_c {
+    public:
+    prng_c(uint32_t s = 1337) : state(s ? s : 1337), pool(0), pool_bits(0) { };
+
+    void seed(uint32_t s) {
+        // 0 is the one state xorshift never leaves
+        state = s ? s : 1337;
+        pool_bits = 0;
+    }
+
+    uint16_t rand16() {
+        return _next() >> 16;
+    }
+
+    uint8_t rand8() {
+        uint16_t r = rand16();
+        return (r >> 8) ^ (r & 0xff);
+    }
+
+    // n random bits, 1 <= n <= 8, handed out from a buffered word so
+    // that asking for 2 bits does not cost a whole draw
+    uint8_t randBits(uint8_t n) {
+        if (pool_bits < n) {
+            pool = rand16();
+            pool_bits = 16;
+        }
+        uint8_t r = pool & ((1 << n) - 1);
+        pool >>= n;
+        pool_bits -= n;
+        return r;
+    }
+
+    // uniform in [0, n), without the bias (or the cost) of a %. It
+    // draws just enough bits to cover n and tries again when out of
+    // range, which takes less than two tries on average.
+    uint8_t randRange(uint8_t n) {
+        if (n < 2) return 0;
+        uint8_t nbits = 0;
+        for (uint8_t v = n - 1; v; v >>= 1) nbits++;
+        uint8_t r;
+        do {
+            r = randBits(nbits);
+        } while (r >= n);
+        return r;
+    }
+
+    uint32_t rand32w() {
+        return _next();
+    }
+
+    // A mask of nbits random bits, each of which is set with 
+    // probability density/256. Working up the bits of density from
+    // the lowest set one, OR-ing in a random word for a 1 and AND-ing
+    // for a 0 gives exactly that probability, in at most 8 draws.
+    uint32_t randomMask(uint8_t nbits, uint8_t density) {
+        uint32_t m = 0;
+        if (density) {
+            uint8_t k = 0;
+            while (!(density & 0x1)) {
+                density >>= 1;
+                k++;
+            }
+            m = rand32w();
+            density >>= 1;
+            for (k++; k<8; k++) {
+                if (density & 0x1) m |= rand32w();
+                else               m &= rand32w();
+                density >>= 1;
+            }
+        }
+        if (nbits < 32) m &= ((uint32_t)1 << nbits) - 1;
+        return m;
+    }
+
+    private:
+    uint32_t state;
+    uint16_t pool;
+    uint8_t  pool_bits;
+
+    uint32_t _next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+#endif
+
@@ -0,0 +1,21 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "profile.h"
+
+#ifdef PROFILE_ENABLE
+
+profile_stat_t profile_c::stats[PZ_COUNT];
+
+#endif
+
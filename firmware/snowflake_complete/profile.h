@@ -0,0 +1,119 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __profile_h
+#define __profile_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "debug.h"
+
+// Scoped profiling zones. PROFILE_ZONE(z) at the top of a block times
+// the rest of the block with Timer1, which the IR decoder leaves free 
+// running at F_CPU/8, and adds it to the count, total, min and max 
+// for that zone. PROFILE_DUMP(tag) sends the table out the debug 
+// channel and starts over; tools/profile_report.py makes sense of it.
+//
+// Without PROFILE_ENABLE all of this compiles away to nothing.
+//
+// Zones are limited to 65535 timer ticks (65ms at 8MHz).
+
+// #define PROFILE_ENABLE
+
+typedef enum profile_zone_e {
+    PZ_RENDER,      // the whole of a frame update
+    PZ_TICK,        // patterns[]->tick()
+    PZ_COPYTOOUT,
+    PZ_SHOW,
+    PZ_IR,          // irdecoder.code()
+    PZ_VCC,         // sensors.myVcc()
+    PZ_BUTTONS,     // buttons_c::poll() and next()
+    PZ_SCALE2MASK,
+    PZ_COUNT,
+} profile_zone_e;
+
+// CPU cycles per timer tick
+const uint8_t PROFILE_CYCLES_PER_TICK = 8;
+
+typedef struct profile_stat_t {
+    uint16_t count;
+    uint32_t total;
+    uint16_t min;
+    uint16_t max;
+} profile_stat_t;
+
+class profile_c {
+    public:
+        static void add(uint8_t z, uint16_t ticks) {
+            profile_stat_t &s = stats[z];
+            if (s.count == 0xffff) return;
+            s.count += 1;
+            s.total += ticks;
+            if (ticks < s.min) s.min = ticks;
+            if (ticks > s.max) s.max = ticks;
+        }
+        static void reset() {
+            for (uint8_t z=0;z<PZ_COUNT;z++) {
+                stats[z].count = 0;
+                stats[z].total = 0;
+                stats[z].min   = 0xffff;
+                stats[z].max   = 0;
+            }
+        }
+        static void dump(uint8_t tag) {
+            DEBUG_PRINTLN_F("profile");
+            DEBUG_PVAR(tag);
+            for (uint8_t z=0;z<PZ_COUNT;z++) {
+                profile_stat_t &s = stats[z];
+                if (!s.count) continue;
+                DEBUG_PVAR(z);
+                DEBUG_PVAR(s.count);
+                DEBUG_PVAR(s.total);
+                DEBUG_PVAR(s.min);
+                DEBUG_PVAR(s.max);
+                // the trace ring is small; this is on demand, so wait
+                DEBUG_FLUSH();
+            }
+            DEBUG_PRINTLN_F("profile end");
+            reset();
+        }
+    private:
+        static profile_stat_t stats[PZ_COUNT];
+};
+
+class profile_scope_c {
+    public:
+        profile_scope_c(uint8_t iz) : z(iz), t0(TCNT1) { };
+        ~profile_scope_c() {
+            profile_c::add(z, TCNT1 - t0);
+        }
+    private:
+        uint8_t  z;
+        uint16_t t0;
+};
+
+#ifdef PROFILE_ENABLE
+    #define _PROFILE_CAT2(a,b) a##b
+    #define _PROFILE_CAT(a,b) _PROFILE_CAT2(a,b)
+    #define PROFILE_ZONE(z) \
+        profile_scope_c _PROFILE_CAT(_pz_, __LINE__)(z)
+    #define PROFILE_DUMP(tag) \
+        profile_c::dump(tag)
+    #define PROFILE_RESET() \
+        profile_c::reset()
+#else
+    #define PROFILE_ZONE(z)
+    #define PROFILE_DUMP(tag)
+    #define PROFILE_RESET()
+#endif
+
+#endif
+
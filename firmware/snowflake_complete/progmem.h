@@ -0,0 +1,121 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __progmem_h
+#define __progmem_h
+
+#include <stdint.h>
+#include <string.h>
+#ifndef __AVR__
+    #include <assert.h>
+#endif
+
+#include <Arduino.h>
+
+// A table in flash that knows its own type and length, so that a
+// lookup is just the right pgm_read_*() for the type, inlined, rather
+// than a call out to a helper that takes a bare pointer:
+//
+//   const progmem_array<uint16_t, 3> waits PROGMEM = { 10, 20, 50 };
+//   uint16_t w = waits[i];
+//   for (uint16_t w : waits) ...
+//
+// N has to match the number of values given, as anything left over
+// would be zero. Types of 1, 2 or 4 bytes are read in one go, anything
+// else (a struct) with memcpy_P(). Reads are checked against N in the
+// host builds without NDEBUG, and not at all on the AVR.
+
+template<typename T, uint8_t SIZE = sizeof(T)>
+struct progmem_reader {
+    static T read(const T *p) {
+        T v;
+        memcpy_P(&v, p, sizeof(T));
+        return v;
+    }
+};
+// a copy of the right size, which the compiler turns into a move
+template<typename T>
+struct progmem_reader<T, 1> {
+    static T read(const T *p) {
+        uint8_t b = pgm_read_byte(p);
+        T v;
+        memcpy(&v, &b, sizeof(T));
+        return v;
+    }
+};
+template<typename T>
+struct progmem_reader<T, 2> {
+    static T read(const T *p) {
+        uint16_t w = pgm_read_word(p);
+        T v;
+        memcpy(&v, &w, sizeof(T));
+        return v;
+    }
+};
+template<typename T>
+struct progmem_reader<T, 4> {
+    static T read(const T *p) {
+        uint32_t d = pgm_read_dword(p);
+        T v;
+        memcpy(&v, &d, sizeof(T));
+        return v;
+    }
+};
+
+template<typename T, uint16_t N>
+struct progmem_array {
+    // public, and the only member, so that it can be filled in with
+    // braces like a plain array
+    T d[N];
+
+    static constexpr uint16_t size() {
+        return N;
+    }
+
+    T operator[](uint16_t i) const {
+#ifndef __AVR__
+        assert(i < N);
+#endif
+        return progmem_reader<T>::read(d + i);
+    }
+
+    // for range for; it reads the flash, so there are no references
+    class iterator {
+        public:
+        iterator(const T *ip) : p(ip) { };
+        T operator*() const {
+            return progmem_reader<T>::read(p);
+        }
+        iterator &operator++() {
+            p++;
+            return *this;
+        }
+        bool operator!=(const iterator &o) const {
+            return p != o.p;
+        }
+        private:
+        const T *p;
+    };
+    iterator begin() const {
+        return iterator(d);
+    }
+    iterator end() const {
+        return iterator(d + N);
+    }
+};
+
+// so that getLength() (helpers.h) works on these too
+template<typename T, uint16_t N>
+int getLength(const progmem_array<T, N> &) {
+    return N;
+}
+
+#endif
@@ -28,12 +28,8 @@ class rotate_base_c {
                 uint8_t preidx = dir ? j : l-j-1;
                 uint8_t idx  = idx_xform(preidx);
                 uint8_t idxp = idx_xform(dir ? preidx - 1 : preidx + 1);
-                // I have an off by one I need to fix. For the time 
-                // being this works.
-                if (idx < pixels.len()) {
-                    pixels.set(idxp,pixels.get(idx));
-                    last_preidx = preidx;
-                }
+                pixels.set(idxp,pixels.get(idx));
+                last_preidx = preidx;
             }
             pixels.set(idx_xform(last_preidx),temp);
         }
@@ -47,8 +43,9 @@ class rotate_inner_c : public rotate_base_c<PIXELS_C> {
     typedef rotate_base_c<PIXELS_C> parent_t;                                 
     public:
         rotate_inner_c(PIXELS_C &inp) : parent_t(inp) {};
-        uint8_t maxl() { return (2*parent_t::pixels.len()/5)+1; }
-        uint8_t idx_xform(uint8_t i) { return 5 * (i/2) + (i%2) - 1; };
+        // the first and last pixel of each arm: 0, 4, 5, 9, ... 29
+        uint8_t maxl() { return (2*parent_t::pixels.len()/5); }
+        uint8_t idx_xform(uint8_t i) { return (i%2) ? 5 * ((i+1)/2) - 1 : 5 * (i/2); };
 };
 template<class PIXELS_C>
 class rotate_outer_c : public rotate_base_c<PIXELS_C> {
@@ -3,6 +3,8 @@
 
 #include "debug.h"
 #include "ema.h"
+#include "prng.h"
+#include "entropy.h"
 
 const uint32_t DEFAULT_SEED_V = 12345;
 
@@ -34,31 +36,42 @@ class Sensors_c {
         return (z1 ^ z2 ^ z3 ^ z4);
     }
 
+    // cheaper numbers for the patterns; see prng.h
+    uint8_t  rand8()                  { return fast.rand8(); }
+    uint16_t rand16()                 { return fast.rand16(); }
+    uint8_t  randBits(uint8_t n)      { return fast.randBits(n); }
+    uint8_t  randRange(uint8_t n)     { return fast.randRange(n); }
+    uint32_t randomMask(uint8_t nbits, uint8_t density) {
+        return fast.randomMask(nbits, density);
+    }
+
 
-    // reseeds the PRNG with a few real random numbers
+    // Reseeds the PRNG from the entropy pool. This does not wait
+    // for the pool to fill, so it is fine to call from setup(); 
+    // reseedIfReady() tops things up later on.
     bool reseed() {
-        z1 = trueRand32();
-        z2 = trueRand32();
-        z3 = trueRand32();
-        z4 = trueRand32();
+        uint32_t e = entropy.take();
+        _stir(e);
         DEBUG_PRINT_F("reseed ");
-        DEBUG_PRINT_FMT(z1, HEX);
-        DEBUG_PRINT_F(" ");
-        DEBUG_PRINT_FMT(z2, HEX);
-        DEBUG_PRINT_F(" ");
-        DEBUG_PRINT_FMT(z3, HEX);
-        DEBUG_PRINT_F(" ");
-        DEBUG_PRINTLN_FMT(z4, HEX);
-        // if all the same, that's bad
-        bool ok = (z1 ^ z2 ^ z3 ^ z4) != 0;
-        if (!ok) {
-            z1 = DEFAULT_SEED_V;
-            z2 = DEFAULT_SEED_V;
-            z3 = DEFAULT_SEED_V;
-            z4 = DEFAULT_SEED_V;
+        DEBUG_PRINTLN_FMT(e, HEX);
+        return true;
+    }
 
-        }
-        return ok;
+    // Puts both generators in a state that depends only on s, so 
+    // that a run can be repeated exactly (see framestream.h).
+    void seed(uint32_t s) {
+        z1 = z2 = z3 = z4 = DEFAULT_SEED_V;
+        _stir(s);
+    }
+
+    // reseed, but only if the pool has filled up since last time
+    bool reseedIfReady() {
+        if (!entropy.ready()) return false;
+        return reseed();
+    }
+
+    uint8_t entropyEstimate() const {
+        return entropy.estimate();
     }
 
     // generates a "pretty good" True random number by
@@ -76,10 +89,14 @@ class Sensors_c {
 
 
     uint16_t light() {
-        return light_filter.update(analogRead(LIGHT_PIN));
+        uint16_t v = analogRead(LIGHT_PIN);
+        entropy.add(v);
+        return light_filter.update(v);
     }
     uint16_t sound() {
-        return sound_filter.update(analogRead(SOUND_PIN) << 4);
+        uint16_t v = analogRead(SOUND_PIN);
+        entropy.add(v);
+        return sound_filter.update(v << 4);
     }
 #ifdef INCLUDE_RF
     uint8_t rf() {
@@ -107,6 +124,7 @@ class Sensors_c {
        while (bit_is_set(ADCSRA,ADSC));
        uint16_t result = ADCL; // must read ADCL first - it then locks ADCH  
        result |= (ADCH << 8);
+       entropy.add(result);
        result = 1125300L / result; // 1125300 = 1.1*1023*1000
        return result;
     }
@@ -115,6 +133,8 @@ class Sensors_c {
     private:
     uint32_t z1, z2, z3, z4;
     uint32_t last_rand32;
+    prng_c   fast;
+    entropy_pool_c entropy;
 
     ema_c<uint16_t, uint32_t, 1, 32> light_filter;
     ema_c<uint16_t, uint32_t, 1, 16> sound_filter;
@@ -122,6 +142,19 @@ class Sensors_c {
     ema_c<uint8_t,  uint16_t, 1, 32> rf_filter;
 #endif
 
+    void _stir(uint32_t e) {
+        z1 ^= e;
+        z2 ^= (e << 8)  | (e >> 24);
+        z3 ^= (e << 16) | (e >> 16);
+        z4 ^= (e << 24) | (e >> 8);
+        // the generator gets stuck if any of these are too small
+        if (z1 < 2)   z1 = DEFAULT_SEED_V;
+        if (z2 < 8)   z2 = DEFAULT_SEED_V;
+        if (z3 < 16)  z3 = DEFAULT_SEED_V;
+        if (z4 < 128) z4 = DEFAULT_SEED_V;
+        fast.seed(rand32());
+    }
+
     bool _makeRandBit(uint8_t iters) {
         bool r = 0;
         for (uint8_t i=0;i<iters;i++) {
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __settings_h
+#define __settings_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "helpers.h"
+#include "profile.h"
+
+// The user-selectable settings, and how they turn the light and sound
+// readings into the brightness and mask for a frame. These live here
+// rather than in the sketch so that the host tools (../host) render
+// frames exactly as the snowflake does.
+
+// total number of "pixels"
+const uint8_t   PIXEL_CHAIN_LENGTH = 30;
+const uint32_t  ALL_LIGHTS_MSK     = 0x3fffffff;
+
+// user-selectable loop delays between led updates
+// The IR decoder only needs the LED updates to stay out of the way
+// while a frame is arriving, so 20ms works for both the 32b NEC codes
+// in the cheap AliExpress remotes and for the 12b sony codes.
+const progmem_array<uint16_t, 9> delays         PROGMEM = { 70, 100, 200, 500, 1000, 5000, 5, 20, 40 };
+
+// user selectable max brightnesses
+const progmem_array<uint8_t, 5>  brightnesses   PROGMEM = { 50, 100, 150, 200, 25 };
+// user selectable delay before turnoff, in increments of 5 minutes
+const progmem_array<uint8_t, 9>  on_times_5mins PROGMEM = { 6, 12, 24, 36, 72, 144, 255, 1, 3 };
+
+typedef struct varn_indices_t {
+    uint8_t pattern_idx;
+    uint8_t delay_idx;
+    uint8_t brite_idx;
+    uint8_t turnoff_idx;
+    uint8_t sound_idx;
+    uint8_t var0_idx;
+    uint8_t auto_idx;
+} varn_indices_t;
+
+// bump this when fields are added to the end of varn_indices_t
+const uint8_t SETTINGS_VERSION = 1;
+
+const uint8_t  VARIATION_0_COUNT = 8;
+
+typedef enum sound_mode_t {
+    SOUND_OFF,
+    SOUND_VU,
+    SOUND_FLASH,
+} sound_mode_t;
+
+typedef enum autochange_mode_t {
+    AUTO_STOP,
+    AUTO_PATTERN,
+    AUTO_VARIATION,
+    AUTO_PATTERN_VARIATION,
+} autochange_mode_t;
+
+// routine to scale a limited range input to a different
+// limited range
+template<uint16_t in_min, uint16_t in_max>
+uint8_t scale_range(uint16_t in, uint8_t out_min, uint8_t out_max) {
+    const uint32_t in_range = in_max - in_min;
+    const uint32_t out_range = out_max - out_min;
+    uint32_t in_v     = in;
+    if (in_v < in_min) in_v = in_min;
+    if (in_v > in_max) in_v = in_max;
+    in_v -= in_min;
+    uint32_t fract = (in_v << 16) / in_range;
+    uint32_t out_v = (fract * out_range) >> 16;
+    out_v += out_min;
+    return out_v;
+};
+
+// brightness to scale a frame by, from the light level
+inline uint8_t frameScale(const varn_indices_t &v, uint16_t ll) {
+    return scale_range<0,500>(ll,10,brightnesses[v.brite_idx]);
+}
+
+// which pixels are lit, from the sound level
+inline uint32_t frameMask(const varn_indices_t &v, uint16_t sl, thresholder_c &thresh) {
+    uint32_t msk  = ALL_LIGHTS_MSK;
+    switch ((sound_mode_t)v.sound_idx) {
+        case SOUND_VU: {
+            PROFILE_ZONE(PZ_SCALE2MASK);
+            msk = scale2mask<0,3100,PIXEL_CHAIN_LENGTH,ALL_LIGHTS_MSK>(sl);
+            break;
+        }
+        case SOUND_FLASH:
+            msk = thresh.update(sl) ? ALL_LIGHTS_MSK : 0;
+            break;
+        default:
+            break;
+    }
+    return msk;
+}
+
+#endif
+
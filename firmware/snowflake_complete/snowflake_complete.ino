@@ -20,6 +20,22 @@
 #include "stored.h"
 #include "powerctrl.h"
 #include "ir.h"
+#include "profile.h"
+#include "memwatch.h"
+#include "frametime.h"
+#include "settings.h"
+#include "sync.h"
+#include "stream.h"
+#include "mirror.h"
+#include "uart.h"
+#include "vm.h"
+#include "vm_progs.h"
+#include "vm_upload.h"
+#include "clip.h"
+#include "clips.h"
+#include "palette.h"
+#include "patterns.h"
+#include "energy.h"
 
 // defintions of different button press lengths
 const uint16_t  SHORT_PRESS_MILLIS      = 200;
@@ -27,10 +43,6 @@ const uint16_t  MED_PRESS_MILLIS        = 1000;
 const uint16_t  LONG_PRESS_MILLIS       = 8000;
 const uint32_t  PATTERN_DURATION_MILLIS = 30000;
 
-// total number of "pixels"
-const uint8_t   PIXEL_CHAIN_LENGTH = 30;
-const uint32_t  ALL_LIGHTS_MSK     = 0x3fffffff;
-
 // Pin assignments
 const uint8_t   PIXEL_OUTPUT_PIN   = 4;
 const uint8_t   BUTTON1_PIN        = 9;
@@ -50,42 +62,9 @@ const uint16_t  MIN_VOLTS_MV       = 3000UL;
 const uint16_t  EXTERNAL_MV_THRESH = 4800UL;
 const uint8_t   MAX_LOWVOLT_ITERS  = 30;
 
-// user-selectable loop delays between led updates
-// faster than 70ms between updates and the IR remote cannot function with 
-// 32b codes like the NEC codes in the cheap AliExpress remotes. For remotes 
-// with 16b codes (sony), 20ms is sufficient.
-const uint16_t delays[]          PROGMEM = { 70, 100, 200, 500, 1000, 5000, 5, 20, 40 };
-
-// user selectable max brightnesses
-const uint8_t  brightnesses[]    PROGMEM = { 50, 100, 150, 200, 25 };
-// user selectable delay before turnoff, in increments of 5 minutes
-const uint8_t on_times_5mins[]   PROGMEM = { 6, 12, 24, 36, 72, 144, 255, 1, 3 };
-
-typedef struct varn_indices_t {
-    uint8_t pattern_idx;
-    uint8_t delay_idx;
-    uint8_t brite_idx;
-    uint8_t turnoff_idx;
-    uint8_t sound_idx;
-    uint8_t var0_idx;
-    uint8_t auto_idx;
-} varn_indices_t;
-
-const uint8_t  VARIATION_0_COUNT = 8;
-
 varn_indices_t varn_indices;
 
 
-//#pragma GCC diagnostic push
-//#pragma GCC diagnostic ignored "-Wc++11-extensions"
-
-template<uint8_t PIN>
-using Button_sc = Button_c<PIN, SHORT_PRESS_MILLIS, MED_PRESS_MILLIS, LONG_PRESS_MILLIS>;
-Button_sc<BUTTON1_PIN> button1;
-Button_sc<BUTTON2_PIN> button2;
-
-//#pragma GCC diagnostic pop
-
 typedef PixChain_c<PIXEL_CHAIN_LENGTH, PIXEL_OUTPUT_PIN> PixChain_sc;
 PixChain_sc pixels;
 
@@ -131,95 +110,111 @@ void wake_handler(void) {
 };
 
 
-Fun_Sparkle_c <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_sparkle(pixels, sensors, varn_indices);
-Fun_Chaser_c  <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_chaser(pixels, sensors, varn_indices);
-Fun_Rainbow_c <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_rainbow(pixels, sensors, varn_indices);
-Fun_Sparse_c  <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_sparse(pixels, sensors, varn_indices);
-Fun_Snake_c   <PixChain_sc, Sensors_sc, varn_indices_t, 7> 
-    fun_snake(pixels, sensors, varn_indices);
-Fun_Leaves_c  <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_leaves(pixels, sensors, varn_indices);
-Fun_Flash_c   <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_flash(pixels, sensors, varn_indices);
-Fun_Cylon_c   <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_cylon(pixels, sensors, varn_indices);
-Fun_Solid_c   <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_solid(pixels, sensors, varn_indices);
-Fun_MiniCircle_c   <PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_minicircle(pixels, sensors, varn_indices);
-Fun_Inching_c<PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_inching(pixels, sensors, varn_indices);
-Fun_Pulse_c<PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_pulse(pixels, sensors, varn_indices);
-Fun_Fade_c<PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_fade(pixels, sensors, varn_indices);
-Fun_Lines_c<PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_lines(pixels, sensors, varn_indices);
-Fun_Settings_c<PixChain_sc, Sensors_sc, varn_indices_t>
-    fun_settings(pixels, sensors, varn_indices);
+// fun_chaser, fun_sparkle, ... and patterns[] of them, in the order
+// patterns.h lists them. fun_vm runs an uploaded program, or
+// vm_prog_arms if there is none.
+#define PATTERN_OBJECT(name, cls, ...) \
+    cls<PixChain_sc, Sensors_sc, varn_indices_t> \
+        fun_##name(pixels, sensors, varn_indices, ##__VA_ARGS__);
+SNOWFLAKE_PATTERNS(PATTERN_OBJECT)
+#undef PATTERN_OBJECT
 
 typedef Fun_Base_c    <PixChain_sc, Sensors_sc, varn_indices_t>  Fun_base_sc;
 
+#define PATTERN_ADDR(name, ...) &fun_##name,
 Fun_base_sc *patterns[] = { 
-    &fun_chaser, 
-    &fun_sparkle, 
-    &fun_rainbow, 
-    &fun_sparse,
-    &fun_snake,
-    &fun_leaves,
-    &fun_flash,
-    &fun_cylon,
-    &fun_solid,
-    &fun_minicircle,
-    &fun_inching,
-    &fun_pulse,
-    &fun_fade,
-    &fun_lines,
-    &fun_settings,
-};
-
-stored2_c<varn_indices_t, 0x1> eeprom(varn_indices);
-
-
-// routine to scale a limited range input to a different
-// limited range
-template<uint16_t in_min, uint16_t in_max>
-uint8_t scale_range(uint16_t in, uint8_t out_min, uint8_t out_max) {
-    const uint32_t in_range = in_max - in_min;
-    const uint32_t out_range = out_max - out_min;
-    uint32_t in_v     = in;
-    if (in_v < in_min) in_v = in_min;
-    if (in_v > in_max) in_v = in_max;
-    in_v -= in_min;
-    uint32_t fract = (in_v << 16) / in_range;
-    uint32_t out_v = (fract * out_range) >> 16;
-    out_v += out_min;
-    return out_v;
+    SNOWFLAKE_PATTERNS(PATTERN_ADDR)
 };
+#undef PATTERN_ADDR
+static_assert(sizeof(patterns)/sizeof(patterns[0]) == PATTERN_COUNT, "patterns[] is not the whole list");
+
+// Settings take the bottom of the EEPROM, past where they used to be
+// kept, up to the energy table or the VM's uploaded program if either
+// is kept. The log has run to the top in other builds, and retrieve()
+// brings the newest record down from wherever it was left.
+const int SETTINGS_EEP_BASE = 0x10;
+#if defined(ENERGY_ENABLE)
+const int SETTINGS_EEP_END  = ENERGY_EEP_BASE;
+#elif defined(VM_UPLOAD_ENABLE)
+const int SETTINGS_EEP_END  = VM_EEP_BASE;
+#else
+const int SETTINGS_EEP_END  = E2END + 1;
+#endif
+storedlog_c<varn_indices_t, SETTINGS_VERSION, SETTINGS_EEP_BASE,
+            SETTINGS_EEP_END - SETTINGS_EEP_BASE, E2END + 1 - SETTINGS_EEP_BASE> eeprom(varn_indices);
+// where settings lived before they were kept in a log, in the slot
+// the log leaves out, so that it cannot be taken for a record
+stored2_c<varn_indices_t, 0x1> legacy_eeprom(varn_indices);
+#ifdef ENERGY_ENABLE
+// how hard each pattern and var0 drives the LEDs, kept in the EEPROM
+energy_c<sizeof(patterns)/sizeof(patterns[0]), VARIATION_0_COUNT, PIXEL_CHAIN_LENGTH,
+         ENERGY_EEP_BASE, ENERGY_EEP_SIZE> energy;
+#endif
 
 
 void shutdown(pc_shutdown_mode_t shmode = pctrl_off) {
     DEBUG_PRINTLN_F("top-level shutdown");
     pixels.disable();
+#ifdef ENERGY_ENABLE
+    energy.save();
+#endif
+    // either button can wake it, as well as the IR power button
+    if (shmode == pctrl_wakeable) buttons_c::armWake();
     pctrl.shutdown(shmode);
+    if (buttons_c::woke()) {
+        DEBUG_PRINTLN_F("woken by a button");
+        DEBUG_FLUSH();
+        resetFunc();
+    }
 }
 
-typedef enum sound_mode_t {
-    SOUND_OFF,
-    SOUND_VU,
-    SOUND_FLASH,
-} sound_mode_t;
+// least free RAM, per pattern and sound mode
+memwatch_c<sizeof(patterns)/sizeof(patterns[0]), SOUND_FLASH + 1> memwatch;
+
+// If free RAM ever gets this low, fall back to a pattern that is known
+// to be light on stack before things get corrupted. 0 to disable.
+const uint16_t MEM_ALARM_BYTES  = 48;
+const uint8_t  SAFE_PATTERN_IDX = PAT_solid;
+
+frametime_c frametime;
 
-typedef enum autochange_mode_t {
-    AUTO_STOP,
-    AUTO_PATTERN,
-    AUTO_VARIATION,
-    AUTO_PATTERN_VARIATION,
-} autochange_mode_t;
+// the average that SOUND_FLASH compares the sound level against
+thresholder_c sound_thresh;
+
+#ifdef SYNC_ENABLE
+sync_node_c syncnode;
+
+void sync_rx(uint8_t b) {
+    syncnode.rxByte(b, millis());
+}
+
+// Start the pattern over the same way every unit in the chain will.
+void sync_restart(uint32_t seed) {
+    pixels.clear();
+    sensors.seed(seed);
+    patterns[varn_indices.pattern_idx]->init();
+}
+
+// Take on the master's pattern, variation and speed, if this unit
+// has them.
+bool sync_adopt(const sync_state_t &ss) {
+    if (ss.pattern_idx >= getLength(patterns)) return false;
+    varn_indices.pattern_idx = ss.pattern_idx;
+    if (ss.var0_idx  < VARIATION_0_COUNT)  varn_indices.var0_idx  = ss.var0_idx;
+    if (ss.delay_idx < getLength(delays))  varn_indices.delay_idx = ss.delay_idx;
+    return true;
+}
+#endif
+
+#ifdef STREAM_ENABLE
+stream_c stream;
+// where frames are put together before they are checked
+uint8_t  stream_back[PIXEL_CHAIN_LENGTH * 3];
+
+void stream_rx(uint8_t b) {
+    stream.rxByte(b);
+}
+#endif
 
 
 uint32_t last_tick;
@@ -227,6 +222,8 @@ uint32_t last_touch;
 uint32_t last_autochange;
 uint8_t  lowvolt_count;
 pc_shutdown_mode_t wake_status;
+bool     seeded_from_pool;
+uint8_t  profiled_pattern;
 
 void lowvolt_preshutdown() {
    pctrl.poweron(false); // turn off the LED power right away
@@ -242,10 +239,28 @@ void lowvolt_preshutdown() {
 
 void setup() {
     DEBUG_INIT(19200);
+#ifdef SYNC_ENABLE
+    uart_c::begin(SYNC_BAUD, sync_rx);
+#endif
+#ifdef MIRROR_ENABLE
+    mirror_c::begin();
+#endif
+#ifdef STREAM_ENABLE
+    // good frames go into the pattern buffer
+    stream.begin((uint8_t *)pixels.getAll(), stream_back, PIXEL_CHAIN_LENGTH);
+    uart_c::begin(STREAM_BAUD, stream_rx);
+#endif
+#ifdef VM_UPLOAD_ENABLE
+    vm_upload_c::begin();
+#endif
 
     lowvolt_count = 0;
     wake_status = pctrl_running;
 
+    irdecoder.begin();
+    buttons_c::begin(BUTTON1_PIN, BUTTON2_PIN,
+                     SHORT_PRESS_MILLIS, MED_PRESS_MILLIS, LONG_PRESS_MILLIS);
+
     // turn on LED chain
     DEBUG_PRINTLN_F("before LED poweron");
     pctrl.poweron(true);
@@ -276,8 +291,12 @@ void setup() {
     pixels.clear();
 
     DEBUG_PRINTLN_F("before EEP retreive");
-    eeprom.retrieve();
+    uint8_t settings_version = eeprom.retrieve();
+    if (!settings_version) {
+        legacy_eeprom.retrieve();
+    }
     DEBUG_PRINTLN_F("after EEP retreive");
+    DEBUG_PVAR(settings_version);
 
     // This is in case the eeprom has never been written
     if (varn_indices.pattern_idx  >= getLength(patterns))         varn_indices.pattern_idx   = 0;
@@ -288,7 +307,15 @@ void setup() {
     if (varn_indices.sound_idx    >  SOUND_FLASH)                 varn_indices.sound_idx = 0;
     if (varn_indices.auto_idx     >  AUTO_PATTERN_VARIATION)      varn_indices.auto_idx = 0;
     patterns[varn_indices.pattern_idx]->init();
+#ifdef ENERGY_ENABLE
+    energy.begin();
+#endif
+    // only whatever entropy is in the pool so far; there will be a
+    // proper reseed once the pool has filled (a second or so)
     sensors.reseed();
+    seeded_from_pool = false;
+    profiled_pattern = varn_indices.pattern_idx;
+    PROFILE_RESET();
     last_touch = last_tick = last_autochange = millis();
     DEBUG_PRINTLN_F("setup complete");
 };
@@ -296,9 +323,22 @@ void setup() {
 
 void loop() {
 
-   bp_t bp1v = button1.pressed();
-   bp_t bp2v = button2.pressed();
-   ir_decoded_t ircode = irdecoder.code();
+   bp_t bp1v = bp_none, bp2v = bp_none;
+   {
+       PROFILE_ZONE(PZ_BUTTONS);
+       buttons_c::poll();
+       bp_event_t ev;
+       while (buttons_c::next(ev)) {
+           if (ev.down) continue;
+           if (ev.button) bp2v = ev.kind;
+           else           bp1v = ev.kind;
+       }
+   }
+   ir_decoded_t ircode;
+   {
+       PROFILE_ZONE(PZ_IR);
+       ircode = irdecoder.code();
+   }
    uint16_t ll = sensors.light();
    uint16_t sl = sensors.sound();
 
@@ -318,19 +358,8 @@ void loop() {
        }
    }
 
-   uint8_t l_scaled = scale_range<0,500>(ll,10,fromProgMem8(brightnesses,varn_indices.brite_idx));
-
-   uint32_t msk  = ALL_LIGHTS_MSK;
-   switch ((sound_mode_t)varn_indices.sound_idx) {
-       case SOUND_VU:
-           msk = scale2mask<0,3100,PIXEL_CHAIN_LENGTH,ALL_LIGHTS_MSK>(sl);
-           break;
-       case SOUND_FLASH:
-           msk = thresholder(sl) ? ALL_LIGHTS_MSK : 0;
-           break;
-       default:
-           break;
-   }
+   uint8_t  l_scaled = frameScale(varn_indices, ll);
+   uint32_t msk      = frameMask(varn_indices, sl, sound_thresh);
 
    auto incr_pattern = [&] () {
        wrapIncr(varn_indices.pattern_idx,getLength(patterns));
@@ -406,23 +435,107 @@ void loop() {
 
 
    uint32_t now = millis();
+#ifdef SYNC_ENABLE
+   // A follower goes with whatever the master is doing, including
+   // undoing any button presses here.
+   bool sync_restart_due = syncnode.poll(now);
+   if (syncnode.isFollowing()) {
+       const sync_state_t &ss = syncnode.state();
+       if (ss.pattern_idx != varn_indices.pattern_idx) sync_restart_due = true;
+       if (sync_adopt(ss) && sync_restart_due) sync_restart(ss.seed);
+   }
+#endif
    uint32_t tick_elapsed  = now - last_tick;
    uint32_t touch_elapsed = now - last_touch;
-   uint16_t del = fromProgMem16(delays, varn_indices.delay_idx);
+   uint16_t del = delays[varn_indices.delay_idx];
    uint32_t pat_elapsed   = now - last_autochange;
 
-   if (varn_indices.auto_idx && (pat_elapsed > PATTERN_DURATION_MILLIS)) {
+#ifdef SYNC_ENABLE
+   // the master picks the seeds, and changes the patterns
+   bool sync_local = !syncnode.isFollowing();
+#else
+   bool sync_local = true;
+#endif
+
+   if (sync_local && !seeded_from_pool) {
+       seeded_from_pool = sensors.reseedIfReady();
+#ifdef SYNC_ENABLE
+       // the followers would have no idea of the new numbers
+       if (seeded_from_pool && syncnode.isMaster()) {
+           uint32_t seed = sensors.rand32();
+           syncnode.restart(varn_indices.pattern_idx, seed);
+           sync_restart(seed);
+       }
+#endif
+   }
+
+   if (sync_local && varn_indices.auto_idx && (pat_elapsed > PATTERN_DURATION_MILLIS)) {
+       sensors.reseedIfReady();
        if (varn_indices.auto_idx & 0x1) {
-           varn_indices.pattern_idx = sensors.rand32() % getLength(patterns);
+           varn_indices.pattern_idx = sensors.randRange(getLength(patterns));
            patterns[varn_indices.pattern_idx]->init();
        };
        if (varn_indices.auto_idx & 0x2) 
-           varn_indices.var0_idx = sensors.rand32() % VARIATION_0_COUNT;
+           varn_indices.var0_idx = sensors.randBits(3);
        last_autochange = now;
        DEBUG_PVAR(last_autochange);
    }
 
-   if (tick_elapsed > del) {
+   uint16_t mem_free = memwatch.update(varn_indices.pattern_idx, varn_indices.sound_idx);
+   if (MEM_ALARM_BYTES && (mem_free < MEM_ALARM_BYTES) &&
+       (varn_indices.pattern_idx != SAFE_PATTERN_IDX)) {
+       DEBUG_PRINTLN_F("Stack nearly into heap!");
+       DEBUG_PVAR(mem_free);
+       varn_indices.pattern_idx = SAFE_PATTERN_IDX;
+       patterns[varn_indices.pattern_idx]->init();
+   }
+
+#ifdef SYNC_ENABLE
+   if (syncnode.lead(varn_indices.pattern_idx, varn_indices.var0_idx, varn_indices.delay_idx)) {
+       uint32_t seed = sensors.rand32();
+       syncnode.restart(varn_indices.pattern_idx, seed);
+       sync_restart(seed);
+   }
+   // frames on the chain's clock rather than this unit's
+   uint8_t ticks = syncnode.ticksDue(now, del);
+   bool frame_due = ticks != 0;
+#else
+   uint8_t ticks = 1;
+   bool frame_due = tick_elapsed > del;
+#endif
+
+#ifdef STREAM_ENABLE
+   // A frame from the PC goes out the same way as the pattern's (see
+   // below about calling show() from anywhere else), just without a
+   // tick.
+   bool streamed = stream.poll(now);
+   if (streamed) {
+       last_touch = now;
+       msk        = ALL_LIGHTS_MSK;
+       ticks      = 0;
+       frame_due  = true;
+   } else if (stream.isActive() && (wake_status == pctrl_running)) {
+       // the pattern leaves the pixels alone while frames are coming in
+       frame_due = false;
+   }
+#endif
+
+#ifdef VM_UPLOAD_ENABLE
+   // start a new program right away if it is showing
+   if (vm_upload_c::poll() && (patterns[varn_indices.pattern_idx] == &fun_vm)) {
+       pixels.clear();
+       fun_vm.init();
+   }
+#endif
+
+   // profile numbers are kept per pattern
+   if (varn_indices.pattern_idx != profiled_pattern) {
+       PROFILE_DUMP(profiled_pattern);
+       profiled_pattern = varn_indices.pattern_idx;
+   }
+
+   if (frame_due) {
+       PROFILE_ZONE(PZ_RENDER);
 
        /* logic to deal with a shutdown is in this tick fn
           because there is some strange issue where if I call
@@ -435,13 +548,32 @@ void loop() {
        if (wake_status != pctrl_running) {
            pixels.clear();
        } else {
-           patterns[varn_indices.pattern_idx]->tick();
+           PROFILE_ZONE(PZ_TICK);
+           // more than one when catching up with the chain
+           while (ticks--) patterns[varn_indices.pattern_idx]->tick();
        }
 
-       pixels.copyToOut(msk, l_scaled);
-       if (irdecoder.isIdle()) {
-           pixels.show();
+       {
+           PROFILE_ZONE(PZ_COPYTOOUT);
+           pixels.copyToOut(msk, l_scaled);
+       }
+       // a blocking show() would cost the IR decoder its edges, and a
+       // chunked one gives up on the frame if it cannot get through
+       bool shown = PixChain_sc::IRQ_FRIENDLY || irdecoder.isIdle();
+       if (shown) {
+           PROFILE_ZONE(PZ_SHOW);
+           shown = pixels.show();
        }
+#ifdef MIRROR_ENABLE
+       if (shown) mirror_c::frame(pixels.getOut());
+#endif
+       frametime.retag(varn_indices.pattern_idx, varn_indices.delay_idx);
+       frametime.frame(tick_elapsed > 0xffff ? 0xffff : tick_elapsed, del, shown);
+#ifdef ENERGY_ENABLE
+       if (wake_status == pctrl_running) {
+           energy.frame(varn_indices.pattern_idx, varn_indices.var0_idx, now, pixels.load(msk));
+       }
+#endif
 
        if (wake_status != pctrl_running) {
            if ((wake_status == pctrl_wakeable) && (sensors.myVcc() < EXTERNAL_MV_THRESH)) {
@@ -449,13 +581,43 @@ void loop() {
                wake_status = pctrl_off;
            }
            DEBUG_PVAR(wake_status);
+           memwatch.report();
            shutdown(wake_status);
        }
 
        last_tick = now;
 
+#ifdef STREAM_ENABLE
+       if (streamed) {
+           // the sender waits for this before sending the next frame
+           noInterrupts();
+           if (uart_c::txFree()) uart_c::txPut(STREAM_ACK);
+           uart_c::txStart();
+           interrupts();
+       }
+#endif
+#ifdef SYNC_ENABLE
+       // stamped as it goes, not when the frame started
+       uint8_t sbuf[SYNC_FRAME_LEN];
+       uint8_t slen = syncnode.txFrame(sbuf, millis());
+       if (slen) {
+           noInterrupts();
+           if (uart_c::txFree() >= slen) {
+               for (uint8_t i=0;i<slen;i++) uart_c::txPut(sbuf[i]);
+           }
+           uart_c::txStart();
+           interrupts();
+       }
+#endif
+
    } else {
-       uint16_t lv_meas = sensors.myVcc();
+       // the last pattern's frame times, a piece at a time
+       frametime.idle();
+       uint16_t lv_meas;
+       {
+           PROFILE_ZONE(PZ_VCC);
+           lv_meas = sensors.myVcc();
+       }
        if (lv_meas < MIN_VOLTS_MV) {
            DEBUG_PRINTLN_F("Detected low voltage.");
            DEBUG_PVAR(lv_meas);
@@ -473,7 +635,7 @@ void loop() {
    }
 
    uint32_t turn_off_millis = 
-       (uint32_t)fromProgMem8(on_times_5mins,varn_indices.turnoff_idx) * 5UL * 60UL * 1000UL;
+       (uint32_t)on_times_5mins[varn_indices.turnoff_idx] * 5UL * 60UL * 1000UL;
    if (touch_elapsed > turn_off_millis) {
        DEBUG_PRINTLN_F("Setting to wakeable shutdwon.");
        wake_status = pctrl_wakeable;
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "stored.h"
+
+volatile uint16_t eeprom_writer_c::q_addr[EEW_QUEUE_LEN];
+volatile uint8_t  eeprom_writer_c::q_data[EEW_QUEUE_LEN];
+volatile uint8_t  eeprom_writer_c::q_head = 0;
+volatile uint8_t  eeprom_writer_c::q_tail = 0;
+
+void eeprom_writer_c::write(uint16_t addr, uint8_t d) {
+    uint8_t next = (q_head + 1) & (EEW_QUEUE_LEN - 1);
+    while (next == q_tail) {
+        // full; the ISR is still running, so just wait for room
+    }
+    q_addr[q_head] = addr;
+    q_data[q_head] = d;
+    q_head = next;
+    EECR |= _BV(EERIE);
+}
+
+// Waits for a write in progress with interrupts on, as it can take
+// 3.4ms, and only turns them off to look at the queue and to read.
+uint8_t eeprom_writer_c::read(uint16_t addr) {
+    for (;;) {
+        while (EECR & _BV(EEPE)) { };
+        uint8_t sreg = SREG;
+        noInterrupts();
+        // the last byte queued for addr is what it will hold
+        bool    queued = false;
+        uint8_t d      = 0;
+        for (uint8_t i=q_tail;i!=q_head;i=(i+1)&(EEW_QUEUE_LEN-1)) {
+            if (q_addr[i] == addr) {
+                d      = q_data[i];
+                queued = true;
+            }
+        }
+        // the ISR may have started the next write since the spin
+        if (!queued && !(EECR & _BV(EEPE))) {
+            EEAR = addr;
+            EECR |= _BV(EERE);
+            d = EEDR;
+            queued = true;
+        }
+        SREG = sreg;
+        if (queued) return d;
+    }
+}
+
+bool eeprom_writer_c::done() {
+    return (q_head == q_tail) && !(EECR & _BV(EEPE));
+}
+
+void eeprom_writer_c::flush() {
+    while (!done()) { };
+}
+
+// Fires whenever the EEPROM is ready (EEPE clear) and EERIE is set.
+void eeprom_writer_c::_isr() {
+    if (q_head == q_tail) {
+        EECR &= ~_BV(EERIE);
+        return;
+    }
+    EEAR = q_addr[q_tail];
+    EEDR = q_data[q_tail];
+    q_tail = (q_tail + 1) & (EEW_QUEUE_LEN - 1);
+    // EEPE must be set within four cycles of EEMPE; we are in an
+    // ISR, so nothing can get in between.
+    EECR |= _BV(EEMPE);
+    EECR |= _BV(EEPE);
+}
+
+ISR(EE_READY_vect) {
+    eeprom_writer_c::_isr();
+}
+
@@ -1,7 +1,35 @@
 #ifndef __stored_h
 #define __stored_h
 
-#include <EEPROM.h>
+#include <stdint.h>
+#include <Arduino.h>
+#include "helpers.h"
+
+// Settings saves used to block for ~3.3ms per byte written. Writes
+// now go into a small queue which is drained from the EE_READY
+// interrupt, one byte each time the EEPROM finishes the last one, 
+// while the main loop carries on.
+const uint8_t EEW_QUEUE_LEN = 16; // must be a power of 2
+
+class eeprom_writer_c {
+    public:
+        // queue a byte to be written. Waits only if the queue is full.
+        static void write(uint16_t addr, uint8_t d);
+        // EEPROM.read() is not safe while the ISR may be setting up a
+        // write, so all reads should come through here. A byte still in
+        // the queue reads as what it is about to be.
+        static uint8_t read(uint16_t addr);
+        // true when everything queued has been written
+        static bool done();
+        // wait for everything queued to be written
+        static void flush();
+        static void _isr();
+    private:
+        static volatile uint16_t q_addr[EEW_QUEUE_LEN];
+        static volatile uint8_t  q_data[EEW_QUEUE_LEN];
+        static volatile uint8_t  q_head;
+        static volatile uint8_t  q_tail;
+};
 
 
 template<typename T, int EEP_BASE_ADDR>
@@ -12,26 +40,242 @@ class stored2_c {
 
         void retrieve() {
             uint8_t *uip = (uint8_t *)(void *)&t;
+            uint8_t *sip = (uint8_t *)(void *)&shadow;
 
             for (uint8_t j=0;j<sizeof(T);j++) {
                 int full_addr = EEP_BASE_ADDR + j;
-                uint8_t d = EEPROM.read(full_addr);
+                uint8_t d = eeprom_writer_c::read(full_addr);
                 uip[j] = d;
+                sip[j] = d;
             }
         };
  
+        // Queues only the bytes that differ from what was last read or
+        // stored, and returns right away. done() tells when it is safe.
         void store() {
             uint8_t *uip = (uint8_t *)(void *)&t;
+            uint8_t *sip = (uint8_t *)(void *)&shadow;
 
             for(uint8_t j=0; j<sizeof(T);j++) {
                 int full_addr = EEP_BASE_ADDR + j;
                 uint8_t d = uip[j];
-                EEPROM.write(full_addr,d);
+                if (d != sip[j]) {
+                    eeprom_writer_c::write(full_addr,d);
+                    sip[j] = d;
+                }
             }
         };
 
+        bool done() const {
+            return eeprom_writer_c::done();
+        }
+        void flush() {
+            eeprom_writer_c::flush();
+        }
+
     private:
         T &t;
+        // image of what is (or soon will be) in the EEPROM
+        T shadow;
+};
+
+
+// A log-structured, wear-leveled version of the above. Each store()
+// appends a record to the next slot of a ring that covers 
+// [EEP_BASE_ADDR, EEP_BASE_ADDR + EEP_SIZE), so every cell is only
+// written once per (EEP_SIZE / SLOT_SIZE) saves. A record is:
+//
+//   seq (2 bytes) | version | len | payload (len bytes) | crc8
+//
+// Sequence numbers go up by one per slot, so the newest record is the
+// last slot whose seq is seq[0] + slot, which a binary search finds.
+// The seq is written last, so a save cut short by a power loss leaves
+// the previous record as the newest valid one.
+//
+// The layout of T may only grow by adding fields at the end. Records
+// written with a shorter T fill in the leading fields and leave the 
+// rest as they were; retrieve() returns the record's version so the
+// caller can fix up anything else.
+//
+// If the ring has been shorter than it once was, OLD_SIZE is the most
+// it ever covered. retrieve() then also looks in the slots it has
+// given up, and if the newest record is out there, copies it into the
+// ring, so that settings are not lost to whatever has the space now.
+
+const uint8_t SLOG_HDR_LEN = 4;
+
+template<typename T, uint8_t VERSION, int EEP_BASE_ADDR, int EEP_SIZE,
+         int OLD_SIZE = EEP_SIZE, uint8_t SLOT_SIZE = 16>
+class storedlog_c {
+
+    static_assert(sizeof(T) + SLOG_HDR_LEN + 1 <= SLOT_SIZE, "settings do not fit in a slot");
+    static_assert(OLD_SIZE >= EEP_SIZE, "the ring can only have been bigger");
+
+    public:
+        storedlog_c(T &it) : t(it), newest(0), newest_seq(0), found(false) {};
+
+        // returns the version of the record found, or 0 if there was
+        // no valid record
+        uint8_t retrieve() {
+            found = _findNewest();
+            _moveIn();
+            if (!found) return 0;
+
+            uint16_t base = _slotAddr(newest);
+            uint8_t version = eeprom_writer_c::read(base + 2);
+            uint8_t len     = eeprom_writer_c::read(base + 3);
+            if (len > sizeof(T)) len = sizeof(T);
+
+            uint8_t *uip = (uint8_t *)(void *)&t;
+            for (uint8_t j=0;j<len;j++) {
+                uip[j] = eeprom_writer_c::read(base + SLOG_HDR_LEN + j);
+            }
+            memcpy(&shadow, &t, sizeof(T));
+            return version;
+        };
+
+        // Appends a record if anything changed. Returns right away; 
+        // the bytes go out through eeprom_writer_c.
+        void store() {
+            if (found && !memcmp(&shadow, &t, sizeof(T))) return;
+
+            uint8_t  slot = found ? newest + 1 : 0;
+            if (slot >= SLOT_COUNT) slot = 0;
+            uint16_t seq  = found ? newest_seq + 1 : 0;
+
+            uint8_t rec[SLOT_SIZE];
+            rec[0] = seq & 0xff;
+            rec[1] = seq >> 8;
+            rec[2] = VERSION;
+            rec[3] = sizeof(T);
+            memcpy(rec + SLOG_HDR_LEN, &t, sizeof(T));
+            uint8_t rlen = SLOG_HDR_LEN + sizeof(T);
+            rec[rlen] = crc8(rec, rlen);
+
+            // The slot is a new one, so every byte is written as it
+            // is, without reading it back first: a read waits out the
+            // write ahead of it. Payload and crc first, seq last.
+            uint16_t base = _slotAddr(slot);
+            for (uint8_t j=2;j<=rlen;j++) eeprom_writer_c::write(base + j, rec[j]);
+            eeprom_writer_c::write(base + 1, rec[1]);
+            eeprom_writer_c::write(base + 0, rec[0]);
+
+            memcpy(&shadow, &t, sizeof(T));
+            newest     = slot;
+            newest_seq = seq;
+            found      = true;
+        };
+
+        bool done() const {
+            return eeprom_writer_c::done();
+        }
+        void flush() {
+            eeprom_writer_c::flush();
+        }
+
+    private:
+        static const uint8_t SLOT_COUNT = EEP_SIZE / SLOT_SIZE;
+        static const uint8_t OLD_SLOT_COUNT = OLD_SIZE / SLOT_SIZE;
+
+        T &t;
+        T shadow;
+        uint8_t  newest;
+        uint16_t newest_seq;
+        bool     found;
+
+        static uint16_t _slotAddr(uint8_t slot) {
+            return EEP_BASE_ADDR + (uint16_t)slot * SLOT_SIZE;
+        }
+        static uint16_t _seq(uint8_t slot) {
+            uint16_t a = _slotAddr(slot);
+            return eeprom_writer_c::read(a) | ((uint16_t)eeprom_writer_c::read(a + 1) << 8);
+        }
+        static bool _valid(uint8_t slot) {
+            uint16_t base    = _slotAddr(slot);
+            uint8_t  version = eeprom_writer_c::read(base + 2);
+            uint8_t  len     = eeprom_writer_c::read(base + 3);
+            // this also catches erased slots, which read as all 0xff
+            if (len > SLOT_SIZE - SLOG_HDR_LEN - 1) return false;
+            // Nothing but this code ever wrote a version, so anything
+            // else is junk that happens to pass the crc.
+            if (!version || (version > VERSION)) return false;
+            uint8_t rec[SLOT_SIZE];
+            for (uint8_t j=0;j<SLOG_HDR_LEN+len+1;j++) {
+                rec[j] = eeprom_writer_c::read(base + j);
+            }
+            return crc8(rec, SLOG_HDR_LEN+len) == rec[SLOG_HDR_LEN+len];
+        }
+
+        // The newest record in the slots past the ring, if it is newer
+        // than the ring's, is copied whole to slot 0 as the start of a
+        // new lap, keeping its seq, so that it is the ring's newest from
+        // here on and the one outside is never taken again. The seq is
+        // written last, so a copy cut short leaves it to be done over.
+        void _moveIn() {
+            uint8_t  best     = 0;
+            uint16_t best_seq = 0;
+            bool     any      = false;
+            for (uint8_t slot=SLOT_COUNT;slot<OLD_SLOT_COUNT;slot++) {
+                if (!_valid(slot)) continue;
+                uint16_t seq = _seq(slot);
+                if (any && ((int16_t)(seq - best_seq) <= 0)) continue;
+                best     = slot;
+                best_seq = seq;
+                any      = true;
+            }
+            if (!any) return;
+            if (found && ((int16_t)(best_seq - newest_seq) <= 0)) return;
+
+            uint16_t from = _slotAddr(best);
+            uint16_t to   = _slotAddr(0);
+            for (uint8_t j=2;j<SLOT_SIZE;j++) {
+                eeprom_writer_c::write(to + j, eeprom_writer_c::read(from + j));
+            }
+            eeprom_writer_c::write(to + 1, best_seq >> 8);
+            eeprom_writer_c::write(to + 0, best_seq & 0xff);
+            newest     = 0;
+            newest_seq = best_seq;
+            found      = true;
+        }
+
+        bool _findNewest() {
+            // binary search for the last slot in the current lap
+            uint16_t seq0 = _seq(0);
+            uint8_t lo = 0;
+            uint8_t hi = SLOT_COUNT - 1;
+            while (lo < hi) {
+                uint8_t mid = lo + (hi - lo + 1) / 2;
+                if ((uint16_t)(_seq(mid) - seq0) == mid) {
+                    lo = mid;
+                } else {
+                    hi = mid - 1;
+                }
+            }
+            // normally lo is it, but it could be torn, in which case
+            // the one before it is good.
+            for (uint8_t back=0;back<2;back++) {
+                uint8_t slot = (lo + SLOT_COUNT - back) % SLOT_COUNT;
+                if (_valid(slot)) {
+                    newest     = slot;
+                    newest_seq = _seq(slot);
+                    return true;
+                }
+            }
+
+            // Something is more broken than that (or the EEPROM has
+            // never been written): look at every slot.
+            bool any = false;
+            for (uint8_t slot=0;slot<SLOT_COUNT;slot++) {
+                if (!_valid(slot)) continue;
+                uint16_t seq = _seq(slot);
+                if (!any || ((int16_t)(seq - newest_seq) > 0)) {
+                    newest     = slot;
+                    newest_seq = seq;
+                    any = true;
+                }
+            }
+            return any;
+        }
 };
 
 #endif
@@ -0,0 +1,198 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __stream_h
+#define __stream_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "debug.h"
+#include "helpers.h"
+
+// Lets a PC drive the pixels directly over the UART. A frame is
+//
+//   'P' 'x' n  G R B ... (n pixels)  crc8
+//
+// with the crc over the pixel bytes only. The receive interrupt puts
+// the pixel bytes into a back buffer of the stream's own, never into
+// the chain's working buffer, which the pattern may be drawing into
+// until the first frame is in. When a frame is complete, poll() checks
+// it and copies it over in one go (90 bytes, about 50us for 30
+// pixels), and the back buffer is free for the next. A frame that
+// comes in while the last is still waiting for poll() is counted and
+// thrown away.
+//
+// show() turns interrupts off for about 30us a pixel, and bytes that
+// arrive then are lost, so after each frame the sketch sends back
+// STREAM_ACK once it is ready for another. A sender that waits for
+// the ack never loses a frame.
+//
+// At 500kbaud a 30 pixel frame takes about 1.9ms on the wire. The RC
+// oscillator has to be within a couple of percent for the UART to
+// work at all at that speed, so OSCCAL may need calibrating.
+//
+// The UART is shared with the debug channel and with sync.h.
+
+// #define STREAM_ENABLE
+
+#if defined(STREAM_ENABLE) && (defined(SERIAL_DEBUG) || defined(TRACE_DEBUG))
+#error "STREAM_ENABLE needs the UART; turn off SERIAL_DEBUG and TRACE_DEBUG"
+#endif
+#if defined(STREAM_ENABLE) && defined(SYNC_ENABLE)
+#error "STREAM_ENABLE and SYNC_ENABLE both need the UART"
+#endif
+
+const uint32_t STREAM_BAUD       = 500000; // exact at 8MHz with U2X
+const uint8_t  STREAM_MAGIC0     = 'P';
+const uint8_t  STREAM_MAGIC1     = 'x';
+const uint8_t  STREAM_ACK        = 'k';
+const uint8_t  STREAM_MAX_PIXELS = 84;     // so the crc covers < 256 bytes
+const uint16_t STREAM_TIMEOUT_MS = 2000;   // no frames this long and patterns resume
+const uint16_t STREAM_HDR_LEN    = 3;
+
+// Fills out with a frame of n pixels (GRB, as pixel_t holds them) and
+// returns its length, STREAM_HDR_LEN + 3n + 1.
+inline uint16_t streamEncode(uint8_t *out, const uint8_t *grb, uint8_t n) {
+    out[0] = STREAM_MAGIC0;
+    out[1] = STREAM_MAGIC1;
+    out[2] = n;
+    uint16_t len = (uint16_t)n * 3;
+    memcpy(out + STREAM_HDR_LEN, grb, len);
+    out[STREAM_HDR_LEN + len] = crc8(grb, len);
+    return STREAM_HDR_LEN + len + 1;
+}
+
+class stream_c {
+    public:
+    stream_c() : buf(0), back(0), max_pixels(0), state(st_magic0), rx_skip(false),
+        rx_left(0), rx_pos(0), ready(false), rx_count(0), rx_crc(0),
+        frames(0), bad(0), dropped(0), last_frame(0), active(false) { };
+
+    // b is where good frames go, normally pixels.getAll(), and bk
+    // where they are put together, 3 bytes a pixel
+    void begin(uint8_t *b, uint8_t *bk, uint8_t pixels) {
+        buf  = b;
+        back = bk;
+        max_pixels = pixels < STREAM_MAX_PIXELS ? pixels : STREAM_MAX_PIXELS;
+    }
+
+    // Called from the UART receive interrupt; keep it short.
+    void rxByte(uint8_t b) {
+        switch (state) {
+            case st_magic0:
+                if (b == STREAM_MAGIC0) state = st_magic1;
+                break;
+            case st_magic1:
+                state = (b == STREAM_MAGIC1) ? st_count :
+                        (b == STREAM_MAGIC0) ? st_magic1 : st_magic0;
+                break;
+            case st_count:
+                if (!b || (b > max_pixels)) {
+                    state = st_magic0;
+                    break;
+                }
+                // nowhere to put it until loop() is done with the last one
+                rx_skip  = ready;
+                if (!rx_skip) rx_count = b;
+                rx_left  = (uint16_t)b * 3;
+                rx_pos   = 0;
+                state    = st_data;
+                break;
+            case st_data:
+                if (!rx_skip) back[rx_pos] = b;
+                rx_pos++;
+                if (!--rx_left) state = st_crc;
+                break;
+            case st_crc:
+                state = st_magic0;
+                if (rx_skip) {
+                    dropped++;
+                } else {
+                    rx_crc = b;
+                    ready  = true;
+                }
+                break;
+        }
+    }
+
+    // Call from loop(). True when a good frame has just been put in
+    // the buffer given to begin(); then copy it out and show it.
+    bool poll(uint32_t now) {
+        if (active && ((now - last_frame) > STREAM_TIMEOUT_MS)) {
+            DEBUG_PRINTLN_F("stream: stopped");
+            active = false;
+        }
+        if (!ready) return false;
+        if (crc8(back, rx_count * 3) != rx_crc) {
+            bad++;
+            release();
+            return false;
+        }
+        memcpy(buf, back, rx_count * 3);
+        release();
+        if (!active) DEBUG_PRINTLN_F("stream: started");
+        active     = true;
+        last_frame = now;
+        frames++;
+        return true;
+    }
+
+    // throw away the frame waiting in the back buffer, if any
+    void release() {
+        ready = false;
+    }
+
+    // frames have been coming in recently, so the patterns should
+    // leave the pixels alone
+    bool isActive() const {
+        return active;
+    }
+
+    uint16_t framesIn() const {
+        return frames;
+    }
+    uint16_t badFrames() const {
+        return bad;
+    }
+    uint16_t droppedFrames() const {
+        return dropped;
+    }
+
+    private:
+    typedef enum {
+        st_magic0,
+        st_magic1,
+        st_count,
+        st_data,
+        st_crc,
+    } rx_state_t;
+
+    uint8_t          *buf;
+    uint8_t          *back;
+    uint8_t          max_pixels;
+    // only the interrupt touches these
+    rx_state_t       state;
+    bool             rx_skip;
+    uint16_t         rx_left;
+    uint16_t         rx_pos;
+    // and these are how it hands a frame over
+    volatile bool    ready;
+    volatile uint8_t rx_count;
+    volatile uint8_t rx_crc;
+    uint16_t         frames;
+    uint16_t         bad;
+    volatile uint16_t dropped;
+    uint32_t         last_frame;
+    bool             active;
+};
+
+#endif
+
@@ -0,0 +1,353 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __sync_h
+#define __sync_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "debug.h"
+#include "helpers.h"
+
+// Keeps a chain of snowflakes animating together. Each unit's RX is
+// wired to the TX of the one before it. The first in the chain hears
+// nothing, and after a few seconds makes itself the master; every
+// other unit follows whatever it hears, and passes a fresh frame on
+// down the chain each time it does.
+//
+// A sync frame carries the master's animation clock, the pattern,
+// variation and speed, and the seed and number of ticks since the
+// pattern last started. Followers
+//
+//  - slew their animation clock toward the master's (running up to
+//    1/8 fast or slow) rather than jumping, and trim its rate to
+//    take out the difference between the RC oscillators,
+//  - tick the pattern on the same clock boundaries,
+//  - restart the pattern from the same seed when the master does, so
+//    the random ones match too, and tick quickly to catch up if they
+//    come in partway through.
+//
+// The UART is shared with the debug channel, so SERIAL_DEBUG and
+// TRACE_DEBUG have to be off in debug.h to use this.
+
+// #define SYNC_ENABLE
+
+#if defined(SYNC_ENABLE) && (defined(SERIAL_DEBUG) || defined(TRACE_DEBUG))
+#error "SYNC_ENABLE needs the UART; turn off SERIAL_DEBUG and TRACE_DEBUG"
+#endif
+
+const uint32_t SYNC_BAUD        = 19200;
+const uint8_t  SYNC_MAGIC0      = 'S';
+const uint8_t  SYNC_MAGIC1      = 'y';
+const uint8_t  SYNC_FRAME_LEN   = 17;
+// time for a frame to cross the wire, 10 bits a byte
+const uint8_t  SYNC_LINK_MS     = (SYNC_FRAME_LEN * 10UL * 1000UL + SYNC_BAUD / 2) / SYNC_BAUD;
+const uint16_t SYNC_PERIOD_MS   = 1000; // how often the master sends
+const uint16_t SYNC_TIMEOUT_MS  = 3000; // hear nothing this long and be the master
+const uint16_t SYNC_STEP_MS     = 250;  // further off than this and just jump
+const uint8_t  SYNC_SLEW_SHIFT  = 3;    // slew at most 1/8 fast or slow
+const int16_t  SYNC_RATE_MAX    = 8192; // 1/65536ths, so 12.5%: the RC is +/-10%
+const uint16_t SYNC_MAX_DT      = 30000;
+const uint8_t  SYNC_MAX_CATCHUP = 64;   // ticks; further behind just skips ahead
+
+// An animation clock that follows a master's by nudging its phase and
+// rate, so that it never jumps (after the first time) or runs
+// backwards.
+class sync_clock_c {
+    public:
+    sync_clock_c() : anim(0), last_local(0), last_sample(0), frac(0),
+        slew(0), rate(0), locked(false), acquired(false) { };
+
+    uint32_t now(uint32_t local_ms) {
+        uint32_t dt = local_ms - last_local;
+        last_local = local_ms;
+        // a long sleep just loses time, and the next sample will jump
+        if (dt > SYNC_MAX_DT) dt = SYNC_MAX_DT;
+        uint32_t scaled = dt * (uint32_t)(65536L + rate) + frac;
+        uint32_t adv = scaled >> 16;
+        frac = scaled & 0xffff;
+        int32_t lim = adv >> SYNC_SLEW_SHIFT;
+        int32_t s   = slew;
+        if (s > lim)  s = lim;
+        if (s < -lim) s = -lim;
+        slew -= s;
+        anim += adv + s;
+        return anim;
+    }
+
+    // where the clock is headed, counting correction not yet slewed in
+    uint32_t estimate(uint32_t local_ms) {
+        return now(local_ms) + slew;
+    }
+
+    // the master's clock read master_ms at local time local_ms
+    void sample(uint32_t local_ms, uint32_t master_ms) {
+        int32_t err = (int32_t)(master_ms - estimate(local_ms));
+        if (!locked || (err > SYNC_STEP_MS) || (err < -(int32_t)SYNC_STEP_MS)) {
+            anim     = master_ms;
+            slew     = 0;
+            locked   = true;
+            acquired = false;
+        } else {
+            uint32_t interval = local_ms - last_sample;
+            if (interval) {
+                // the first time, all of the error since the jump is
+                // down to the rate; after that take a quarter of it
+                int32_t r = err * 65536L / (int32_t)interval;
+                r = rate + (acquired ? r / 4 : r);
+                if (r > SYNC_RATE_MAX)  r = SYNC_RATE_MAX;
+                if (r < -SYNC_RATE_MAX) r = -SYNC_RATE_MAX;
+                rate = r;
+            }
+            acquired = true;
+            // half now; link jitter would otherwise go straight through
+            slew += err / 2;
+        }
+        last_sample = local_ms;
+    }
+
+    // the next sample is from a different master, so jump to it
+    void relock() {
+        locked = false;
+    }
+
+    bool isLocked() const {
+        return locked;
+    }
+    int16_t rateTrim() const {
+        return rate;
+    }
+
+    private:
+    uint32_t anim;
+    uint32_t last_local;
+    uint32_t last_sample;
+    uint16_t frac;
+    int32_t  slew;
+    int16_t  rate;
+    bool     locked;
+    bool     acquired;
+};
+
+
+typedef struct sync_state_t {
+    uint32_t anim_ms;     // master's animation clock
+    uint32_t seed;        // the pattern started after sensors.seed(seed)
+    uint16_t phase;       // and has ticked this many times since
+    uint8_t  pattern_idx;
+    uint8_t  var0_idx;
+    uint8_t  delay_idx;
+    uint8_t  hops;        // from the master
+} sync_state_t;
+
+class sync_node_c {
+    public:
+    sync_node_c() : rx_len(0), rx_ready(false), master(false), heard(false),
+        ref_valid(false), tx_due(false), last_heard(0), last_tx(0), last_frame(0),
+        last_del(1) {
+        memset(&st, 0, sizeof(st));
+        st.pattern_idx = 0xff; // so that the first lead() starts it
+    };
+
+    // Called from the UART receive interrupt. Collects a frame and
+    // notes when its last byte came in.
+    void rxByte(uint8_t b, uint32_t local_ms) {
+        if (rx_ready) return; // loop has not picked up the last one
+        if ((rx_len == 0) && (b != SYNC_MAGIC0)) return;
+        if ((rx_len == 1) && (b != SYNC_MAGIC1)) {
+            rx_len = (b == SYNC_MAGIC0) ? 1 : 0;
+            return;
+        }
+        rx_buf[rx_len++] = b;
+        if (rx_len == SYNC_FRAME_LEN) {
+            rx_len   = 0;
+            rx_ms    = local_ms;
+            rx_ready = true;
+        }
+    }
+
+    // Call every time around loop(). Returns true when a follower has
+    // to restart its pattern from state(): clear the pixels, seed the
+    // sensors with state().seed and init() state().pattern_idx.
+    bool poll(uint32_t local_ms) {
+        bool restart = false;
+        if (rx_ready) {
+            sync_state_t in;
+            bool     ok = _decode(in);
+            uint32_t at = rx_ms;
+            rx_ready = false;
+            if (ok) {
+                if (master) DEBUG_PRINTLN_F("sync: following");
+                master     = false;
+                heard      = true;
+                last_heard = at;
+                // While the chain is starting up, units upstream follow
+                // one master and then another. The hop count changes 
+                // when they do, and their clock has nothing to do with
+                // the last one.
+                if (in.hops + 1 != st.hops) clock.relock();
+                clock.sample(at, in.anim_ms + SYNC_LINK_MS);
+                restart = (in.pattern_idx != st.pattern_idx) || (in.seed != st.seed);
+                st.pattern_idx = in.pattern_idx;
+                st.var0_idx    = in.var0_idx;
+                st.delay_idx   = in.delay_idx;
+                st.seed        = in.seed;
+                st.hops        = in.hops + 1;
+                if (restart) st.phase = 0;
+                ref_local = at;
+                ref_anim  = in.anim_ms;
+                ref_phase = in.phase;
+                ref_valid = true;
+                // pass it on
+                tx_due = true;
+            }
+        }
+        if (!master && ((local_ms - last_heard) > SYNC_TIMEOUT_MS)) {
+            DEBUG_PRINTLN_F("sync: leading");
+            master    = true;
+            ref_valid = false;
+            st.hops   = 0;
+        }
+        if (master && ((local_ms - last_tx) >= SYNC_PERIOD_MS)) tx_due = true;
+        return restart;
+    }
+
+    // For the master: call every time around loop(). Returns true when
+    // the pattern has changed, in which case pick a seed and restart().
+    bool lead(uint8_t pattern_idx, uint8_t var0_idx, uint8_t delay_idx) {
+        if (!master) return false;
+        st.var0_idx  = var0_idx;
+        st.delay_idx = delay_idx;
+        return pattern_idx != st.pattern_idx;
+    }
+    void restart(uint8_t pattern_idx, uint32_t seed) {
+        st.pattern_idx = pattern_idx;
+        st.seed        = seed;
+        st.phase       = 0;
+        tx_due         = true;
+    }
+
+    uint32_t now(uint32_t local_ms) {
+        return clock.now(local_ms);
+    }
+
+    // How many times to tick the pattern now: usually 0, or 1 when the
+    // clock passes into a new frame. A follower that is behind the
+    // master gets a few more to catch up, or none if it is ahead.
+    uint8_t ticksDue(uint32_t local_ms, uint16_t del) {
+        uint32_t f = clock.now(local_ms) / del;
+        last_del = del;
+        if (f == last_frame) return 0;
+        last_frame = f;
+        uint16_t expected = st.phase + 1;
+        if (!master && ref_valid) {
+            expected = ref_phase + (uint16_t)(f - ref_anim / del);
+        }
+        int16_t n = expected - st.phase;
+        if (n <= 0) return 0;
+        if (n > SYNC_MAX_CATCHUP) {
+            st.phase = expected - 1;
+            n = 1;
+        }
+        st.phase += n;
+        return n;
+    }
+
+    // Fills buf with a frame to go down the chain, if one is due, and
+    // returns its length, or 0. Call after the pattern has ticked, so
+    // that the phase sent goes with the clock.
+    uint8_t txFrame(uint8_t *buf, uint32_t local_ms) {
+        if (!tx_due || !(master || heard)) return 0;
+        tx_due  = false;
+        last_tx = local_ms;
+        uint16_t phase;
+        if (!master && ref_valid) {
+            // Pass on what was heard, plus the time since, rather than
+            // this unit's own clock. Followers each steering by the one
+            // before would make the error grow down a long chain.
+            st.anim_ms = ref_anim + SYNC_LINK_MS + (local_ms - ref_local);
+            phase = ref_phase + (uint16_t)(st.anim_ms / last_del - ref_anim / last_del);
+        } else {
+            st.anim_ms = clock.estimate(local_ms);
+            phase = st.phase + (uint16_t)(st.anim_ms / last_del - last_frame);
+        }
+        buf[0] = SYNC_MAGIC0;
+        buf[1] = SYNC_MAGIC1;
+        buf[2] = st.hops;
+        _put32(buf + 3, st.anim_ms);
+        _put32(buf + 7, st.seed);
+        buf[11] = phase & 0xff;
+        buf[12] = phase >> 8;
+        buf[13] = st.pattern_idx;
+        buf[14] = st.var0_idx;
+        buf[15] = st.delay_idx;
+        buf[16] = crc8(buf, SYNC_FRAME_LEN - 1);
+        return SYNC_FRAME_LEN;
+    }
+
+    bool isMaster() const {
+        return master;
+    }
+    bool isFollowing() const {
+        return !master && heard;
+    }
+    const sync_state_t &state() const {
+        return st;
+    }
+    const sync_clock_c &clockState() const {
+        return clock;
+    }
+
+    private:
+    sync_clock_c  clock;
+    sync_state_t  st;
+    uint8_t       rx_buf[SYNC_FRAME_LEN];
+    volatile uint8_t  rx_len;
+    volatile bool     rx_ready;
+    volatile uint32_t rx_ms;
+    bool          master;
+    bool          heard;
+    bool          ref_valid;
+    bool          tx_due;
+    uint32_t      last_heard;
+    uint32_t      last_tx;
+    uint32_t      last_frame;
+    uint16_t      last_del;
+    uint32_t      ref_local;
+    uint32_t      ref_anim;
+    uint16_t      ref_phase;
+
+    bool _decode(sync_state_t &in) const {
+        if (crc8(rx_buf, SYNC_FRAME_LEN - 1) != rx_buf[SYNC_FRAME_LEN - 1]) return false;
+        in.hops        = rx_buf[2];
+        in.anim_ms     = _get32(rx_buf + 3);
+        in.seed        = _get32(rx_buf + 7);
+        in.phase       = rx_buf[11] | ((uint16_t)rx_buf[12] << 8);
+        in.pattern_idx = rx_buf[13];
+        in.var0_idx    = rx_buf[14];
+        in.delay_idx   = rx_buf[15];
+        return true;
+    }
+    static void _put32(uint8_t *p, uint32_t v) {
+        for (uint8_t i=0;i<4;i++) {
+            p[i] = v & 0xff;
+            v >>= 8;
+        }
+    }
+    static uint32_t _get32(const uint8_t *p) {
+        uint32_t v = 0;
+        for (uint8_t i=0;i<4;i++) v |= (uint32_t)p[i] << (i*8);
+        return v;
+    }
+};
+
+#endif
+
@@ -12,7 +12,7 @@
 #include "tables.h"
 #include <Arduino.h>
 
-const uint8_t PROGMEM _sineTable[256] = {
+const progmem_array<uint8_t, 256> _sineTable PROGMEM = {
   128,131,134,137,140,143,146,149,152,155,158,162,165,167,170,173,
   176,179,182,185,188,190,193,196,198,201,203,206,208,211,213,215,
   218,220,222,224,226,228,230,232,234,235,237,238,240,241,243,244,
@@ -30,7 +30,7 @@ const uint8_t PROGMEM _sineTable[256] = {
    37, 40, 42, 44, 47, 49, 52, 54, 57, 59, 62, 65, 67, 70, 73, 76,
    79, 82, 85, 88, 90, 93, 97,100,103,106,109,112,115,118,121,124};
 
-const uint8_t PROGMEM _gammaTable[256] = {
+const progmem_array<uint8_t, 256> _gammaTable PROGMEM = {
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
     0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  1,  1,  1,  1,
     1,  1,  1,  1,  2,  2,  2,  2,  2,  2,  2,  2,  3,  3,  3,  3,
@@ -49,7 +49,8 @@ const uint8_t PROGMEM _gammaTable[256] = {
   218,220,223,225,227,230,232,235,237,240,242,245,247,250,252,255};
 
 
-const color3_t PROGMEM _colorTable[] = {
+// the outer braces are the progmem_array, the next the array in it
+const progmem_array<color3_t, P_NAVY + 1> _colorTable PROGMEM = {{
     // in R G B order
     { 0x00, 0x00, 0x00 },
     { 0xff, 0xff, 0xff },
@@ -67,23 +68,4 @@ const color3_t PROGMEM _colorTable[] = {
     { 0x80, 0x00, 0x80 },
     { 0x00, 0x80, 0x80 },
     { 0x00, 0x00, 0x80 },
-};
-
-color3_t getColor(const pixel_color_t pcolor) {
-  color3_t pc;
-  pc.d[0] = pgm_read_byte((uint8_t *)&_colorTable[pcolor]+0);
-  pc.d[1] = pgm_read_byte((uint8_t *)&_colorTable[pcolor]+1);
-  pc.d[2] = pgm_read_byte((uint8_t *)&_colorTable[pcolor]+2);
-  return pc;
-}
-
-
-
-
-uint8_t sine8(uint8_t x) {
-  return pgm_read_byte(&_sineTable[x]); // 0-255 in, 0-255 out
-}
-
-uint8_t gamma8(uint8_t x) {
-  return pgm_read_byte(&_gammaTable[x]); // 0-255 in, 0-255 out
-}
+}};
@@ -3,9 +3,7 @@
 #define __tables_h
 
 #include <stdint.h>
-
-uint8_t sine8(uint8_t x);
-uint8_t gamma8(uint8_t x);
+#include "progmem.h"
 
 typedef struct color3_t {
      uint8_t d[3];
@@ -30,7 +28,21 @@ typedef enum pixel_color_t {
     P_NAVY,
 } pixel_color_t;
 
-color3_t getColor(const pixel_color_t pcolor = P_BLACK);
+extern const progmem_array<uint8_t, 256>          _sineTable;
+extern const progmem_array<uint8_t, 256>          _gammaTable;
+extern const progmem_array<color3_t, P_NAVY + 1>  _colorTable;
+
+// 0-255 in, 0-255 out
+inline uint8_t sine8(uint8_t x) {
+    return _sineTable[x];
+}
+inline uint8_t gamma8(uint8_t x) {
+    return _gammaTable[x];
+}
+
+inline color3_t getColor(const pixel_color_t pcolor = P_BLACK) {
+    return _colorTable[pcolor];
+}
 
 #endif
 
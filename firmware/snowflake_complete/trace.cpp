@@ -0,0 +1,21 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "debug.h"
+
+#ifdef TRACE_DEBUG
+
+uint16_t trace_c::dropped = 0;
+
+#endif
+
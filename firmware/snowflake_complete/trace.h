@@ -0,0 +1,137 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __trace_h
+#define __trace_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "uart.h"
+
+// Binary trace records, used in place of Serial prints when
+// TRACE_DEBUG is defined in debug.h. A record is
+//
+//   0xa4 | type, id (3 bytes), millis (low 2 bytes), value (0,1,2,4 bytes)
+//
+// where type is the size of the value (0: none, 1: 1 byte, 2: 2 
+// bytes, 3: 4 bytes), all little-endian. The id is made at compile
+// time from the call site: 14 bits from a hash of the file name and
+// 10 bits of line number. The text that goes with each id lives only
+// in the source; tools/trace_decode.py reads the source to rebuild it,
+// and refuses to if two files with DEBUG_* calls in them hash the same
+// or one of them is over 1023 lines.
+//
+// Writing a record is a few dozen cycles. If the ring is full, the 
+// record is dropped and counted, and the count goes out (as id 0)
+// ahead of the next record that fits.
+
+const uint8_t  TRACE_SYNC     = 0xa4;
+const uint8_t  TRACE_HDR_LEN  = 6;
+const uint32_t TRACE_ID_DROPS = 0;
+
+// hash of the part of the path after the last slash
+constexpr uint16_t _trace_hash(const char *s, uint16_t h) {
+    return !*s ? h : _trace_hash(s + 1, ((*s == '/') || (*s == '\\')) ? 0 : (uint16_t)(h * 31 + *s));
+}
+constexpr uint16_t trace_file_id(const char *path) {
+    return (_trace_hash(path, 0) ^ (_trace_hash(path, 0) >> 14)) & 0x3fff;
+}
+
+#define TRACE_ID() (((uint32_t)trace_file_id(__FILE__) << 10) | (__LINE__ & 0x3ff))
+
+// the enum forces the id to be worked out by the compiler
+#define TRACE(...) \
+    do { \
+        enum : uint32_t { _trace_id = TRACE_ID() }; \
+        trace_c::record(_trace_id, ##__VA_ARGS__); \
+    } while (0)
+
+class trace_c {
+    public:
+        static void begin(uint32_t baud) {
+            uart_c::begin(baud);
+        }
+        static void flush() {
+            uart_c::flush();
+        }
+        // true if the largest record would go in now, with the count
+        // of dropped ones that may have to go ahead of it
+        static bool room() {
+            uint8_t sreg = SREG;
+            noInterrupts();
+            bool r = uart_c::txFree() >= 2 * TRACE_HDR_LEN + 4 + 2;
+            SREG = sreg;
+            return r;
+        }
+
+        static void record(uint32_t id) {
+            _put(id, 0, 0);
+        }
+        static void record(uint32_t id, const char *) {
+            _put(id, 0, 0);
+        }
+        static void record(uint32_t id, const __FlashStringHelper *) {
+            _put(id, 0, 0);
+        }
+        template<typename T>
+        static void record(uint32_t id, T v) {
+            _put(id, sizeof(T) > 2 ? 3 : sizeof(T), (uint32_t)v);
+        }
+
+    private:
+        static uint16_t dropped;
+
+        static void _drop() {
+            if (dropped != 0xffff) dropped += 1;
+        }
+
+        static void _header(uint8_t type, uint32_t id, uint16_t ts) {
+            uart_c::txPut(TRACE_SYNC | type);
+            uart_c::txPut(id & 0xff);
+            uart_c::txPut(id >> 8);
+            uart_c::txPut(id >> 16);
+            uart_c::txPut(ts & 0xff);
+            uart_c::txPut(ts >> 8);
+        }
+
+        static void _put(uint32_t id, uint8_t type, uint32_t v) {
+            uint8_t len = TRACE_HDR_LEN + (type == 3 ? 4 : type);
+            uint16_t ts = millis();
+            uint8_t sreg = SREG;
+            noInterrupts();
+            if (dropped) {
+                if (uart_c::txFree() < len + TRACE_HDR_LEN + 2) {
+                    _drop();
+                    SREG = sreg;
+                    return;
+                }
+                _header(2, TRACE_ID_DROPS, ts);
+                uart_c::txPut(dropped & 0xff);
+                uart_c::txPut(dropped >> 8);
+                dropped = 0;
+            }
+            if (uart_c::txFree() < len) {
+                _drop();
+                SREG = sreg;
+                return;
+            }
+            _header(type, id, ts);
+            for (uint8_t i=TRACE_HDR_LEN;i<len;i++) {
+                uart_c::txPut(v & 0xff);
+                v >>= 8;
+            }
+            uart_c::txStart();
+            SREG = sreg;
+        }
+};
+
+#endif
+
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "debug.h"
+#include "uart.h"
+
+// Using Serial pulls in the core's USART ISRs, so this driver only
+// exists when Serial is not in use.
+#ifndef SERIAL_DEBUG
+
+volatile uint8_t uart_c::tx_buf[UART_TX_LEN];
+volatile uint8_t uart_c::tx_head = 0;
+volatile uint8_t uart_c::tx_tail = 0;
+uart_rx_fn_t     uart_c::rx_fn   = 0;
+uart_tx_src_t    uart_c::tx_src  = 0;
+bool             uart_c::src_more = false;
+
+void uart_c::begin(uint32_t baud, uart_rx_fn_t rx) {
+    // double speed mode gives the closest rates at 8MHz
+    uint16_t ubrr = (F_CPU / 4 / baud - 1) / 2;
+    UBRR0  = ubrr;
+    UCSR0A = _BV(U2X0);
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00); // 8N1
+    UCSR0B = _BV(TXEN0);
+    rx_fn  = rx;
+    if (rx) UCSR0B |= _BV(RXEN0) | _BV(RXCIE0);
+}
+
+void uart_c::txStart() {
+    UCSR0B |= _BV(UDRIE0);
+}
+
+// With interrupts off (in an ISR, or on the way to a reset) the UDRE
+// interrupt cannot run, so this does its work for it, as
+// HardwareSerial::flush() does.
+void uart_c::flush() {
+    while (tx_head != tx_tail) {
+        if (!(SREG & _BV(SREG_I)) && (UCSR0A & _BV(UDRE0))) _udre_isr();
+    }
+}
+
+void uart_c::_udre_isr() {
+    if (tx_src && (src_more || (tx_head == tx_tail))) {
+        int16_t b = tx_src(src_more);
+        if (b >= 0) {
+            UDR0 = b;
+            return;
+        }
+    }
+    if (tx_head == tx_tail) {
+        UCSR0B &= ~_BV(UDRIE0);
+        return;
+    }
+    UDR0 = tx_buf[tx_tail];
+    tx_tail = (tx_tail + 1) & (UART_TX_LEN - 1);
+}
+
+ISR(USART_UDRE_vect) {
+    uart_c::_udre_isr();
+}
+
+void uart_c::_rx_isr() {
+    uint8_t st = UCSR0A;
+    uint8_t b  = UDR0;
+    // a byte with a framing error or after an overrun is not worth
+    // passing on
+    if (st & (_BV(FE0) | _BV(DOR0))) return;
+    rx_fn(b);
+}
+
+ISR(USART_RX_vect) {
+    uart_c::_rx_isr();
+}
+
+#endif
+
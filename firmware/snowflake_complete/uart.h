@@ -0,0 +1,69 @@
+///////////////////////////////////////////////
+// 
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __uart_h
+#define __uart_h
+
+#include <stdint.h>
+
+// A bare-bones interrupt-driven driver for USART0, for when the
+// firmware is not using the Arduino Serial object (whose ISRs would
+// clash with these). Bytes are queued in a ring and sent from the
+// data-register-empty interrupt, so nothing ever waits on the wire.
+//
+// txFree()/txPut() must be called with interrupts off, so that a
+// writer can check for room and then put a whole record in without
+// anyone else getting in between.
+//
+// The receiver is only turned on if begin() is given somewhere to
+// send what arrives; that function is called from the interrupt.
+//
+// Something with more to send than fits in the ring can be set as a
+// TX source. The interrupt asks it for a byte whenever the ring is
+// empty, and keeps asking, ahead of the ring, for as long as it says
+// there is more to come, so that what it sends is never split up.
+const uint8_t UART_TX_LEN = 64; // must be a power of 2
+
+typedef void (*uart_rx_fn_t)(uint8_t b);
+// returns the next byte, or -1 for nothing; more is set if the byte
+// is not the last of a record
+typedef int16_t (*uart_tx_src_t)(bool &more);
+
+class uart_c {
+    public:
+        static void begin(uint32_t baud, uart_rx_fn_t rx = 0);
+        static void txSource(uart_tx_src_t src) {
+            tx_src = src;
+        }
+        static uint8_t txFree() {
+            return (UART_TX_LEN - 1) - ((tx_head - tx_tail) & (UART_TX_LEN - 1));
+        }
+        static void txPut(uint8_t b) {
+            tx_buf[tx_head] = b;
+            tx_head = (tx_head + 1) & (UART_TX_LEN - 1);
+        }
+        // start the interrupt draining whatever has been put
+        static void txStart();
+        // wait for everything queued to go out; safe with interrupts off
+        static void flush();
+        static void _udre_isr();
+        static void _rx_isr();
+    private:
+        static uart_rx_fn_t rx_fn;
+        static uart_tx_src_t tx_src;
+        static bool src_more;
+        static volatile uint8_t tx_buf[UART_TX_LEN];
+        static volatile uint8_t tx_head;
+        static volatile uint8_t tx_tail;
+};
+
+#endif
+
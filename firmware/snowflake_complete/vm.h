@@ -0,0 +1,303 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __vm_h
+#define __vm_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "fun_stuff.h"
+#include "stored.h"
+
+// A pattern that runs a small bytecode program, so that new patterns
+// can be tried out without reflashing. Programs are written in the
+// assembly language tools/vmasm.py takes; the ones built in are in
+// vm_progs.h, and one more can be uploaded into the top of the EEPROM
+// (see vm_upload.h), where it takes the place of the built-in one.
+//
+// The machine has 16 byte registers, r0-r15, and 4 color registers,
+// c0-c3, all zeroed by init(). init() runs the program from the top
+// and each tick runs it from the tick entry, each until an END. So
+// that a bad program cannot hang the sketch, a run stops after
+// VM_MAX_STEPS instructions, or if it jumps off the end.
+//
+// An image is
+//
+//   'V' 'm' len tick crc8  code ... (len bytes)
+//
+// with jump targets, the tick entry and LDP addresses all counted
+// from the start of the code. Images are checked when they are
+// loaded; after that, register and color numbers are masked rather
+// than checked, so the worst a corrupt program can do is draw junk.
+//
+// The EEPROM is read a byte at a time for every instruction, which
+// costs a little over 1us each (the profiler shows it), but leaves
+// the program's RAM free for the patterns.
+
+const uint8_t  VM_MAGIC0     = 'V';
+const uint8_t  VM_MAGIC1     = 'm';
+const uint8_t  VM_HDR_LEN    = 5;
+const uint8_t  VM_REGS       = 16; // must be a power of 2
+const uint8_t  VM_COLORS     = 4;  // must be a power of 2
+const uint16_t VM_MAX_STEPS  = 1024;
+
+// the top quarter of the EEPROM; settings are kept below it
+const uint16_t VM_EEP_BASE   = 0x300;
+const uint16_t VM_EEP_SIZE   = 0x100;
+const uint8_t  VM_MAX_CODE   = VM_EEP_SIZE - VM_HDR_LEN;
+
+// rN is a register, cN a color register, imm a byte and addr a code
+// address. Keep tools/vmasm.py in step with this.
+typedef enum vm_op_t {
+    VM_END = 0, //                   stop; init() or the tick is done
+    VM_LDI,     // rd imm            rd = imm
+    VM_MOV,     // rd rs             rd = rs
+    VM_ADD,     // rd rs             rd += rs
+    VM_SUB,     // rd rs             rd -= rs
+    VM_ADDI,    // rd imm            rd += imm
+    VM_AND,     // rd rs             rd &= rs
+    VM_ANDI,    // rd imm            rd &= imm
+    VM_SHR,     // rd imm            rd >>= imm
+    VM_SHL,     // rd imm            rd <<= imm
+    VM_MUL,     // rd rs             rd = rd * rs / 256
+    VM_MOD,     // rd rs             rd %= rs, unless rs is 0
+    VM_LDP,     // rd addr rs        rd = code[addr + rs], for tables
+    VM_JMP,     // addr
+    VM_JZ,      // rs addr           jump if rs == 0
+    VM_JNZ,     // rs addr           jump if rs != 0
+    VM_JLT,     // ra rb addr        jump if ra < rb
+    VM_DJNZ,    // rd addr           rd -= 1, jump if rd != 0
+    VM_SIN,     // rd rs             rd = sine8(rs)
+    VM_RND,     // rd                rd = rand8()
+    VM_VAR,     // rd                rd = var0_idx
+    VM_LEN,     // rd                rd = number of pixels
+    VM_GEO,     // rd kind rs        rd = where pixel rs is (vm_geo_t)
+    VM_RGB,     // cd rr rg rb       cd = (rr, rg, rb)
+    VM_COL,     // cd imm            cd = named color imm (pixel_color_t)
+    VM_RCOL,    // cd                cd = rand32()
+    VM_SET,     // rp cs             pixel (rp % len) = cs
+    VM_GET,     // cd rp             cd = pixel (rp % len)
+    VM_FILL,    // cs                every pixel = cs
+    VM_CLR,     //                   every pixel off
+    VM_ROT,     // kind rs           rotate by one (rotate_type_t),
+                //                   backward if rs is odd
+    VM_MIX,     // cd ca cb rf       cd = ca * (255 - rf) + cb * rf
+    VM_SCL,     // cd rs             cd = cd * rs / 256
+    VM_ADDC,    // cd cs             cd += cs, saturating
+    VM_CPY,     // cd cs             cd = cs
+    VM_OP_COUNT,
+} vm_op_t;
+
+typedef enum vm_geo_t {
+    VM_GEO_ARM,   // which arm, 0-5
+    VM_GEO_SPOKE, // how far along the chain in its arm, 0-4
+    VM_GEO_RING,  // 0 for the inner ring, 1 for the outer
+    VM_GEO_CYLON, // cylons[rs], the pixels of the Cylon pattern's rows
+    VM_GEO_COUNT,
+} vm_geo_t;
+
+template<class PIX_C, class SENS_C, class VARNS_C>
+class Fun_VM_c : public Fun_Base_c<PIX_C, SENS_C, VARNS_C> {
+    typedef Fun_Base_c<PIX_C, SENS_C, VARNS_C> parent_t;
+
+    public:
+    // prog is the built-in image, in PROGMEM. It is run when there is
+    // no good program in the EEPROM, or always if use_eep is false.
+    Fun_VM_c(PIX_C &inp, SENS_C &insens, VARNS_C &invarns,
+             const uint8_t *prog, bool use_eep = true) :
+        parent_t(inp,insens,invarns), builtin(prog), use_eeprom(use_eep),
+        eep(false), len(0), tick_pc(0), pc(0), steps(0) { };
+
+    // Loads the program again, so this also picks up a new upload.
+    void init() {
+        memset(r, 0, sizeof(r));
+        for (uint8_t i=0;i<VM_COLORS;i++) c[i] = pixel_t();
+        eep = use_eeprom && _load(true);
+        if (!eep && !_load(false)) {
+            DEBUG_PRINTLN_F("vm: bad built-in program");
+            len = 0;
+            return;
+        }
+        _run(0);
+    }
+
+    void _tick() {
+        if (len) _run(tick_pc);
+    }
+
+    // instructions the last run took, to compare with native patterns
+    uint16_t lastSteps() const {
+        return steps;
+    }
+    bool fromEeprom() const {
+        return eep;
+    }
+
+    private:
+    const uint8_t *builtin;
+    bool     use_eeprom;
+    bool     eep;
+    uint8_t  len;
+    uint8_t  tick_pc;
+    uint8_t  pc;
+    uint16_t steps;
+    uint8_t  r[VM_REGS];
+    pixel_t  c[VM_COLORS];
+
+    uint8_t _img(uint8_t i) const {
+        return eep ? eeprom_writer_c::read(VM_EEP_BASE + i) : pgm_read_byte(builtin + i);
+    }
+    uint8_t _code(uint8_t a) const {
+        return _img(VM_HDR_LEN + a);
+    }
+
+    bool _load(bool from_eep) {
+        eep = from_eep;
+        if (!eep && !builtin) return false;
+        if ((_img(0) != VM_MAGIC0) || (_img(1) != VM_MAGIC1)) return false;
+        uint8_t l = _img(2);
+        uint8_t t = _img(3);
+        if (!l || (l > VM_MAX_CODE) || (t >= l)) return false;
+        uint8_t crc = 0;
+        for (uint8_t i=0;i<l;i++) crc = crc8_update(crc, _code(i));
+        if (crc != _img(4)) {
+            DEBUG_PRINTLN_F("vm: bad crc");
+            return false;
+        }
+        len     = l;
+        tick_pc = t;
+        return true;
+    }
+
+    uint8_t _next() {
+        return _code(pc++);
+    }
+    uint8_t &_r() {
+        return r[_next() & (VM_REGS - 1)];
+    }
+    pixel_t &_c() {
+        return c[_next() & (VM_COLORS - 1)];
+    }
+    // a register as a pixel index, so that no program can reach past
+    // the chain
+    uint8_t _pix(uint8_t p) const {
+        return p % parent_t::pixels.len();
+    }
+
+    void _run(uint8_t start) {
+        pc = start;
+        for (steps=0;steps<VM_MAX_STEPS;steps++) {
+            if (pc >= len) return;
+            uint8_t op = _next();
+            switch (op) {
+                case VM_END:
+                    steps++;
+                    return;
+                case VM_LDI:  { uint8_t &d = _r(); d = _next(); break; }
+                case VM_MOV:  { uint8_t &d = _r(); d = _r(); break; }
+                case VM_ADD:  { uint8_t &d = _r(); d += _r(); break; }
+                case VM_SUB:  { uint8_t &d = _r(); d -= _r(); break; }
+                case VM_ADDI: { uint8_t &d = _r(); d += _next(); break; }
+                case VM_AND:  { uint8_t &d = _r(); d &= _r(); break; }
+                case VM_ANDI: { uint8_t &d = _r(); d &= _next(); break; }
+                case VM_SHR:  { uint8_t &d = _r(); d >>= (_next() & 0x7); break; }
+                case VM_SHL:  { uint8_t &d = _r(); d <<= (_next() & 0x7); break; }
+                case VM_MUL:  { uint8_t &d = _r(); d = ((uint16_t)d * _r()) >> 8; break; }
+                case VM_MOD:  {
+                    uint8_t &d = _r();
+                    uint8_t  s = _r();
+                    if (s) d %= s;
+                    break;
+                }
+                case VM_LDP:  {
+                    uint8_t &d = _r();
+                    uint8_t  a = _next();
+                    uint16_t i = (uint16_t)a + _r();
+                    d = (i < len) ? _code(i) : 0;
+                    break;
+                }
+                case VM_JMP:  pc = _next(); break;
+                case VM_JZ:   { uint8_t s = _r(); uint8_t a = _next(); if (!s) pc = a; break; }
+                case VM_JNZ:  { uint8_t s = _r(); uint8_t a = _next(); if (s)  pc = a; break; }
+                case VM_JLT:  {
+                    uint8_t ra = _r();
+                    uint8_t rb = _r();
+                    uint8_t a  = _next();
+                    if (ra < rb) pc = a;
+                    break;
+                }
+                case VM_DJNZ: { uint8_t &d = _r(); uint8_t a = _next(); if (--d) pc = a; break; }
+                case VM_SIN:  { uint8_t &d = _r(); d = sine8(_r()); break; }
+                case VM_RND:  _r() = parent_t::sensors.rand8(); break;
+                case VM_VAR:  _r() = parent_t::varns.var0_idx; break;
+                case VM_LEN:  _r() = parent_t::pixels.len(); break;
+                case VM_GEO:  {
+                    uint8_t &d = _r();
+                    uint8_t  k = _next();
+                    d = _geo(k, _r());
+                    break;
+                }
+                case VM_RGB:  {
+                    pixel_t &d = _c();
+                    uint8_t red = _r();
+                    uint8_t grn = _r();
+                    uint8_t blu = _r();
+                    d = pixel_t(red, grn, blu);
+                    break;
+                }
+                case VM_COL:  {
+                    pixel_t &d = _c();
+                    uint8_t  n = _next();
+                    d = pixel_t(n > P_NAVY ? P_BLACK : (pixel_color_t)n);
+                    break;
+                }
+                case VM_RCOL: _c() = pixel_t(parent_t::sensors.rand32()); break;
+                case VM_SET:  { uint8_t p = _pix(_r()); parent_t::pixels.set(p, _c()); break; }
+                case VM_GET:  { pixel_t &d = _c(); d = parent_t::pixels.get(_pix(_r())); break; }
+                case VM_FILL: parent_t::pixels.setAll(_c()); break;
+                case VM_CLR:  parent_t::pixels.clear(); break;
+                case VM_ROT:  {
+                    uint8_t k = _next();
+                    bool dir  = _r() & 0x1;
+                    parent_t::pixels.rotate(1, dir, k > ROTATE_ALL ? ROTATE_ALL : (rotate_type_t)k);
+                    break;
+                }
+                case VM_MIX:  {
+                    pixel_t &d  = _c();
+                    pixel_t &ca = _c();
+                    pixel_t &cb = _c();
+                    d.mix(ca, cb, _r());
+                    break;
+                }
+                case VM_SCL:  { pixel_t &d = _c(); d.scale(_r()); break; }
+                case VM_ADDC: { pixel_t &d = _c(); d.add(_c()); break; }
+                case VM_CPY:  { pixel_t &d = _c(); d = _c(); break; }
+                default:
+                    DEBUG_PRINTLN_F("vm: bad op");
+                    len = 0;
+                    return;
+            }
+        }
+    }
+
+    uint8_t _geo(uint8_t kind, uint8_t n) const {
+        switch (kind) {
+            case VM_GEO_ARM:   return n / 5;
+            case VM_GEO_SPOKE: return n % 5;
+            case VM_GEO_RING:  { uint8_t s = n % 5; return (s && (s < 4)) ? 1 : 0; }
+            case VM_GEO_CYLON: return cylons[n % cylons.size()];
+            default:           return 0;
+        }
+    }
+};
+
+#endif
+
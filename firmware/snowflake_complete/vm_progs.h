@@ -0,0 +1,58 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __vm_progs_h
+#define __vm_progs_h
+
+#include <stdint.h>
+#include <Arduino.h>
+
+// Built-in programs for the VM pattern (vm.h). Made by
+//
+//   tools/vmasm.py -H vm_progs.h tools/vm/*.vms
+//
+// from the sources in tools/vm; edit those, not this.
+
+// arms.vms, 85 bytes
+const uint8_t PROGMEM vm_prog_arms[] = {
+    0x56, 0x6d, 0x50, 0x07, 0x4d, 0x18, 0x01, 0x04, 0x18, 0x02, 0x01, 0x00,
+    0x14, 0x05, 0x05, 0x05, 0x01, 0x03, 0x00, 0x05, 0x15, 0x02, 0x01, 0x01,
+    0x00, 0x16, 0x03, 0x00, 0x01, 0x0c, 0x03, 0x4a, 0x03, 0x16, 0x06, 0x01,
+    0x01, 0x09, 0x06, 0x04, 0x03, 0x03, 0x06, 0x03, 0x03, 0x00, 0x12, 0x04,
+    0x03, 0x16, 0x06, 0x02, 0x01, 0x0e, 0x06, 0x3a, 0x1f, 0x00, 0x01, 0x02,
+    0x04, 0x0d, 0x3f, 0x1f, 0x00, 0x02, 0x01, 0x04, 0x1a, 0x01, 0x00, 0x05,
+    0x01, 0x01, 0x10, 0x01, 0x02, 0x14, 0x00, 0x00, 0x2b, 0x55, 0x80, 0xab,
+    0xd5,
+};
+
+// pulse.vms, 63 bytes
+const uint8_t PROGMEM vm_prog_pulse[] = {
+    0x56, 0x6d, 0x3a, 0x01, 0x5a, 0x00, 0x14, 0x03, 0x05, 0x03, 0x01, 0x0f,
+    0x00, 0x11, 0x10, 0x01, 0x03, 0x0f, 0x0d, 0x11, 0x19, 0x01, 0x02, 0x04,
+    0x01, 0x0e, 0x00, 0x1d, 0x01, 0x04, 0xff, 0x04, 0x04, 0x01, 0x22, 0x00,
+    0x01, 0x20, 0x00, 0x04, 0x1c, 0x00, 0x02, 0x02, 0x01, 0x03, 0x01, 0x03,
+    0x10, 0x01, 0x02, 0x30, 0x00, 0x01, 0x05, 0x01, 0x04, 0x05, 0x00, 0x02,
+    0x00, 0x05, 0x00,
+};
+
+// rainbow.vms, 86 bytes
+const uint8_t PROGMEM vm_prog_rainbow[] = {
+    0x56, 0x6d, 0x51, 0x01, 0xa3, 0x00, 0x14, 0x04, 0x07, 0x04, 0x07, 0x0c,
+    0x02, 0x41, 0x04, 0x0c, 0x03, 0x49, 0x04, 0x15, 0x07, 0x01, 0x01, 0x00,
+    0x02, 0x05, 0x00, 0x12, 0x08, 0x05, 0x02, 0x06, 0x05, 0x03, 0x06, 0x02,
+    0x12, 0x09, 0x06, 0x02, 0x06, 0x05, 0x03, 0x06, 0x03, 0x12, 0x0a, 0x06,
+    0x17, 0x00, 0x08, 0x09, 0x0a, 0x1a, 0x01, 0x00, 0x05, 0x05, 0x08, 0x05,
+    0x01, 0x01, 0x10, 0x01, 0x07, 0x16, 0x05, 0x00, 0x01, 0x00, 0x2a, 0x00,
+    0x80, 0x00, 0x80, 0x55, 0xaa, 0x00, 0x55, 0x00, 0x80, 0x80, 0x00, 0x2a,
+    0x00, 0xa0,
+};
+
+#endif
@@ -0,0 +1,109 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "helpers.h"
+#include "stored.h"
+#include "uart.h"
+#include "vm_upload.h"
+
+#ifdef VM_UPLOAD_ENABLE
+
+uint8_t                 vm_upload_c::buf[VM_UPLOAD_CHUNK + 2];
+vm_upload_c::rx_state_t vm_upload_c::state   = st_magic0;
+uint8_t                 vm_upload_c::pos     = 0;
+volatile uint8_t        vm_upload_c::rx_crc  = 0;
+volatile bool           vm_upload_c::ready   = false;
+bool                    vm_upload_c::writing = false;
+
+void vm_upload_c::begin() {
+    uart_c::begin(VM_UPLOAD_BAUD, _rxByte);
+}
+
+// from the UART receive interrupt
+void vm_upload_c::_rxByte(uint8_t b) {
+    switch (state) {
+        case st_magic0:
+            if (b == VM_UPLOAD_MAGIC0) state = st_magic1;
+            break;
+        case st_magic1:
+            state = (b == VM_UPLOAD_MAGIC1) ? st_off :
+                    (b == VM_UPLOAD_MAGIC0) ? st_magic1 : st_magic0;
+            break;
+        case st_off:
+            // the sender waits for an answer, so this is only a resend
+            // after a lost one
+            if (ready) {
+                state = st_magic0;
+                break;
+            }
+            buf[0] = b;
+            state  = st_len;
+            break;
+        case st_len:
+            if (b > VM_UPLOAD_CHUNK) {
+                state = st_magic0;
+                break;
+            }
+            buf[1] = b;
+            pos    = 2;
+            state  = b ? st_data : st_crc;
+            break;
+        case st_data:
+            buf[pos++] = b;
+            if (pos == buf[1] + 2) state = st_crc;
+            break;
+        case st_crc:
+            rx_crc = b;
+            ready  = true;
+            state  = st_magic0;
+            break;
+    }
+}
+
+void vm_upload_c::_reply(uint8_t b) {
+    uint8_t sreg = SREG;
+    noInterrupts();
+    if (uart_c::txFree()) {
+        uart_c::txPut(b);
+        uart_c::txStart();
+    }
+    SREG = sreg;
+}
+
+bool vm_upload_c::poll() {
+    if (!ready) return false;
+    uint8_t off = buf[0];
+    uint8_t n   = buf[1];
+    if (!writing) {
+        if ((crc8(buf, n + 2) != rx_crc) || ((uint16_t)off + n > VM_EEP_SIZE)) {
+            ready = false;
+            _reply(VM_UPLOAD_NAK);
+            return false;
+        }
+        for (uint8_t i=0;i<n;i++) {
+            uint16_t addr = VM_EEP_BASE + off + i;
+            if (eeprom_writer_c::read(addr) != buf[2 + i]) eeprom_writer_c::write(addr, buf[2 + i]);
+        }
+        writing = true;
+    }
+    // answer only once it is in the EEPROM, so the sender never gets
+    // ahead of the writes
+    if (!eeprom_writer_c::done()) return false;
+    writing = false;
+    ready   = false;
+    _reply(VM_UPLOAD_ACK);
+    if (!n) DEBUG_PRINTLN_F("vm: program uploaded");
+    return !n;
+}
+
+#endif
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////
+//
+// Copyright 2019 South Berkeley Electronics
+// All Rights Reserved
+//
+// Arduino sketch to control an LED snowflake.
+//
+// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)
+//
+///////////////////////////////////////////////
+
+#ifndef __vm_upload_h
+#define __vm_upload_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "debug.h"
+#include "vm.h"
+
+// Takes a program for the VM pattern (see vm.h) over the UART and
+// writes it into the EEPROM. tools/vmasm.py --upload sends it as
+// chunks of
+//
+//   'V' 'u' off n  data ... (n bytes)  crc8
+//
+// with off counted from VM_EEP_BASE and the crc over off, n and the
+// data. Each is answered with VM_UPLOAD_ACK once it has been written,
+// or VM_UPLOAD_NAK if it was bad, and the sender waits for that
+// before sending the next. A chunk with n = 0 ends the upload.
+//
+// The image is checked when the VM loads it, so an upload that never
+// finishes leaves the VM running its built-in program.
+//
+// Shares the UART with TRACE_DEBUG, at the same speed; the answers
+// are not trace sync bytes.
+
+// #define VM_UPLOAD_ENABLE
+
+#if defined(VM_UPLOAD_ENABLE) && (defined(SERIAL_DEBUG) || defined(SYNC_ENABLE) || defined(STREAM_ENABLE) || defined(MIRROR_ENABLE))
+#error "VM_UPLOAD_ENABLE needs the UART; SERIAL_DEBUG, SYNC_ENABLE, STREAM_ENABLE and MIRROR_ENABLE use it too"
+#endif
+
+const uint32_t VM_UPLOAD_BAUD  = 19200; // what DEBUG_INIT uses
+const uint8_t  VM_UPLOAD_MAGIC0 = 'V';
+const uint8_t  VM_UPLOAD_MAGIC1 = 'u';
+const uint8_t  VM_UPLOAD_ACK   = 'k';
+const uint8_t  VM_UPLOAD_NAK   = 'e';
+// small enough that the writes all fit in the eeprom_writer_c queue
+const uint8_t  VM_UPLOAD_CHUNK = 8;
+
+class vm_upload_c {
+    public:
+        static void begin();
+        // Call from loop(). True when an upload has just finished, and
+        // the VM should be init()ed if it is running.
+        static bool poll();
+        static void _rxByte(uint8_t b);
+    private:
+        typedef enum {
+            st_magic0,
+            st_magic1,
+            st_off,
+            st_len,
+            st_data,
+            st_crc,
+        } rx_state_t;
+
+        static void _reply(uint8_t b);
+
+        // off, n and the data, as the crc covers them
+        static uint8_t buf[VM_UPLOAD_CHUNK + 2];
+        static rx_state_t state;
+        static uint8_t pos;
+        static volatile uint8_t rx_crc;
+        static volatile bool ready;
+        static bool writing;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+###############################################
+#
+# Copyright 2019 South Berkeley Electronics
+# All Rights Reserved
+#
+# Compares two runs of host/primbench.cpp and flags each op that got
+# slower by more than the threshold. Exits 1 if any did, so it can
+# gate a build.
+#
+#   for i in 1 2 3; do ../host/primbench > now$i.json; done
+#   ./bench_compare.py ../host/primbench_host.json now1.json now2.json now3.json
+#
+# Given several runs it takes the fastest of each op; -w writes that
+# out, to make a new baseline.
+#
+# Host times move about from run to run and machine to machine, so
+# compare against a baseline made on the same machine; by default an
+# op has to be 20% slower, and by at least 2ns, to count. AVR cycles
+# would not move at all, so there any change counts; but primbench's
+# AVR build has not been made to work yet, and there is no AVR
+# baseline (see host/primbench.cpp).
+#
+###############################################
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def best(runs):
+    # the fastest of each op over a few runs of the same target
+    out = dict(runs[0])
+    res = dict(out['results'])
+    for r in runs[1:]:
+        if (r.get('target'), r.get('unit')) != (out.get('target'), out.get('unit')):
+            sys.exit('runs are not all from the same target')
+        for name, v in r['results'].items():
+            res[name] = min(v, res.get(name, v))
+    out['results'] = res
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description='flag primitives that got slower')
+    ap.add_argument('baseline', help='JSON from an earlier run')
+    ap.add_argument('current', nargs='+', help='JSON from one or more runs now')
+    ap.add_argument('-t', '--threshold', type=float, default=None,
+                    help='percent slower that counts (default 20 for ns, 0 for cycles)')
+    ap.add_argument('--floor', type=float, default=None,
+                    help='least slowdown that counts, in the unit of the runs '
+                         '(default 2 for ns, 0 for cycles)')
+    ap.add_argument('-w', '--write', help='write the fastest of the runs here')
+    args = ap.parse_args()
+
+    base = load(args.baseline)
+    cur  = best([load(p) for p in args.current])
+    if args.write:
+        with open(args.write, 'w') as f:
+            json.dump(cur, f, indent=2)
+            f.write('\n')
+    if (base.get('target'), base.get('unit')) != (cur.get('target'), cur.get('unit')):
+        sys.exit('cannot compare %s %s with %s %s' %
+                 (base.get('target'), base.get('unit'), cur.get('target'), cur.get('unit')))
+    unit  = cur.get('unit')
+    floor = args.floor
+    if floor is None:
+        floor = 2.0 if unit == 'ns' else 0.0
+    threshold = args.threshold
+    if threshold is None:
+        threshold = 20.0 if unit == 'ns' else 0.0
+
+    bres, cres = base['results'], cur['results']
+    worse = 0
+    print('%-24s %10s %10s %8s' % ('op', 'was', 'now', 'change'))
+    for name in cres:
+        if name not in bres:
+            print('%-24s %10s %10.2f %8s  new' % (name, '-', cres[name], ''))
+            continue
+        was, now = bres[name], cres[name]
+        change = 100.0 * (now - was) / was if was else (0.0 if now == was else float('inf'))
+        flag = ''
+        if (change > threshold) and (now - was > floor):
+            flag = 'SLOWER'
+            worse += 1
+        print('%-24s %10.2f %10.2f %+7.1f%%  %s' % (name, was, now, change, flag))
+    for name in bres:
+        if name not in cres:
+            print('%-24s %10.2f %10s %8s  gone' % (name, bres[name], '-', ''))
+
+    if worse:
+        print('%d op(s) more than %g%% slower' % (worse, threshold))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
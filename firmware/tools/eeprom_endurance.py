@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+###############################################
+#
+# Copyright 2019 South Berkeley Electronics
+# All Rights Reserved
+#
+# Host-side simulation of EEPROM wear for the snowflake settings
+# store. Replays a number of settings saves against a model of the
+# EEPROM and reports how many times each cell gets written, both for
+# the old fixed-address layout (stored2_c) and for the log-structured
+# ring (storedlog_c in stored.h).
+#
+# The ATmega328P EEPROM is rated for 100,000 writes per cell.
+#
+###############################################
+
+import argparse
+import random
+
+EEPROM_SIZE   = 1024
+ENDURANCE     = 100000
+HDR_LEN       = 4
+
+
+def crc8(data):
+    crc = 0
+    for d in data:
+        crc ^= d
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xff if crc & 0x80 else (crc << 1) & 0xff
+    return crc
+
+
+class Eeprom:
+    def __init__(self, size):
+        self.cells  = [0xff] * size
+        self.writes = [0] * size
+
+    def write(self, addr, d):
+        self.cells[addr] = d
+        self.writes[addr] += 1
+
+    def update(self, addr, d):
+        # stored2_c skips writing a cell that already holds the value
+        if self.cells[addr] != d:
+            self.write(addr, d)
+
+
+class FixedStore:
+    def __init__(self, ee, base, size):
+        self.ee, self.base, self.size = ee, base, size
+
+    def store(self, payload):
+        for j, d in enumerate(payload):
+            self.ee.update(self.base + j, d)
+
+
+class LogStore:
+    def __init__(self, ee, base, size, slot_size, version=1):
+        self.ee, self.base, self.slot_size = ee, base, slot_size
+        self.slots   = size // slot_size
+        self.version = version
+        self.newest  = None
+        self.seq     = 0
+
+    def store(self, payload):
+        slot = 0 if self.newest is None else (self.newest + 1) % self.slots
+        seq  = 0 if self.newest is None else (self.seq + 1) & 0xffff
+        rec  = [seq & 0xff, seq >> 8, self.version, len(payload)] + list(payload)
+        rec.append(crc8(rec))
+        # the slot is written whole, without reading it back
+        a = self.base + slot * self.slot_size
+        for j in range(2, len(rec)):
+            self.ee.write(a + j, rec[j])
+        self.ee.write(a + 1, rec[1])
+        self.ee.write(a + 0, rec[0])
+        self.newest, self.seq = slot, seq
+
+
+def simulate(store, saves, nfields, rng):
+    settings = [0] * nfields
+    for _ in range(saves):
+        # a typical save changes one or two of the indices
+        for _ in range(rng.choice((1, 1, 2))):
+            i = rng.randrange(nfields)
+            settings[i] = (settings[i] + 1) % 16
+        store.store(settings)
+
+
+def report(name, ee, lo, hi, saves):
+    w = ee.writes[lo:hi]
+    used = [x for x in w if x]
+    worst = max(w)
+    mean  = sum(used) / len(used) if used else 0
+    life  = (ENDURANCE * saves // worst) if worst else float('inf')
+    print('%-8s cells used %4d  max writes/cell %7d  mean %9.1f  saves to wear-out %s' %
+          (name, len(used), worst, mean, life))
+
+
+def main():
+    ap = argparse.ArgumentParser(description='EEPROM wear simulation for the settings store')
+    ap.add_argument('--saves',  type=int, default=100000, help='number of settings saves')
+    ap.add_argument('--fields', type=int, default=7,      help='bytes in varn_indices_t')
+    # as the sketch has it with neither ENERGY_ENABLE nor VM_UPLOAD_ENABLE;
+    # --size 0xf0 for the log below the energy table, 0x2f0 below the VM's
+    ap.add_argument('--base',   type=lambda x: int(x, 0), default=0x10)
+    ap.add_argument('--size',   type=lambda x: int(x, 0), default=EEPROM_SIZE - 0x10)
+    ap.add_argument('--slot',   type=int, default=16,     help='log slot size in bytes')
+    ap.add_argument('--seed',   type=int, default=1)
+    args = ap.parse_args()
+
+    assert args.fields + HDR_LEN + 1 <= args.slot, 'settings do not fit in a slot'
+
+    ee = Eeprom(EEPROM_SIZE)
+    simulate(FixedStore(ee, 0x1, args.fields), args.saves, args.fields, random.Random(args.seed))
+    report('fixed', ee, 0, EEPROM_SIZE, args.saves)
+
+    ee = Eeprom(EEPROM_SIZE)
+    simulate(LogStore(ee, args.base, args.size, args.slot), args.saves, args.fields,
+             random.Random(args.seed))
+    report('log', ee, args.base, args.base + args.size, args.saves)
+
+
+if __name__ == '__main__':
+    main()
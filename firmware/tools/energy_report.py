@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+###############################################
+#
+# Copyright 2019 South Berkeley Electronics
+# All Rights Reserved
+#
+# Ranks the patterns by what they draw from the battery, from the
+# energy table (energy.h, ENERGY_ENABLE) in an EEPROM image: one read
+# off a unit, or made by host/energysim.cpp.
+#
+#   avrdude -p m328p -c usbtiny -U eeprom:r:unit.eep:r
+#   ./energy_report.py unit.eep --sketch ../snowflake_complete
+#
+# For each pattern (or, with -v, each pattern and var0) it gives the
+# average mA while running, which is mAh per hour, at each of the
+# brightnesses[] settings, in a bright room where the light sensor
+# lets the brightness all the way up. The LEDs' share goes with the
+# table's average load times the brightness; the MCU, which never
+# sleeps while running, the IR receiver and the chain's idle draw are
+# the same for every pattern, and are taken from the options. So the
+# order is the same at every brightness, and the spread grows with it.
+#
+###############################################
+
+import argparse
+import os
+import re
+import sys
+
+EEPROM_SIZE    = 1024
+ENERGY_VERSION = 1
+HDR_LEN        = 4
+CELL_LEN       = 3
+UNIT_SECONDS   = 15
+MAX_UNITS      = 254
+
+
+def crc8(data):
+    crc = 0
+    for d in data:
+        crc ^= d
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xff if crc & 0x80 else (crc << 1) & 0xff
+    return crc
+
+
+def read_source(sketch_dir, name):
+    with open(os.path.join(sketch_dir, name)) as f:
+        return f.read()
+
+
+def pattern_names(sketch_dir):
+    # the order of patterns[], from the list in patterns.h
+    if not os.path.exists(os.path.join(sketch_dir, 'patterns.h')):
+        return []
+    return re.findall(r'^\s*PATTERN\((\w+),', read_source(sketch_dir, 'patterns.h'), re.M)
+
+
+def sketch_consts(sketch_dir):
+    # brightnesses[] and the chain length from settings.h, and where
+    # the table is from energy.h
+    settings = read_source(sketch_dir, 'settings.h')
+    energy   = read_source(sketch_dir, 'energy.h')
+    m = re.search(r'\bbrightnesses\s+PROGMEM\s*=\s*\{([^}]*)\}', settings)
+    brites = [int(b, 0) for b in m.group(1).split(',') if b.strip()]
+    pixels = int(re.search(r'PIXEL_CHAIN_LENGTH\s*=\s*(\w+)', settings).group(1), 0)
+    base   = int(re.search(r'ENERGY_EEP_BASE\s*=\s*(\w+)', energy).group(1), 0)
+    return brites, pixels, base
+
+
+def load_table(image, base):
+    # returns {(pattern, var0): (load, units)}, load 0..1 of all on
+    hdr = image[base:base + HDR_LEN]
+    if len(hdr) < HDR_LEN or hdr[0] != ENERGY_VERSION or crc8(hdr[:3]) != hdr[3]:
+        sys.exit('no energy table at 0x%x (is ENERGY_ENABLE on?)' % base)
+    npatterns, nvars = hdr[1], hdr[2]
+    cells = {}
+    for p in range(npatterns):
+        for v in range(nvars):
+            a = base + HDR_LEN + (p * nvars + v) * CELL_LEN
+            avg, units = image[a] | (image[a + 1] << 8), image[a + 2]
+            if units == 0 or units > MAX_UNITS:
+                continue
+            cells[(p, v)] = (avg / 0xffff, units)
+    return npatterns, nvars, cells
+
+
+def main():
+    ap = argparse.ArgumentParser(description='rank patterns by mAh per hour')
+    ap.add_argument('image', help='EEPROM image, %d bytes' % EEPROM_SIZE)
+    ap.add_argument('--sketch', default=os.path.join(os.path.dirname(__file__), '..', 'snowflake_complete'),
+                    help='sketch directory, for pattern names and settings')
+    ap.add_argument('-v', '--var0', action='store_true', help='a row for each var0')
+    ap.add_argument('--channel-ma', type=float, default=12.0,
+                    help='one LED channel full on (default 12)')
+    ap.add_argument('--pixel-ma', type=float, default=0.8,
+                    help='each pixel with its LEDs off (default 0.8)')
+    ap.add_argument('--mcu-ma', type=float, default=4.0,
+                    help='the ATmega328P running at 8MHz (default 4)')
+    ap.add_argument('--ir-ma', type=float, default=0.4,
+                    help='the IR receiver, on while running and asleep (default 0.4)')
+    ap.add_argument('--sleep-ma', type=float, default=0.005,
+                    help='the ATmega328P in power-down (default 0.005)')
+    args = ap.parse_args()
+
+    with open(args.image, 'rb') as f:
+        image = f.read()
+    if len(image) != EEPROM_SIZE:
+        sys.exit('%s: %d bytes, not %d' % (args.image, len(image), EEPROM_SIZE))
+    brites, pixels, base = sketch_consts(args.sketch)
+    names = pattern_names(args.sketch)
+    npatterns, nvars, cells = load_table(image, base)
+    if names and len(names) != npatterns:
+        print('warning: the table has %d patterns, the sketch %d' % (npatterns, len(names)))
+
+    rows = []
+    for p in range(npatterns):
+        name = names[p] if p < len(names) else str(p)
+        if args.var0:
+            for v in range(nvars):
+                if (p, v) in cells:
+                    rows.append(('%s/%d' % (name, v),) + cells[(p, v)])
+            continue
+        # the var0s weighted by the time each has had
+        mine = [cells[(p, v)] for v in range(nvars) if (p, v) in cells]
+        units = sum(u for _, u in mine)
+        if units:
+            rows.append((name, sum(l * u for l, u in mine) / units, units))
+    seen = set(r[0].split('/')[0] for r in rows)
+    missing = [n for n in (names or [str(p) for p in range(npatterns)]) if n not in seen]
+
+    base_ma = args.mcu_ma + args.ir_ma + pixels * args.pixel_ma
+    full_ma = pixels * 3 * args.channel_ma
+    order = sorted(range(len(brites)), key=lambda i: brites[i])
+
+    print('mA running (mAh per hour), %d pixels, %.1f mA of it the same for all' % (pixels, base_ma))
+    print('%-16s %6s %7s' % ('pattern', 'load', 'minutes') +
+          ''.join(' %8s' % ('b%d=%d' % (i, brites[i])) for i in order))
+    for name, load, units in sorted(rows, key=lambda r: r[1]):
+        # copyToOut() scales each channel by brightness / 256
+        ma = [base_ma + full_ma * load * brites[i] / 256.0 for i in order]
+        print('%-16s %5.1f%% %7s' % (name, 100.0 * load,
+                                     '%d%s' % (units * UNIT_SECONDS // 60, '+' if units >= MAX_UNITS else '')) +
+              ''.join(' %8.1f' % m for m in ma))
+    if missing:
+        print('no data: %s' % ' '.join(missing))
+    print('asleep (wakeable): %.3f mA; hard off leaves the IR receiver off too' %
+          (args.ir_ma + args.sleep_ma))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+###############################################
+#
+# Copyright 2019 South Berkeley Electronics
+# All Rights Reserved
+#
+# Draws what a snowflake built with MIRROR_ENABLE (see mirror.h) is
+# showing, live, in a terminal that does 24-bit color.
+#
+#   stty -F /dev/ttyUSB0 250000 raw
+#   cat /dev/ttyUSB0 | ./mirror_view.py
+#
+# Trace records (trace.h) on the same wire are skipped, or saved with
+# --trace for trace_decode.py.
+#
+###############################################
+
+import argparse
+import math
+import sys
+import time
+
+MIRROR_SYNC = 0xb4
+HDR_LEN     = 5
+TRACE_SYNC  = 0xa4
+VALUE_LEN   = (0, 1, 2, 4)
+
+ARMS          = 6
+PIXELS_PER_ARM = 5
+
+# Where each pixel of an arm is, along the arm and across it (toward
+# the next arm counterclockwise), with the tip at 1. The chain runs
+# clockwise from the top right arm, in on one side of each arm, out
+# to the tip and back in the other side; cylons[] in helpers.h has
+# the rows.
+ARM_LAYOUT = ((0.50, 0.22), (0.80, 0.22), (1.00, 0.0), (0.80, -0.22), (0.50, -0.22))
+
+COLS = 43
+ROWS = 21
+
+
+def crc8(data):
+    # must match crc8() in helpers.cpp
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xff if crc & 0x80 else (crc << 1) & 0xff
+    return crc
+
+
+def layout(n):
+    pos = []
+    for i in range(n):
+        arm, j = divmod(i, PIXELS_PER_ARM)
+        along, across = ARM_LAYOUT[j % len(ARM_LAYOUT)]
+        # clockwise from straight up
+        a = math.radians(30 + 60 * (arm % ARMS))
+        x = along * math.sin(a) - across * math.cos(a)
+        y = along * math.cos(a) + across * math.sin(a)
+        col = int(round((COLS - 1) / 2 + x * (COLS - 3) / 2))
+        row = int(round((ROWS - 1) / 2 - y * (ROWS - 1) / 2))
+        pos.append((row, col))
+    return pos
+
+
+def frames(stream, trace_out):
+    buf = b''
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        buf += chunk
+        while buf:
+            b = buf[0]
+            if b == MIRROR_SYNC:
+                if len(buf) < HDR_LEN:
+                    break
+                n = buf[4]
+                end = HDR_LEN + n * 3 + 1
+                if len(buf) < end:
+                    break
+                pix = buf[HDR_LEN:end - 1]
+                if crc8(pix) != buf[end - 1]:
+                    yield None
+                    buf = buf[1:]
+                    continue
+                yield buf[1], buf[2] | (buf[3] << 8), pix
+                buf = buf[end:]
+            elif (b & 0xfc) == TRACE_SYNC:
+                n = 5 + VALUE_LEN[b & 0x3]
+                if len(buf) < n:
+                    break
+                if trace_out:
+                    trace_out.write(buf[:n])
+                buf = buf[n:]
+            else:
+                buf = buf[1:]
+
+
+def draw(pix, pos, mono):
+    grid = [[' '] * COLS for _ in range(ROWS)]
+    for i, (row, col) in enumerate(pos):
+        g, r, b = pix[i * 3], pix[i * 3 + 1], pix[i * 3 + 2]
+        if mono:
+            lvl = max(r, g, b)
+            grid[row][col] = ' .:-=+*#%@'[min(9, lvl * 10 // 256)] if lvl else 'o'
+        else:
+            grid[row][col] = '\x1b[38;2;%d;%d;%dm●\x1b[0m' % (r, g, b) if (r or g or b) else '·'
+    return '\n'.join(''.join(line) for line in grid)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='draw the frames a snowflake is showing')
+    ap.add_argument('-i', '--input', help='file to read (default stdin)')
+    ap.add_argument('--trace', help='save trace records here')
+    ap.add_argument('--mono', action='store_true', help='no color, brightness as characters')
+    args = ap.parse_args()
+
+    stream = open(args.input, 'rb') if args.input else sys.stdin.buffer
+    trace_out = open(args.trace, 'wb') if args.trace else None
+
+    pos = None
+    last_seq = None
+    shown = lost = bad = 0
+    dev_drops = 0
+    start = time.time()
+    sys.stdout.write('\x1b[2J')
+    for f in frames(stream, trace_out):
+        if f is None:
+            bad += 1
+            continue
+        seq, drops, pix = f
+        if pos is None or len(pos) != len(pix) // 3:
+            pos = layout(len(pix) // 3)
+        if last_seq is not None:
+            lost += (seq - last_seq - 1) & 0xff
+        last_seq = seq
+        dev_drops = drops
+        shown += 1
+        fps = shown / max(time.time() - start, 1e-3)
+        sys.stdout.write('\x1b[H' + draw(pix, pos, args.mono) + '\n')
+        sys.stdout.write('seq %3d  %d frames  %.1f fps  %d lost on the wire  %d dropped on the device  %d bad\x1b[K\n'
+                         % (seq, shown, fps, lost, dev_drops, bad))
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+###############################################
+#
+# Copyright 2019 South Berkeley Electronics
+# All Rights Reserved
+#
+# Summarizes the profile tables dumped by profile.h (PROFILE_ENABLE).
+# Takes the text from a SERIAL_DEBUG build, or the output of 
+# trace_decode.py for a TRACE_DEBUG build, and for each pattern ranks
+# the zones by their share of the frame (PZ_RENDER) time.
+#
+#   ./trace_decode.py ../snowflake_complete -i log.bin | \
+#       ./profile_report.py --sketch ../snowflake_complete
+#
+###############################################
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+# must match profile_zone_e in profile.h
+ZONES = ['render', 'tick', 'copyToOut', 'show', 'ir', 'vcc', 'buttons', 'scale2mask']
+CYCLES_PER_TICK = 8
+
+VAR_RE = re.compile(r'([A-Za-z_][\w.]*): (-?\d+)\s*$')
+
+
+def pattern_names(sketch_dir):
+    # the order of patterns[], from the list in patterns.h
+    if not sketch_dir:
+        return []
+    path = os.path.join(sketch_dir, 'patterns.h')
+    if not os.path.exists(path):
+        return []
+    return re.findall(r'^\s*PATTERN\((\w+),', open(path).read(), re.M)
+
+
+def parse(lines):
+    # returns {tag: {zone: [count, total, min, max]}}, summed over dumps
+    out = collections.defaultdict(lambda: collections.defaultdict(lambda: [0, 0, None, 0]))
+    in_dump, tag, zone = False, None, None
+    for line in lines:
+        line = line.rstrip()
+        if line.endswith('profile'):
+            in_dump, tag, zone = True, None, None
+            continue
+        if line.endswith('profile end'):
+            in_dump = False
+            continue
+        if not in_dump:
+            continue
+        m = VAR_RE.search(line)
+        if not m:
+            continue
+        name, v = m.group(1), int(m.group(2))
+        if name == 'tag':
+            tag = v
+        elif name == 'z':
+            zone = v
+        elif tag is not None and zone is not None:
+            st = out[tag][zone]
+            if name == 's.count':
+                st[0] += v
+            elif name == 's.total':
+                st[1] += v
+            elif name == 's.min':
+                st[2] = v if st[2] is None else min(st[2], v)
+            elif name == 's.max':
+                st[3] = max(st[3], v)
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description='rank profile zones per pattern')
+    ap.add_argument('-i', '--input', help='decoded log (default stdin)')
+    ap.add_argument('--sketch', help='sketch directory, to name the patterns')
+    args = ap.parse_args()
+
+    lines = open(args.input) if args.input else sys.stdin
+    data  = parse(lines)
+    names = pattern_names(args.sketch)
+
+    for tag in sorted(data):
+        zones  = data[tag]
+        pname  = names[tag] if tag < len(names) else str(tag)
+        render = zones.get(0, [0, 0, 0, 0])
+        frames = render[0]
+        ftotal = render[1]
+        print('pattern %d (%s): %d frames, %.0f cycles/frame' %
+              (tag, pname, frames, CYCLES_PER_TICK * ftotal / frames if frames else 0))
+        ranked = sorted(((z, st) for z, st in zones.items() if z != 0),
+                        key=lambda zs: -zs[1][1])
+        for z, (count, total, mn, mx) in ranked:
+            zname = ZONES[z] if z < len(ZONES) else 'zone%d' % z
+            share = 100.0 * total / ftotal if ftotal else 0
+            print('  %-11s %6.1f%%  calls %6d  avg %8.0f  min %7d  max %7d cycles' %
+                  (zname, share, count, CYCLES_PER_TICK * total / count,
+                   CYCLES_PER_TICK * mn, CYCLES_PER_TICK * mx))
+        print()
+
+
+if __name__ == '__main__':
+    main()
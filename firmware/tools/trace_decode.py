@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+###############################################
+#
+# Copyright 2019 South Berkeley Electronics
+# All Rights Reserved
+#
+# Decoder for the binary trace records written by trace.h. The
+# firmware only sends ids; the text for each id is recovered from the
+# DEBUG_* macro at that file and line in the sketch source, so run
+# this against the same source the firmware was built from. It stops
+# if the source has two files with DEBUG_* calls whose names hash to
+# the same id, or one with more lines than an id can tell apart, as
+# their records could not be told apart either; rename the file.
+#
+#   stty -F /dev/ttyUSB0 19200 raw
+#   cat /dev/ttyUSB0 | ./trace_decode.py ../snowflake_complete
+#
+###############################################
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+TRACE_SYNC     = 0xa4
+TRACE_ID_DROPS = 0
+HDR_LEN        = 6
+VALUE_LEN      = (0, 1, 2, 4)
+LINE_BITS      = 10
+LINE_MASK      = (1 << LINE_BITS) - 1
+
+MACRO_RE = re.compile(r'\b(DEBUG_[A-Z_]+|TRACE)\s*\((.*)\)')
+
+
+def file_id(name):
+    # must match trace_file_id() in trace.h
+    h = 0
+    for c in name:
+        h = (h * 31 + ord(c)) & 0xffff
+    return (h ^ (h >> 14)) & 0x3fff
+
+
+def split_args(s):
+    # split a macro argument list on top-level commas
+    out, depth, cur, quote = [], 0, '', None
+    for c in s:
+        if quote:
+            cur += c
+            if c == quote:
+                quote = None
+        elif c in '"\'':
+            quote = c
+            cur += c
+        elif c == '(':
+            depth += 1
+            cur += c
+        elif c == ')':
+            if depth == 0:
+                break
+            depth -= 1
+            cur += c
+        elif c == ',' and depth == 0:
+            out.append(cur.strip())
+            cur = ''
+        else:
+            cur += c
+    if cur.strip():
+        out.append(cur.strip())
+    return out
+
+
+def build_table(src_dirs):
+    table, owners = {}, {}
+    for d in src_dirs:
+        for fn in sorted(os.listdir(d)):
+            if not fn.endswith(('.h', '.cpp', '.ino')):
+                continue
+            fid = file_id(fn)
+            sites = 0
+            with open(os.path.join(d, fn), errors='replace') as f:
+                for lineno, line in enumerate(f, 1):
+                    if line.lstrip().startswith(('#define', '//')):
+                        continue
+                    m = MACRO_RE.search(line)
+                    if not m:
+                        continue
+                    if lineno > LINE_MASK:
+                        sys.exit('%s:%d: past line %d, where trace ids wrap' % (fn, lineno, LINE_MASK))
+                    key = (fid << LINE_BITS) | lineno
+                    table[key] = (fn, lineno, m.group(1), split_args(m.group(2)))
+                    sites += 1
+            if not sites:
+                continue
+            if fid in owners and owners[fid] != fn:
+                sys.exit('%s and %s have the same trace file id' % (owners[fid], fn))
+            owners[fid] = fn
+    return table
+
+
+def describe(entry, value):
+    fn, lineno, macro, args = entry
+    fmt_hex = len(args) > 1 and args[1] == 'HEX'
+    vtxt = '' if value is None else (('0x%x' % value) if fmt_hex else str(value))
+    if macro in ('DEBUG_PRINTLN_F', 'DEBUG_PRINT_F'):
+        text = args[0].strip('"') if args else ''
+    elif macro in ('DEBUG_PVAR', 'DEBUG_PVAR_FMT'):
+        text = '%s: %s' % (args[0], vtxt)
+    elif macro == 'DEBUG_INIT':
+        text = 'debug init!'
+    elif args and args[0].startswith('"'):
+        text = args[0].strip('"')
+    else:
+        text = vtxt
+    return '%s:%d %s' % (fn, lineno, text)
+
+
+def records(stream):
+    buf = b''
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        buf += chunk
+        while True:
+            # resync on the marker byte
+            i = 0
+            while i < len(buf) and (buf[i] & 0xfc) != TRACE_SYNC:
+                i += 1
+            buf = buf[i:]
+            if len(buf) < HDR_LEN:
+                break
+            vtype = buf[0] & 0x3
+            n = HDR_LEN + VALUE_LEN[vtype]
+            if len(buf) < n:
+                break
+            rid = int.from_bytes(buf[1:4], 'little')
+            ts, = struct.unpack_from('<H', buf, 4)
+            value = None
+            if vtype:
+                value = int.from_bytes(buf[HDR_LEN:n], 'little')
+            yield rid, ts, vtype, value
+            buf = buf[n:]
+
+
+def main():
+    ap = argparse.ArgumentParser(description='decode snowflake binary trace records')
+    ap.add_argument('src', nargs='+', help='sketch source directories')
+    ap.add_argument('-i', '--input', help='file to read (default stdin)')
+    args = ap.parse_args()
+
+    table = build_table(args.src)
+    stream = open(args.input, 'rb') if args.input else sys.stdin.buffer
+
+    for rid, ts, vtype, value in records(stream):
+        if rid == TRACE_ID_DROPS:
+            line = '*** %d records dropped' % value
+        elif rid in table:
+            line = describe(table[rid], value)
+        else:
+            line = 'unknown id 0x%06x %s' % (rid, '' if value is None else value)
+        print('%5d.%03d %s' % (ts // 1000, ts % 1000, line))
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,374 @@
+#!/usr/bin/env python3
+###############################################
+#
+# Copyright 2019 South Berkeley Electronics
+# All Rights Reserved
+#
+# Assembler for the pattern VM in vm.h.
+#
+#   ./vmasm.py vm/arms.vms -o arms.bin        assemble to an image
+#   ./vmasm.py -d arms.bin                    disassemble one
+#   ./vmasm.py -H ../snowflake_complete/vm_progs.h vm/*.vms
+#                                             the built-in programs
+#   ./vmasm.py vm/arms.vms --upload /dev/ttyUSB0
+#                                             into the EEPROM of a unit
+#                                             built with VM_UPLOAD_ENABLE
+#
+# A program is one instruction or directive a line, with ; comments:
+#
+#   label:  OP operand, operand ...
+#           .tick                 each tick starts here
+#           .db 1, 2, 0x30        bytes, for LDP tables
+#
+# Operands are r0-r15, c0-c3, numbers, 'c'haracters, labels, the
+# geometry kinds ARM SPOKE RING CYLON, the rotations INNER OUTER ALL
+# and, for COL, the color names in tables.h.
+#
+###############################################
+
+import argparse
+import os
+import re
+import sys
+import time
+
+MAGIC    = b'Vm'
+HDR_LEN  = 5
+MAX_CODE = 0x100 - HDR_LEN
+
+# must match vm_op_t in vm.h, in order. r register, c color register,
+# i byte, a code address, g vm_geo_t, k rotate_type_t, n color name
+OPS = [
+    ('END',  ''),
+    ('LDI',  'ri'),
+    ('MOV',  'rr'),
+    ('ADD',  'rr'),
+    ('SUB',  'rr'),
+    ('ADDI', 'ri'),
+    ('AND',  'rr'),
+    ('ANDI', 'ri'),
+    ('SHR',  'ri'),
+    ('SHL',  'ri'),
+    ('MUL',  'rr'),
+    ('MOD',  'rr'),
+    ('LDP',  'rar'),
+    ('JMP',  'a'),
+    ('JZ',   'ra'),
+    ('JNZ',  'ra'),
+    ('JLT',  'rra'),
+    ('DJNZ', 'ra'),
+    ('SIN',  'rr'),
+    ('RND',  'r'),
+    ('VAR',  'r'),
+    ('LEN',  'r'),
+    ('GEO',  'rgr'),
+    ('RGB',  'crrr'),
+    ('COL',  'cn'),
+    ('RCOL', 'c'),
+    ('SET',  'rc'),
+    ('GET',  'cr'),
+    ('FILL', 'c'),
+    ('CLR',  ''),
+    ('ROT',  'kr'),
+    ('MIX',  'cccr'),
+    ('SCL',  'cr'),
+    ('ADDC', 'cc'),
+    ('CPY',  'cc'),
+]
+OPCODE = {name: (code, args) for code, (name, args) in enumerate(OPS)}
+
+REGS   = 16
+COLORS = 4
+# vm_geo_t, rotate_type_t (rotate.h) and pixel_color_t (tables.h)
+GEO    = ['ARM', 'SPOKE', 'RING', 'CYLON']
+ROT    = ['INNER', 'OUTER', 'ALL']
+NAMES  = ['BLACK', 'WHITE', 'RED', 'LIME', 'BLUE', 'YELLOW', 'CYAN', 'MAGENTA',
+          'SILVER', 'GRAY', 'MAROON', 'OLIVE', 'GREEN', 'PURPLE', 'TEAL', 'NAVY']
+
+UPLOAD_MAGIC = b'Vu'
+UPLOAD_CHUNK = 8
+UPLOAD_ACK   = ord('k')
+UPLOAD_NAK   = ord('e')
+UPLOAD_BAUD  = 19200
+TRACE_SYNC   = 0xa4
+VALUE_LEN    = (0, 1, 2, 4)
+
+LABEL_RE = re.compile(r'^([A-Za-z_]\w*):\s*(.*)$')
+
+
+class AsmError(Exception):
+    pass
+
+
+def crc8(data):
+    # must match crc8() in helpers.cpp
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xff if crc & 0x80 else (crc << 1) & 0xff
+    return crc
+
+
+def number(tok):
+    if len(tok) == 3 and tok[0] == tok[2] == "'":
+        return ord(tok[1])
+    try:
+        return int(tok, 0)
+    except ValueError:
+        return None
+
+
+def operand(kind, tok, labels, final):
+    up = tok.upper()
+    if kind in 'rc':
+        n = number(tok[1:]) if tok[:1].lower() == kind else None
+        if n is None or not 0 <= n < (REGS if kind == 'r' else COLORS):
+            raise AsmError('expected %s, got %r' % ('r0-r15' if kind == 'r' else 'c0-c3', tok))
+        return n
+    if kind in 'gkn':
+        names = {'g': GEO, 'k': ROT, 'n': NAMES}[kind]
+        if up in names:
+            return names.index(up)
+        if kind == 'n' and number(tok) is not None:
+            return number(tok) & 0xff
+        raise AsmError('expected one of %s, got %r' % (' '.join(names), tok))
+    if kind == 'a':
+        if tok in labels:
+            return labels[tok]
+        n = number(tok)
+        if n is None:
+            if final:
+                raise AsmError('no label %r' % tok)
+            return 0
+        return n
+    n = number(tok)
+    if n is None or not -128 <= n <= 255:
+        raise AsmError('expected a byte, got %r' % tok)
+    return n & 0xff
+
+
+def split_ops(s):
+    return [t for t in (x.strip() for x in re.split(r'[,\s]+', s)) if t]
+
+
+def assemble(text):
+    # two passes: the first finds the labels, the second fills them in
+    labels = {}
+    for final in (False, True):
+        code = bytearray()
+        tick = None
+        for lineno, raw in enumerate(text.splitlines(), 1):
+            line = raw.split(';', 1)[0].strip()
+            try:
+                while True:
+                    m = LABEL_RE.match(line)
+                    if not m:
+                        break
+                    name, line = m.group(1), m.group(2).strip()
+                    if not final:
+                        if name in labels:
+                            raise AsmError('label %r twice' % name)
+                        labels[name] = len(code)
+                if not line:
+                    continue
+                parts = line.split(None, 1)
+                op, rest = parts[0], (parts[1] if len(parts) > 1 else '')
+                if op == '.tick':
+                    tick = len(code)
+                elif op == '.db':
+                    for tok in split_ops(rest):
+                        code.append(operand('i', tok, labels, final))
+                elif op.upper() in OPCODE:
+                    opc, kinds = OPCODE[op.upper()]
+                    toks = split_ops(rest)
+                    if len(toks) != len(kinds):
+                        raise AsmError('%s takes %d operands' % (op.upper(), len(kinds)))
+                    code.append(opc)
+                    for k, tok in zip(kinds, toks):
+                        code.append(operand(k, tok, labels, final))
+                else:
+                    raise AsmError('what is %r?' % op)
+            except AsmError as e:
+                raise AsmError('line %d: %s' % (lineno, e))
+    if tick is None:
+        raise AsmError('no .tick')
+    if not code or len(code) > MAX_CODE:
+        raise AsmError('%d bytes of code; 1 to %d fit' % (len(code), MAX_CODE))
+    if tick >= len(code):
+        raise AsmError('nothing after .tick')
+    for name, addr in labels.items():
+        if addr >= len(code):
+            raise AsmError('label %r is past the end' % name)
+    return MAGIC + bytes([len(code), tick, crc8(code)]) + bytes(code)
+
+
+def check_image(img):
+    if len(img) < HDR_LEN or img[:2] != MAGIC:
+        raise AsmError('not a VM image')
+    n, tick, crc = img[2], img[3], img[4]
+    code = img[HDR_LEN:HDR_LEN + n]
+    if len(code) != n or crc8(code) != crc or tick >= n:
+        raise AsmError('bad image')
+    return code, tick
+
+
+def disassemble(img):
+    code, tick = check_image(img)
+    out = []
+    pc = 0
+    while pc < len(code):
+        if pc == tick:
+            out.append('        .tick')
+        op = code[pc]
+        if op >= len(OPS) or pc + 1 + len(OPS[op][1]) > len(code):
+            out.append('%3d:    .db %d' % (pc, op))
+            pc += 1
+            continue
+        name, kinds = OPS[op]
+        args = []
+        for i, k in enumerate(kinds):
+            v = code[pc + 1 + i]
+            if k in 'rc':
+                args.append('%s%d' % (k, v))
+            elif k == 'g':
+                args.append(GEO[v] if v < len(GEO) else str(v))
+            elif k == 'k':
+                args.append(ROT[v] if v < len(ROT) else str(v))
+            elif k == 'n':
+                args.append(NAMES[v] if v < len(NAMES) else str(v))
+            else:
+                args.append(str(v))
+        out.append(('%3d:    %-5s %s' % (pc, name, ', '.join(args))).rstrip())
+        pc += 1 + len(kinds)
+    return '\n'.join(out)
+
+
+def header(files, out):
+    lines = [
+        '///////////////////////////////////////////////',
+        '//',
+        '// Copyright 2019 South Berkeley Electronics',
+        '// All Rights Reserved',
+        '//',
+        '// Arduino sketch to control an LED snowflake.',
+        '//',
+        '// Author: Dave Jacobowitz (dave@southberkeleyelectronics.com)',
+        '//',
+        '///////////////////////////////////////////////',
+        '',
+        '#ifndef __vm_progs_h',
+        '#define __vm_progs_h',
+        '',
+        '#include <stdint.h>',
+        '#include <Arduino.h>',
+        '',
+        '// Built-in programs for the VM pattern (vm.h). Made by',
+        '//',
+        '//   tools/vmasm.py -H vm_progs.h tools/vm/*.vms',
+        '//',
+        '// from the sources in tools/vm; edit those, not this.',
+    ]
+    for path in files:
+        name = os.path.splitext(os.path.basename(path))[0]
+        with open(path) as f:
+            img = assemble(f.read())
+        lines.append('')
+        lines.append('// %s, %d bytes' % (os.path.basename(path), len(img)))
+        lines.append('const uint8_t PROGMEM vm_prog_%s[] = {' % name)
+        for i in range(0, len(img), 12):
+            lines.append('    ' + ' '.join('0x%02x,' % b for b in img[i:i + 12]))
+        lines.append('};')
+    lines.append('')
+    lines.append('#endif')
+    lines.append('')
+    with open(out, 'w') as f:
+        f.write('\n'.join(lines))
+
+
+def upload(img, port):
+    import termios
+    fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+    attrs = termios.tcgetattr(fd)
+    attrs[0] = 0                                  # iflag
+    attrs[1] = 0                                  # oflag
+    attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+    attrs[3] = 0                                  # lflag
+    attrs[4] = attrs[5] = getattr(termios, 'B%d' % UPLOAD_BAUD)
+    attrs[6][termios.VMIN] = 0
+    attrs[6][termios.VTIME] = 1
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    # opening the port resets most Arduinos
+    time.sleep(2)
+    termios.tcflush(fd, termios.TCIFLUSH)
+
+    def answer():
+        # trace records can come in between; skip them
+        pending = b''
+        deadline = time.time() + 1.0
+        while time.time() < deadline:
+            pending += os.read(fd, 64)
+            while pending:
+                b = pending[0]
+                if (b & 0xfc) == TRACE_SYNC:
+                    n = 5 + VALUE_LEN[b & 0x3]
+                    if len(pending) < n:
+                        break
+                    pending = pending[n:]
+                elif b in (UPLOAD_ACK, UPLOAD_NAK):
+                    return b
+                else:
+                    pending = pending[1:]
+        return None
+
+    chunks = [(off, img[off:off + UPLOAD_CHUNK]) for off in range(0, len(img), UPLOAD_CHUNK)]
+    chunks.append((0, b''))
+    for off, data in chunks:
+        body = bytes([off, len(data)]) + data
+        for attempt in range(5):
+            os.write(fd, UPLOAD_MAGIC + body + bytes([crc8(body)]))
+            if answer() == UPLOAD_ACK:
+                break
+        else:
+            os.close(fd)
+            raise AsmError('no answer for the chunk at %d' % off)
+    os.close(fd)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='assembler for the pattern VM')
+    ap.add_argument('files', nargs='+')
+    ap.add_argument('-o', '--output', help='write the image here')
+    ap.add_argument('-d', '--disassemble', action='store_true', help='the files are images; list them')
+    ap.add_argument('-H', '--header', help='write all the files as a C header of built-in programs')
+    ap.add_argument('--upload', metavar='PORT', help='send the image to a unit built with VM_UPLOAD_ENABLE')
+    args = ap.parse_args()
+
+    try:
+        if args.header:
+            header(args.files, args.header)
+            return 0
+        if args.disassemble:
+            for path in args.files:
+                with open(path, 'rb') as f:
+                    print(disassemble(f.read()))
+            return 0
+        if len(args.files) != 1:
+            ap.error('one source file at a time')
+        with open(args.files[0]) as f:
+            img = assemble(f.read())
+        print('%s: %d bytes of code, tick at %d' % (args.files[0], img[2], img[3]), file=sys.stderr)
+        if args.output:
+            with open(args.output, 'wb') as f:
+                f.write(img)
+        if args.upload:
+            upload(img, args.upload)
+            print('uploaded', file=sys.stderr)
+    except AsmError as e:
+        print('%s: %s' % (args.files[0], e), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())